@@ -0,0 +1,470 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Render benchmark of the ray tracer and the ray marcher over generated scenes.
+// Every combination of the parameter lists is rendered several times and the
+// frame times, rays per second and counters are written as JSON.
+//
+// RenderBenchmark [--quick] [--spheres 10,1000] [--resolutions 320x240,1280x720]
+//                 [--threads 1,0] [--depths 0,4] [--renderers raytracer,raymarcher]
+//                 [--accels sah,lbvh] [--iterations 5] [--warmup 1]
+//                 [--max-march-spheres 1000000] [--distance-cache 0] [--relaxed-march] [--cone-prepass]
+//                 [--aa-samples 1] [--primary-bins 0] [--seed 42]
+//                 [--output result.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raytracing/ray_tracer.h"
+#include "raymarching.h"
+
+namespace {
+
+struct Resolution {
+	int width = 0;
+	int height = 0;
+};
+
+struct Options {
+	std::vector<int> sphere_counts{ 10, 100, 1000, 10000, 100000, 1000000 };
+	std::vector<Resolution> resolutions{ { 320, 240 }, { 1280, 720 } };
+	std::vector<int> thread_counts{ 1, 0 };
+	std::vector<int> depths{ 0, 4 };
+	std::vector<std::string> renderers{ "raytracer", "raymarcher" };
+	std::vector<std::string> accels{ "sah", "lbvh" };
+	int iterations = 5;
+	int warmup = 1;
+	//Scenes with more spheres are only rendered by the ray tracer
+	int max_march_spheres = 1000000;
+	//Cell size of the ray marcher distance cache, 0 marches without cache
+	float distance_cache_cell = 0.0f;
+	//Ray marcher uses over-relaxed steps and a pixel footprint hit threshold
+	bool relaxed_march = false;
+	//Ray marcher starts the primary rays from the depth reached by the cone prepass
+	bool cone_prepass = false;
+	//Most primary samples per pixel of the adaptive anti-aliasing, 1 disables it
+	int aa_samples = 1;
+	//Tile size in pixels of the ray tracer primary sphere bins, 0 traces the primary rays in the bvh
+	int primary_bin_size = 0;
+	unsigned int seed = 42;
+	std::string output;
+};
+
+//Summary of the frame times of one configuration
+struct FrameTimes {
+	double median = 0.0;
+	double p10 = 0.0;
+	double p90 = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+};
+
+//Result of one configuration
+struct BenchmarkResult {
+	std::string renderer;
+	std::string accel;
+	int spheres = 0;
+	Resolution resolution;
+	int threads = 0;
+	int max_depth = 0;
+	int iterations = 0;
+	double build_seconds = 0.0;
+	FrameTimes frame_times;
+	raytracing::RenderStats last_frame;
+};
+
+constexpr float kFov = 1.2f;
+constexpr double kBias = 1e-4;
+// Generated spheres are spread in this box in front of the camera
+const maths::Vector3f kSceneMin(-10.0f, -10.0f, -40.0f);
+const maths::Vector3f kSceneMax(10.0f, 10.0f, -10.0f);
+
+void PrintUsage() {
+	std::cerr << "usage: RenderBenchmark [--quick] [--spheres list] [--resolutions WxH list]\n"
+		<< "       [--threads list, 0 uses every hardware thread] [--depths list]\n"
+		<< "       [--renderers raytracer,raymarcher] [--accels sah,lbvh]\n"
+		<< "       [--iterations n] [--warmup n] [--max-march-spheres n] [--seed n]\n"
+		<< "       [--distance-cache cell size, 0 disables the ray marcher cache] [--relaxed-march]\n"
+		<< "       [--cone-prepass] [--aa-samples n, 1 disables the anti-aliasing]\n"
+		<< "       [--primary-bins tile size, 0 traces the ray tracer primary rays in the bvh]\n"
+		<< "       [--output file, stdout by default]\n";
+}
+
+std::vector<std::string> Split(const std::string& list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+bool ParseInts(const std::string& list, std::vector<int>& values) {
+	values.clear();
+	for (const std::string& item : Split(list)) {
+		try {
+			values.push_back(std::stoi(item));
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+	return !values.empty();
+}
+
+bool ParseResolutions(const std::string& list, std::vector<Resolution>& resolutions) {
+	resolutions.clear();
+	for (const std::string& item : Split(list)) {
+		Resolution resolution;
+		char separator = 0;
+		std::stringstream stream(item);
+		if (!(stream >> resolution.width >> separator >> resolution.height) || separator != 'x'
+			|| resolution.width <= 0 || resolution.height <= 0) {
+			return false;
+		}
+		resolutions.push_back(resolution);
+	}
+	return !resolutions.empty();
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string argument = argv[i];
+		if (argument == "--quick") {
+			options.sphere_counts = { 10, 1000, 100000 };
+			options.resolutions = { { 320, 240 } };
+			options.thread_counts = { 0 };
+			options.depths = { 4 };
+			options.iterations = 3;
+			continue;
+		}
+		if (argument == "--relaxed-march") {
+			options.relaxed_march = true;
+			continue;
+		}
+		if (argument == "--cone-prepass") {
+			options.cone_prepass = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			return false;
+		}
+		const std::string value = argv[++i];
+		bool valid = true;
+		std::vector<int> numbers;
+		if (argument == "--spheres") {
+			valid = ParseInts(value, options.sphere_counts);
+		}
+		else if (argument == "--resolutions") {
+			valid = ParseResolutions(value, options.resolutions);
+		}
+		else if (argument == "--threads") {
+			valid = ParseInts(value, options.thread_counts);
+		}
+		else if (argument == "--depths") {
+			valid = ParseInts(value, options.depths);
+		}
+		else if (argument == "--renderers") {
+			options.renderers = Split(value);
+			for (const std::string& renderer : options.renderers) {
+				valid = valid && (renderer == "raytracer" || renderer == "raymarcher");
+			}
+		}
+		else if (argument == "--accels") {
+			options.accels = Split(value);
+			for (const std::string& accel : options.accels) {
+				valid = valid && (accel == "sah" || accel == "lbvh");
+			}
+		}
+		else if (argument == "--iterations") {
+			valid = ParseInts(value, numbers) && numbers[0] > 0;
+			options.iterations = valid ? numbers[0] : 0;
+		}
+		else if (argument == "--warmup") {
+			valid = ParseInts(value, numbers) && numbers[0] >= 0;
+			options.warmup = valid ? numbers[0] : 0;
+		}
+		else if (argument == "--max-march-spheres") {
+			valid = ParseInts(value, numbers);
+			options.max_march_spheres = valid ? numbers[0] : 0;
+		}
+		else if (argument == "--distance-cache") {
+			try {
+				options.distance_cache_cell = std::stof(value);
+			}
+			catch (const std::exception&) {
+				valid = false;
+			}
+		}
+		else if (argument == "--aa-samples") {
+			valid = ParseInts(value, numbers) && numbers[0] > 0;
+			options.aa_samples = valid ? numbers[0] : 1;
+		}
+		else if (argument == "--primary-bins") {
+			valid = ParseInts(value, numbers) && numbers[0] >= 0;
+			options.primary_bin_size = valid ? numbers[0] : 0;
+		}
+		else if (argument == "--seed") {
+			valid = ParseInts(value, numbers);
+			options.seed = valid ? static_cast<unsigned int>(numbers[0]) : 0;
+		}
+		else if (argument == "--output") {
+			options.output = value;
+		}
+		else {
+			valid = false;
+		}
+		if (!valid) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Random spheres in the scene box, the radius shrinks with the count
+//so the image stays about as covered whatever the sphere count
+std::vector<maths::Sphere> GenerateScene(int sphere_count, unsigned int seed) {
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> x(kSceneMin.x, kSceneMax.x);
+	std::uniform_real_distribution<float> y(kSceneMin.y, kSceneMax.y);
+	std::uniform_real_distribution<float> z(kSceneMin.z, kSceneMax.z);
+	std::uniform_real_distribution<float> color(0.0f, 255.0f);
+	std::uniform_real_distribution<float> reflexion(0.0f, 0.5f);
+
+	const maths::Vector3f size = kSceneMax - kSceneMin;
+	const float radius = 0.35f * std::cbrt(size.x * size.y * size.z / sphere_count);
+
+	std::vector<maths::Sphere> spheres;
+	spheres.reserve(sphere_count);
+	for (int i = 0; i < sphere_count; ++i) {
+		maths::Sphere sphere(radius, maths::Vector3f(x(generator), y(generator), z(generator)));
+		sphere.set_material(Material(reflexion(generator),
+			maths::Vector3f(color(generator), color(generator), color(generator))));
+		spheres.push_back(sphere);
+	}
+	return spheres;
+}
+
+double Percentile(const std::vector<double>& sorted, double percentile) {
+	const double position = percentile * (sorted.size() - 1);
+	const size_t index = static_cast<size_t>(position);
+	if (index + 1 >= sorted.size()) {
+		return sorted.back();
+	}
+	const double t = position - index;
+	return sorted[index] * (1.0 - t) + sorted[index + 1] * t;
+}
+
+FrameTimes Summarize(std::vector<double> seconds) {
+	std::sort(seconds.begin(), seconds.end());
+	FrameTimes times;
+	times.median = Percentile(seconds, 0.5);
+	times.p10 = Percentile(seconds, 0.1);
+	times.p90 = Percentile(seconds, 0.9);
+	times.min = seconds.front();
+	times.max = seconds.back();
+	return times;
+}
+
+//Build the scene in the renderer, then render warmup + iterations frames
+template<typename Renderer, typename SetScene>
+void Measure(Renderer& renderer, const SetScene& set_scene, const Options& options, BenchmarkResult& result) {
+	renderer.set_write_image(false);
+	renderer.set_max_depth(result.max_depth);
+	renderer.scheduler().set_thread_count(result.threads);
+	result.threads = renderer.scheduler().thread_count();
+
+	const auto build_begin = std::chrono::steady_clock::now();
+	set_scene();
+	result.build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_begin).count();
+
+	for (int i = 0; i < options.warmup; ++i) {
+		renderer.Render();
+	}
+	std::vector<double> frame_seconds;
+	for (int i = 0; i < options.iterations; ++i) {
+		renderer.Render();
+		frame_seconds.push_back(renderer.stats().wall_seconds);
+	}
+	result.iterations = options.iterations;
+	result.frame_times = Summarize(frame_seconds);
+	result.last_frame = renderer.stats();
+}
+
+raytracing::AdaptiveSamplingSettings AntiAliasing(const Options& options) {
+	raytracing::AdaptiveSamplingSettings settings;
+	settings.max_samples = options.aa_samples;
+	return settings;
+}
+
+void RunRayTracer(std::vector<maths::Sphere>& spheres, const Options& options, BenchmarkResult& result) {
+	raytracing::RayTracer raytracer;
+	const raytracing::PointLight light;
+	const int width = result.resolution.width;
+	const int height = result.resolution.height;
+	raytracer.set_bvh_build_method(result.accel == "lbvh" ? BvhBuildMethod::kLbvh : BvhBuildMethod::kSah);
+	raytracer.set_adaptive_sampling(AntiAliasing(options));
+	raytracer.set_primary_binning(options.primary_bin_size > 0, options.primary_bin_size);
+	Measure(raytracer, [&]() {
+		raytracer.SetScene(spheres, light, height, width, kFov, kBias);
+	}, options, result);
+}
+
+void RunRayMarcher(std::vector<maths::Sphere>& spheres, const Options& options, BenchmarkResult& result) {
+	raytracing::RayMarcher raymarcher;
+	const raytracing::PointLight light;
+	std::vector<maths::Plane> planes;
+	raymarcher.set_bvh_build_method(result.accel == "lbvh" ? BvhBuildMethod::kLbvh : BvhBuildMethod::kSah);
+	raymarcher.set_march_method(options.relaxed_march
+		? raytracing::MarchMethod::kRelaxed : raytracing::MarchMethod::kSphereTracing);
+	raymarcher.set_cone_prepass(options.cone_prepass);
+	raymarcher.set_adaptive_sampling(AntiAliasing(options));
+	Measure(raymarcher, [&]() {
+		raymarcher.SetScene(spheres, planes, light,
+			result.resolution.height, result.resolution.width, kFov, kBias);
+		if (options.distance_cache_cell > 0.0f) {
+			raymarcher.BakeDistanceCache(options.distance_cache_cell);
+		}
+	}, options, result);
+}
+
+void WriteFrameTimes(std::ostream& out, const FrameTimes& times) {
+	out << "{\"median\": " << times.median << ", \"p10\": " << times.p10 << ", \"p90\": " << times.p90
+		<< ", \"min\": " << times.min << ", \"max\": " << times.max << "}";
+}
+
+void WriteResult(std::ostream& out, const BenchmarkResult& result) {
+	using raytracing::RayType;
+	const raytracing::StatCounters& counters = result.last_frame.counters;
+	//Rays per second are taken over the median frame, the counters are the same every frame
+	const double seconds = result.frame_times.median;
+	auto mrays = [&](std::uint64_t rays) { return seconds > 0.0 ? rays / seconds / 1e6 : 0.0; };
+	const std::uint64_t primary = counters.rays[static_cast<int>(RayType::kPrimary)];
+	const std::uint64_t shadow = counters.rays[static_cast<int>(RayType::kShadow)];
+	const std::uint64_t reflection = counters.rays[static_cast<int>(RayType::kReflection)];
+
+	out << "    {\"renderer\": \"" << result.renderer << "\", \"accel\": \"" << result.accel
+		<< "\", \"spheres\": " << result.spheres
+		<< ", \"width\": " << result.resolution.width << ", \"height\": " << result.resolution.height
+		<< ", \"threads\": " << result.threads << ", \"max_depth\": " << result.max_depth
+		<< ", \"iterations\": " << result.iterations
+		<< ",\n     \"build_seconds\": " << result.build_seconds << ", \"frame_seconds\": ";
+	WriteFrameTimes(out, result.frame_times);
+	out << ",\n     \"mrays_per_second\": {\"primary\": " << mrays(primary) << ", \"shadow\": " << mrays(shadow)
+		<< ", \"reflection\": " << mrays(reflection) << ", \"total\": " << mrays(primary + shadow + reflection)
+		<< "},\n     \"rays\": {\"primary\": " << primary << ", \"shadow\": " << shadow
+		<< ", \"reflection\": " << reflection << "}, \"nodes_visited\": " << counters.nodes_visited
+		<< ", \"sphere_tests\": " << counters.sphere_tests << ", \"march_steps\": " << counters.march_steps
+		<< ", \"average_march_steps\": " << result.last_frame.AverageMarchSteps()
+		<< ", \"max_march_steps\": " << counters.max_march_steps
+		<< ", \"average_pixel_samples\": " << result.last_frame.AverageSamplesPerPixel()
+		<< ", \"refined_pixels\": " << result.last_frame.refined_pixels
+		<< ",\n     \"thread_busy_seconds\": [";
+	for (size_t i = 0; i < result.last_frame.thread_busy_seconds.size(); ++i) {
+		out << (i > 0 ? ", " : "") << result.last_frame.thread_busy_seconds[i];
+	}
+	out << "]}";
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<BenchmarkResult> results;
+	for (const int sphere_count : options.sphere_counts) {
+		std::vector<maths::Sphere> spheres = GenerateScene(sphere_count, options.seed);
+		for (const std::string& renderer : options.renderers) {
+			if (renderer == "raymarcher" && sphere_count > options.max_march_spheres) {
+				std::cerr << "skip raymarcher with " << sphere_count << " spheres (--max-march-spheres)\n";
+				continue;
+			}
+			for (const std::string& accel : options.accels) {
+				for (const Resolution& resolution : options.resolutions) {
+					for (const int threads : options.thread_counts) {
+						for (const int depth : options.depths) {
+							BenchmarkResult result;
+							result.renderer = renderer;
+							result.accel = accel;
+							result.spheres = sphere_count;
+							result.resolution = resolution;
+							result.threads = threads;
+							result.max_depth = depth;
+							std::cerr << renderer << " " << accel << " spheres " << sphere_count << " "
+								<< resolution.width << "x" << resolution.height << " threads " << threads
+								<< " depth " << depth << "\n";
+							if (renderer == "raytracer") {
+								RunRayTracer(spheres, options, result);
+							}
+							else {
+								RunRayMarcher(spheres, options, result);
+							}
+							results.push_back(result);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	std::ofstream file;
+	if (!options.output.empty()) {
+		file.open(options.output);
+		if (!file) {
+			std::cerr << "could not open " << options.output << "\n";
+			return 1;
+		}
+	}
+	std::ostream& out = options.output.empty() ? std::cout : file;
+	out << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+		<< ",\n  \"stats_enabled\": " << (RAYTRACING_ENABLE_STATS ? "true" : "false")
+		<< ",\n  \"distance_cache_cell\": " << options.distance_cache_cell
+		<< ",\n  \"relaxed_march\": " << (options.relaxed_march ? "true" : "false")
+		<< ",\n  \"cone_prepass\": " << (options.cone_prepass ? "true" : "false")
+		<< ",\n  \"aa_samples\": " << options.aa_samples
+		<< ",\n  \"primary_bin_size\": " << options.primary_bin_size
+		<< ",\n  \"seed\": " << options.seed << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		WriteResult(out, results[i]);
+		out << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Microbenchmark of the vector maths in the two hottest scalar kernels: the ray-sphere
+// test of maths::Ray3::IntersectSphere and maths::Sphere::sdf, against the same kernels
+// written with the SSE backed maths::SimdVector3f. Every kernel runs over the same rays,
+// points and spheres, the best time of the iterations is reported in ns per test.
+// Configured with RAYTRACING_SIMD_VECTOR3 the Vector3f kernels use SimdVector3f as well.
+//
+// VectorBenchmark [--spheres 1024] [--rays 4096] [--iterations 5] [--seed 42]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maths/ray3.h"
+#include "maths/sphere.h"
+#include "maths/vector3_simd.h"
+
+namespace {
+
+struct Options {
+	int sphere_count = 1024;
+	int ray_count = 4096;
+	int iterations = 5;
+	unsigned int seed = 42;
+};
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string argument = argv[i];
+		if (i + 1 >= argc) {
+			return false;
+		}
+		const int value = std::atoi(argv[++i]);
+		if (value <= 0) {
+			return false;
+		}
+		if (argument == "--spheres") {
+			options.sphere_count = value;
+		}
+		else if (argument == "--rays") {
+			options.ray_count = value;
+		}
+		else if (argument == "--iterations") {
+			options.iterations = value;
+		}
+		else if (argument == "--seed") {
+			options.seed = static_cast<unsigned int>(value);
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct SimdSphere {
+	maths::SimdVector3f center;
+	float radius;
+};
+
+//Same test as maths::Ray3::IntersectSphere(sphere, distance)
+inline bool IntersectSimd(
+	const maths::SimdVector3f& origin,
+	const maths::SimdVector3f& direction,
+	const SimdSphere& sphere,
+	float& distance) {
+	const maths::SimdVector3f v = sphere.center - origin;
+	const float d = maths::SimdVector3f::Dot(v, direction);
+	if (d < 0.0f) {
+		return false;
+	}
+	const float squared_distance = maths::SimdVector3f::Dot(v, v) - d * d;
+	const float squared_radius = sphere.radius * sphere.radius;
+	if (squared_distance > squared_radius) {
+		return false;
+	}
+	const float q = std::sqrt(squared_radius - squared_distance);
+	distance = d - q >= 0.0f ? d - q : d + q;
+	return true;
+}
+
+//Run the kernel iterations times and print the best time in ns per test,
+//the kernel returns a checksum to compare the variants of a kernel
+template<typename Kernel>
+void Run(const std::string& name, int iterations, double tests, const Kernel& kernel) {
+	using Clock = std::chrono::steady_clock;
+	double best = 0.0;
+	double checksum = 0.0;
+	for (int i = 0; i < iterations; ++i) {
+		const Clock::time_point begin = Clock::now();
+		checksum = kernel();
+		const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+		best = i == 0 ? seconds : std::min(best, seconds);
+	}
+	std::cout << name << ": " << best / tests * 1e9 << " ns per test (checksum " << checksum << ")\n";
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		std::cerr << "usage: VectorBenchmark [--spheres n] [--rays n] [--iterations n] [--seed n]\n";
+		return 1;
+	}
+
+	std::mt19937 generator(options.seed);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 1.0f);
+	std::vector<maths::Sphere> spheres;
+	std::vector<SimdSphere> simd_spheres;
+	for (int i = 0; i < options.sphere_count; ++i) {
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator) - 20.0f));
+		simd_spheres.push_back(SimdSphere{ maths::SimdVector3f(spheres.back().center()), spheres.back().radius() });
+	}
+	std::vector<maths::Ray3> rays;
+	std::vector<maths::Vector3f> points;
+	for (int i = 0; i < options.ray_count; ++i) {
+		const maths::Vector3f point(position(generator), position(generator), position(generator) - 20.0f);
+		rays.emplace_back(maths::Vector3f(0.0f, 0.0f, 0.0f), point.Normalized());
+		points.push_back(point);
+	}
+	const double tests = static_cast<double>(options.sphere_count) * options.ray_count;
+
+	//The checksums of the scalar and simd variants of a kernel must match
+	Run("ray_sphere_vector3f", options.iterations, tests, [&]() {
+		double hits = 0.0;
+		for (const maths::Ray3& ray : rays) {
+			for (const maths::Sphere& sphere : spheres) {
+				float distance;
+				hits += ray.IntersectSphere(sphere, distance) ? 1.0 : 0.0;
+			}
+		}
+		return hits;
+	});
+
+	Run("ray_sphere_simd", options.iterations, tests, [&]() {
+		double hits = 0.0;
+		for (const maths::Ray3& ray : rays) {
+			const maths::SimdVector3f origin(ray.origin());
+			const maths::SimdVector3f direction(ray.direction());
+			for (const SimdSphere& sphere : simd_spheres) {
+				float distance;
+				hits += IntersectSimd(origin, direction, sphere, distance) ? 1.0 : 0.0;
+			}
+		}
+		return hits;
+	});
+
+	Run("sphere_sdf_vector3f", options.iterations, tests, [&]() {
+		double sum = 0.0;
+		for (const maths::Vector3f& point : points) {
+			float nearest = 1000000.0f;
+			for (maths::Sphere& sphere : spheres) {
+				nearest = std::min(nearest, sphere.sdf(point));
+			}
+			sum += nearest;
+		}
+		return sum;
+	});
+
+	Run("sphere_sdf_simd", options.iterations, tests, [&]() {
+		double sum = 0.0;
+		for (const maths::Vector3f& point : points) {
+			const maths::SimdVector3f simd_point(point);
+			float nearest = 1000000.0f;
+			for (const SimdSphere& sphere : simd_spheres) {
+				nearest = std::min(nearest, (simd_point - sphere.center).Magnitude() - sphere.radius);
+			}
+			sum += nearest;
+		}
+		return sum;
+	});
+	return 0;
+}
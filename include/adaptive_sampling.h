@@ -0,0 +1,67 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <functional>
+#include <vector>
+
+#include "maths/vector3.h"
+#include "render_scheduler.h"
+#include "render_stats.h"
+#include "render_types.h"
+
+namespace raytracing {
+
+struct AdaptiveSamplingSettings {
+	//Most primary samples of a pixel, 1 disables the anti-aliasing
+	int max_samples = 1;
+	//Difference on any color channel, between 0 and 255, above which neighbouring
+	//pixels are refined, the samples of a pixel refine further past half of it
+	float contrast_threshold = 32.0f;
+};
+
+//Color of a primary sample and the primitive it hit, -1 for the background
+struct PixelSample {
+	maths::Vector3f color;
+	int primitive_id = -1;
+};
+
+using PixelSampleFunction = std::function<PixelSample(float x, float y)>;
+
+//Refine a frame rendered with one sample through every pixel center, primitive_ids holding
+//the primitive of every sample. The pixels whose four neighbours hit another primitive or
+//differ by more than the contrast threshold get more samples until their variance is low
+//or max_samples is reached, the target then gets the average of the samples.
+//The refinement pass and the sample counts are added to the stats of the first pass.
+void RefineAdaptive(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const PixelSampleFunction& trace_sample,
+	const AdaptiveSamplingSettings& settings,
+	const std::vector<int>& primitive_ids,
+	const RenderTarget& target,
+	RenderStats& stats);
+
+}// namespace raytracing
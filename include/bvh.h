@@ -0,0 +1,161 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <cstdint>
+#include <vector>
+
+#include "maths/frustum.h"
+#include "maths/vector3.h"
+#include "maths/sphere.h"
+#include "maths/aabb3.h"
+#include "maths/ray3.h"
+#include "sphere_store.h"
+#include "ray_packet.h"
+
+// Node of the flat bvh array. Internal nodes have count == 0 and their two
+// childs stored next to each other at left_first and left_first + 1.
+// Leaves have count > 0 and own the spheres [left_first, left_first + count).
+struct BvhNode
+{
+	maths::Vector3f aabb_min;
+	int left_first = 0;
+	maths::Vector3f aabb_max;
+	int count = 0;
+
+	bool is_leaf() const { return count > 0; }
+};
+
+// How the hierarchy is built from the scene spheres
+enum class BvhBuildMethod
+{
+	// Binned surface area heuristic, best traversal speed
+	kSah,
+	// Linear bvh from sorted morton codes, built in parallel for large or moving scenes
+	kLbvh
+};
+
+// Bounding volume hierarchy built with the surface area heuristic
+// or from morton codes, and stored as one contiguous node array
+class Bvh
+{
+public:
+	Bvh() = default;
+	explicit Bvh(int max_leaf_size) : max_leaf_size_(max_leaf_size) {}
+
+	// Build the hierarchy over the given spheres, previous content is discarded
+	void Build(const std::vector<maths::Sphere>& spheres);
+
+	// Build a linear bvh on thread_count threads (0 uses every hardware thread):
+	// morton codes of the centers are radix sorted and the hierarchy is emitted
+	// from the sorted codes, subtrees with at most max_leaf_size spheres become leaves
+	void BuildLbvh(const std::vector<maths::Sphere>& spheres, int thread_count = 0);
+
+	// thread_count is only used by the linear build, 0 uses every hardware thread
+	void Build(const std::vector<maths::Sphere>& spheres, BvhBuildMethod method, int thread_count = 0)
+	{
+		if (method == BvhBuildMethod::kLbvh)
+		{
+			BuildLbvh(spheres, thread_count);
+		}
+		else
+		{
+			Build(spheres);
+		}
+	}
+
+	// Find the closest sphere hit by the ray, sphere_index is the index
+	// of the sphere in the vector given to Build. When visible_nodes is given
+	// the nodes culled by CullFrustum are skipped.
+	bool Intersect(
+		const maths::Ray3& ray,
+		int& sphere_index,
+		float& distance,
+		float max_distance = 1000000.0f,
+		const std::uint8_t* visible_nodes = nullptr) const;
+
+	// Trace every ray of the packet with a single traversal, nodes are
+	// culled against the packet frustum built with RayPacket::BuildFrustum
+	// and against visible_nodes when it is given
+	void IntersectPacket(
+		RayPacket& packet,
+		float max_distance = 1000000.0f,
+		const std::uint8_t* visible_nodes = nullptr) const;
+
+	// Flag the nodes whose box overlaps the frustum with 1 and the others with 0 in
+	// visible_nodes, resized to the node count. The childs of a culled node are not
+	// visited and keep their flag, the traversals never reach them.
+	// Return the number of spheres in the visible leaves.
+	int CullFrustum(const maths::Frustum& frustum, std::vector<std::uint8_t>& visible_nodes) const;
+
+	// Return true as soon as any sphere is hit between min_distance and max_distance
+	bool Occluded(
+		const maths::Ray3& ray,
+		float min_distance,
+		float max_distance) const;
+
+	// Signed distance from point to the nearest sphere surface, sphere_index is set to
+	// its index in the vector given to Build. Nodes further than max_distance are skipped,
+	// when no sphere is nearer max_distance is returned as a lower bound and sphere_index is -1.
+	// When visible_nodes is given only the spheres of the nodes kept by CullFrustum count.
+	float NearestDistance(
+		const maths::Vector3f& point,
+		int& sphere_index,
+		float max_distance = 1000000.0f,
+		const std::uint8_t* visible_nodes = nullptr) const;
+
+	// Use in place a hierarchy built earlier, like one stored in a mapped scene file that
+	// has to stay mapped while the bvh uses it. store holds the spheres in leaf order, the
+	// id of each being its scene index. Return false and leave the bvh empty if the nodes
+	// do not fit the store or its ids are not the scene indices.
+	bool Assign(const BvhNode* nodes, int node_count, const SphereStore& store);
+
+	bool empty() const { return nodes_.empty(); }
+
+	const BvhNode* nodes() const { return nodes_.data(); }
+
+	int node_count() const { return static_cast<int>(nodes_.size()); }
+
+	// Spheres ordered the way the leaves reference them, the id of each
+	// sphere of the store is its index in the vector given to Build
+	const SphereStore& store() const { return store_; }
+
+private:
+	void UpdateNodeBounds(int node_index);
+
+	void Subdivide(int node_index);
+
+	// Return the best SAH cost found for the node and the split to apply
+	float FindBestSplit(const BvhNode& node, int& axis, float& split_position) const;
+
+	int max_leaf_size_ = 4;
+
+	RecordArray<BvhNode> nodes_;
+	SphereStore store_;
+
+	// Only used during the build
+	const std::vector<maths::Sphere>* build_spheres_ = nullptr;
+	std::vector<int> sphere_indices_;
+	std::vector<maths::Vector3f> centroids_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "maths/frustum.h"
+#include "maths/matrix4.h"
+#include "maths/vector3.h"
+
+namespace raytracing {
+
+//Pinhole camera looking down its -Z axis with +Y up. The direction through an image point
+//is a linear function of its pixel coordinates, so the per-column and per-row steps are
+//computed once when the camera changes and no trigonometry is left for the primary rays.
+class Camera {
+public:
+	Camera() { UpdateSteps(); }
+
+	//Set the image size in pixels and the vertical field of view given to the renderers
+	void SetImage(int width, int height, float fov);
+
+	//Place the camera with a camera to world matrix, the columns of its 3x3 part are the
+	//right, up and backward axes and its last column is the position
+	void SetTransform(const maths::Matrix4f& camera_to_world);
+
+	//Place the camera at position looking at target, up only chooses the roll
+	void LookAt(
+		const maths::Vector3f& position,
+		const maths::Vector3f& target,
+		const maths::Vector3f& up = maths::Vector3f(0.0f, 1.0f, 0.0f));
+
+	//Normalized direction of the ray through the image point x, y in pixels
+	maths::Vector3f Direction(float x, float y) const {
+		return (top_left_ + column_step_ * x + row_step_ * y).Normalized();
+	}
+
+	//Normalized directions of the rays through the pixel centers of the block of width x height
+	//pixels starting at x, y, written row after row in the three arrays
+	void BlockDirections(
+		int x,
+		int y,
+		int width,
+		int height,
+		float* direction_x,
+		float* direction_y,
+		float* direction_z) const;
+
+	//Frustum containing every ray through the image, between the near and far distances
+	//along the view direction
+	maths::Frustum ViewFrustum(float near_distance, float far_distance) const;
+
+	const maths::Matrix4f& transform() const { return camera_to_world_; }
+	const maths::Vector3f& position() const { return position_; }
+
+	//Normalized view direction in world space
+	const maths::Vector3f& forward() const { return forward_; }
+
+	//Distance of the image plane in pixels, a camera space point x, y, z with z < 0
+	//is seen at the image point width / 2 + x * f / -z, height / 2 - y * f / -z
+	float focal_length() const { return focal_length_; }
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+	float fov() const { return fov_; }
+
+	//Radius of the pixel footprint one unit away from the camera
+	float pixel_cone() const { return pixel_cone_; }
+
+private:
+	//Recompute the steps after the image or the transform changed
+	void UpdateSteps();
+
+	maths::Matrix4f camera_to_world_ = maths::Matrix4f::identity();
+	maths::Vector3f position_{ 0.0f, 0.0f, 0.0f };
+	maths::Vector3f forward_{ 0.0f, 0.0f, -1.0f };
+	float focal_length_ = 1.0f;
+	int width_ = 1;
+	int height_ = 1;
+	float fov_ = 1.0f;
+	float pixel_cone_ = 0.0f;
+	//Unnormalized direction through the top left corner of the image and
+	//its change for one pixel to the right and one pixel down, in world space
+	maths::Vector3f top_left_;
+	maths::Vector3f column_step_;
+	maths::Vector3f row_step_;
+};
+
+}// namespace raytracing
@@ -0,0 +1,69 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maths/vector3.h"
+#include "render_types.h"
+
+namespace raytracing {
+
+enum class ImageFormat {
+	kPpm,
+	kQoi,
+	kPng
+};
+
+//8 bits RGB pixels, row after row from the top of the image
+struct ImageRgb8 {
+	int width = 0;
+	int height = 0;
+	std::vector<std::uint8_t> pixels;
+};
+
+//Clamp the colors of the target to [0, 255] and truncate them to 8 bits in one pass,
+//the target is not modified
+void ConvertToRgb8(const RenderTarget& target, ImageRgb8& image);
+
+//Format given by the extension of the path (.ppm, .qoi or .png), PPM for any other extension
+ImageFormat ImageFormatFromPath(const std::string& path);
+
+//Binary PPM (P6)
+void EncodePpm(const ImageRgb8& image, std::vector<std::uint8_t>& data);
+
+//QOI, lossless and several times faster to encode than PNG
+void EncodeQoi(const ImageRgb8& image, std::vector<std::uint8_t>& data);
+
+//PNG compressed with fixed Huffman codes, the rows are split in chunks deflated
+//on thread_count threads (0 uses every hardware thread)
+void EncodePng(const ImageRgb8& image, std::vector<std::uint8_t>& data, int thread_count = 0);
+
+//Encode the image in the format of the path extension and write it with one write,
+//return false if the file could not be written
+bool SaveImage(const std::string& path, const ImageRgb8& image, int thread_count = 0);
+
+}// namespace raytracing
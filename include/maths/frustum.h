@@ -38,12 +38,17 @@ public:
 	void calculate_frustum(Vector3f direction, Vector3f position, Vector3f right, 
 		Vector3f up, float near_plane_distance, float far_plane_distance, 
 		degree_t fov_x, radian_t fov_y);
-	// Check if a sphere is inside the frustum
-	bool contains(const Sphere& sphere);
-	// Check if a AABB is inside the frustum
-	bool contains(const AABB3& aabb);
+	// Calculate frustum from the directions of the rays leaving position through the
+	// four corners of the image, the near and far planes are distances along direction
+	void calculate_frustum(Vector3f position, Vector3f direction,
+		Vector3f top_left, Vector3f top_right, Vector3f bottom_left, Vector3f bottom_right,
+		float near_plane_distance, float far_plane_distance);
+	// Check if a sphere is inside or intersects the frustum
+	bool contains(const Sphere& sphere) const;
+	// Check if a AABB is inside or intersects the frustum
+	bool contains(const AABB3& aabb) const;
 	// Check if a point is inside the frustum
-	bool contains(const Vector3f& point);
+	bool contains(const Vector3f& point) const;
 	
 private:
 	std::array<Plane, 6> planes_;
@@ -23,14 +23,15 @@ SOFTWARE.
 */
 
 #include <array>
+#include <cstddef>
 
 #include "maths/vector3.h"
 #include "maths/vector4.h"
 
 namespace maths
 {
-//Class for column-based matrix 4x4
-class Matrix4f
+//Class for column-based matrix 4x4, the columns are loaded as SSE registers when available
+class alignas(16) Matrix4f
 {
 public:
 
@@ -68,9 +69,12 @@ public:
     //This function returns the determinant(float) of the 4x4 matrix
     float determinant() const;
 
-    //This function returns the inverse matrix of the 4x4 matrix
+    //This function returns the inverse matrix of the 4x4 matrix, or the matrix itself if it is singular
     Matrix4f Inverse() const;
 
+    //This function returns the inverse of an affine matrix (last row 0 0 0 1), cheaper than Inverse()
+    Matrix4f InverseAffine() const;
+
     //This function transposes the 4x4 matrix
     Matrix4f Transpose() const;
 
@@ -80,16 +84,38 @@ public:
     //This function returns true if the matrix's determinant is 1 and false otherwise
     bool IsOrthogonal() const;
 
+    //This function transforms a point (w = 1) by the affine part of the matrix, the last row is ignored
+    Vector3f TransformPoint(const Vector3f& point) const;
+
+    //This function transforms a direction (w = 0), the translation and the last row are ignored
+    Vector3f TransformDirection(const Vector3f& direction) const;
+
+    //This function transforms count points like TransformPoint, out can be the same array as in
+    void TransformPoints(const Vector3f* in, Vector3f* out, std::size_t count) const;
+
+    //This function transforms count points stored as separate x, y and z arrays, the outputs can alias the inputs
+    void TransformPoints(const float* in_x, const float* in_y, const float* in_z,
+        float* out_x, float* out_y, float* out_z, std::size_t count) const;
+
+    //This function transforms count directions like TransformDirection, out can be the same array as in
+    void TransformDirections(const Vector3f* in, Vector3f* out, std::size_t count) const;
+
+    //This function transforms count directions stored as separate x, y and z arrays, the outputs can alias the inputs
+    void TransformDirections(const float* in_x, const float* in_y, const float* in_z,
+        float* out_x, float* out_y, float* out_z, std::size_t count) const;
+
     //This function returns the identity matrix 4x4
     static Matrix4f identity();
 
-    //This function returns the rotation matrix 4x4 of the desired angle and given axis.
+    //This function returns the rotation matrix 4x4 of the desired angle around the given axis, laid out in the
+    //columns like the other transforms of the class. An unknown axis returns the zero matrix.
     static Matrix4f rotationMatrix(radian_t angle, char axis);
 
     //This function returns the scaling matrix 4x4 of the desired scaling values for x, y and z axis.
     static Matrix4f scalingMatrix(Vector3f axisValues);
 
-    //This function returns the translation matrix 3x3 of the desired translation values for x, y and z axis.
+    //This function returns the translation matrix 4x4 of the desired translation values for x, y and z axis,
+    //its last column holds the translation.
     static Matrix4f translationMatrix(Vector3f axisValues);
 
 private:
@@ -52,7 +52,7 @@ public:
 	Vector3f point() const { return { point_ }; }
 	Vector3f normal() const { return { normal_ }; }
 	void SetMaterial(Material material) { material_ = material; }
-	Material material() const { return material_; }
+	const Material& material() const { return material_; }
 	
 private:
 	Vector3f point_;
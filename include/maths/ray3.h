@@ -23,9 +23,12 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <cmath>
+
 #include "maths/sphere.h"
 #include "maths/aabb3.h"
 #include "maths/plane.h"
+#include "maths/vector3_simd.h"
 
 namespace maths {
 	
@@ -45,15 +48,95 @@ public:
 
 	// Return true if ray intersect a sphere
 	bool IntersectSphere(const Sphere& sphere, Vector3f& hitPosition, float& distance);
+	// Return true if ray intersect a sphere, only computing the hit distance
+	bool IntersectSphere(const Sphere& sphere, float& distance) const;
 	// Return true if ray intersect a AABB
 	bool IntersectAABB3(const AABB3& aabb);
 	// Return true if ray intersect a plane
 	bool IntersectPlane(const Plane& plane, Vector3f& hitPosition);
 
 private:
+	// Distance along the ray to the point closest to the sphere center,
+	// and the squared distance from the origin to the center
+	void ProjectCenter(const Sphere& sphere, float& projection, float& squared_center_distance) const;
+
 		Vector3f origin_ = {};
 		Vector3f direction_ = {};
 		Vector3f hit_position_;
 };
 
+inline void Ray3::ProjectCenter(const Sphere& sphere, float& projection, float& squared_center_distance) const {
+#if RAYTRACING_SIMD_VECTOR3
+    const SimdVector3f v = SimdVector3f(sphere.center()) - SimdVector3f(origin_);
+    projection = SimdVector3f::Dot(v, SimdVector3f(direction_));
+    squared_center_distance = SimdVector3f::Dot(v, v);
+#else
+    const Vector3f v = sphere.center() - origin_;
+    projection = v.Dot(direction_);
+    squared_center_distance = v.Dot(v);
+#endif
+}
+
+inline bool Ray3::IntersectSphere(const Sphere& sphere, Vector3f& hitPosition, float& distance) {
+    float d; // Distance to closest point to sphere center
+    float squaredCenterDistance;
+    ProjectCenter(sphere, d, squaredCenterDistance);
+    if (d < 0) {
+        return false;
+    }
+
+    const float squaredDistance = squaredCenterDistance - (d * d); // squared Distance between closest point to sphere center
+    const float radius2 = sphere.radius() * sphere.radius();
+    if (squaredDistance > radius2) {
+        return false;
+    }
+
+    const auto q = std::sqrt(radius2 - squaredDistance);
+
+    const auto t0 = d + q;
+    const auto t1 = d - q;
+
+    bool hasHit = false;
+    if (t0 >= 0) {
+        distance = t0;
+        hasHit = true;
+    }
+
+    if (t1 >= 0) {
+        if (!hasHit || t1 < distance) {
+            distance = t1;
+            hasHit = true;
+        }
+    }
+
+    if (!hasHit) {
+        return false;
+    }
+
+    // calculate the position where the ray hit
+    hitPosition = origin_ + direction_ * distance;
+
+    return true;
+}
+
+inline bool Ray3::IntersectSphere(const Sphere& sphere, float& distance) const {
+    float d;
+    float squaredCenterDistance;
+    ProjectCenter(sphere, d, squaredCenterDistance);
+    if (d < 0) {
+        return false;
+    }
+
+    const float squaredDistance = squaredCenterDistance - (d * d);
+    const float radius2 = sphere.radius() * sphere.radius();
+    if (squaredDistance > radius2) {
+        return false;
+    }
+
+    // d >= 0 so d + q is always a valid hit, prefer the entry point
+    const float q = std::sqrt(radius2 - squaredDistance);
+    distance = d - q >= 0 ? d - q : d + q;
+    return true;
+}
+
 } // namespace maths
\ No newline at end of file
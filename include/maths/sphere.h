@@ -25,6 +25,7 @@ SOFTWARE.
 
 #include <math.h>
 #include "maths/vector3.h"
+#include "maths/vector3_simd.h"
 #include "aabb3.h"
 #include "raytracing/material.h"
 
@@ -49,8 +50,12 @@ public:
         return 4 / 3 * pi * (radius_ * radius_ * radius_);
     }
 
-	float sdf(Vector3f point) {
+	float sdf(const Vector3f& point) const {
+#if RAYTRACING_SIMD_VECTOR3
+        return (SimdVector3f(point) - SimdVector3f(center_)).Magnitude() - radius_;
+#else
         return (point - center_).Magnitude() - radius_;
+#endif
     }
 
     void set_radius(float radius) { radius_ = radius; }
@@ -59,7 +64,7 @@ public:
 
     float radius() const { return radius_; }
 
-    Material material() const { return material_; }
+    const Material& material() const { return material_; }
 
     void set_material(Material material) { material_ = material; }
 
@@ -23,12 +23,17 @@ SOFTWARE.
 */
 
 #pragma once
+#include <cmath>
+#include <cstddef>
 #include <cuda_runtime.h>
 #include "maths/angle.h"
+#include "maths/maths_utils.h"
 
 namespace maths {
 /**
  *  \brief Class used to represent a 3D vector.
+ *  The arithmetic is defined in the header so it is inlined in the hot loops of
+ *  every translation unit, and is constexpr except where it needs a square root.
  */
 class Vector3f {
 public:
@@ -42,49 +47,101 @@ public:
         float coord[3]{};
     };
 
-  Vector3f()
+    constexpr Vector3f()
         : x(0),
           y(0),
           z(0) {
     }
 
-	Vector3f(float x, float y, float z);
+    constexpr Vector3f(float x, float y, float z)
+        : x(x),
+          y(y),
+          z(z) {
+    }
 
-    Vector3f operator+(const Vector3f& rhs) const;
+    constexpr Vector3f operator+(const Vector3f& rhs) const {
+        return {x + rhs.x, y + rhs.y, z + rhs.z};
+    }
 
-    Vector3f& operator+=(const Vector3f& rhs);
+    constexpr Vector3f& operator+=(const Vector3f& rhs) {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        return *this;
+    }
 
-    Vector3f operator-(const Vector3f& rhs) const;
+    constexpr Vector3f operator-(const Vector3f& rhs) const {
+        return {x - rhs.x, y - rhs.y, z - rhs.z};
+    }
 
-    Vector3f& operator-=(const Vector3f& rhs);
+    constexpr Vector3f& operator-=(const Vector3f& rhs) {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        return *this;
+    }
 
-    Vector3f operator*(float scalar) const;
+    constexpr Vector3f operator*(float scalar) const {
+        return {x * scalar, y * scalar, z * scalar};
+    }
 
-    Vector3f& operator*=(float scalar);
+    constexpr Vector3f& operator*=(float scalar) {
+        x *= scalar;
+        y *= scalar;
+        z *= scalar;
+        return *this;
+    }
 
-    Vector3f operator/(float scalar) const;
+    constexpr Vector3f operator/(float scalar) const {
+        return {x / scalar, y / scalar, z / scalar};
+    }
 
-    Vector3f& operator/=(float scalar);
+    constexpr Vector3f& operator/=(float scalar) {
+        x /= scalar;
+        y /= scalar;
+        z /= scalar;
+        return *this;
+    }
 
-    bool operator==(const Vector3f& rhs) const;
+    bool operator==(const Vector3f& rhs) const {
+        return Equal(x, rhs.x) && Equal(y, rhs.y) && Equal(z, rhs.z);
+    }
 
-    bool operator!=(const Vector3f& rhs) const;
+    bool operator!=(const Vector3f& rhs) const {
+        return !(*this == rhs);
+    }
 
     // This function does the Dot product of three vectors.
-    float Dot(const Vector3f& v2) const;
+    constexpr float Dot(const Vector3f& v2) const {
+        return Dot(*this, v2);
+    }
 
-    static float Dot(const Vector3f& v1, const Vector3f& v2);
+    static constexpr float Dot(const Vector3f& v1, const Vector3f& v2) {
+        return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+    }
 
     // This function does the Cross product of three vectors.
-    Vector3f Cross(const Vector3f& v2) const;
+    constexpr Vector3f Cross(const Vector3f& v2) const {
+        return Cross(*this, v2);
+    }
 
-    static Vector3f Cross(const Vector3f& v1, const Vector3f& v2);
+    static constexpr Vector3f Cross(const Vector3f& v1, const Vector3f& v2) {
+        return {
+            v1.y * v2.z - v1.z * v2.y,
+            v1.z * v2.x - v1.x * v2.z,
+            v1.x * v2.y - v1.y * v2.x
+        };
+    }
 
     // This function calculates the norm.
-	float Magnitude() const;
+    float Magnitude() const {
+        return std::sqrt(SqrMagnitude());
+    }
 
     // This function calculates the squared length of a vector.
-	float SqrMagnitude() const;
+    constexpr float SqrMagnitude() const {
+        return x * x + y * y + z * z;
+    }
 
     // This function calculates the angle between two vectors.
     radian_t AngleBetween(const Vector3f& v2) const;
@@ -92,22 +149,41 @@ public:
     static radian_t AngleBetween(const Vector3f& v1, const Vector3f& v2);
 
     // Allows to read value at index.
-    float operator[](std::size_t index) const;
+    float operator[](std::size_t index) const {
+        return coord[index];
+    }
 
     // Allows to write value at index.
-	float& operator[](std::size_t index);
+    float& operator[](std::size_t index) {
+        return coord[index];
+    }
 
     // This function makes a vector have a magnitude of 1.
-    Vector3f Normalized() const;
+    Vector3f Normalized() const {
+        const float magnitude = Magnitude();
+        if (Equal(magnitude, 0)) {
+            return Vector3f(0, 0, 0);
+        }
+        return {x / magnitude, y / magnitude, z / magnitude};
+    }
 
-   void Normalize();
+    void Normalize() {
+        const float magnitude = Magnitude();
+        x /= magnitude;
+        y /= magnitude;
+        z /= magnitude;
+    }
 
     // The function Lerp linearly interpolates between two points.
-    Vector3f Lerp(const Vector3f& v2, float t) const;
+    constexpr Vector3f Lerp(const Vector3f& v2, float t) const {
+        return Lerp(*this, v2, t);
+    }
 
-   static Vector3f Lerp(const Vector3f& v1, const Vector3f& v2, float t);
+    static constexpr Vector3f Lerp(const Vector3f& v1, const Vector3f& v2, float t) {
+        return v1 + (v2 - v1) * t;
+    }
 
     // The function Slerp spherically interpolates between two vectors.
-   Vector3f Slerp(Vector3f& v2, float t) const;
+    Vector3f Slerp(Vector3f& v2, float t) const;
 };
 } // namespace maths
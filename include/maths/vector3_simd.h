@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATHS_SIMD_VECTOR3_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "maths/vector3.h"
+
+//Set RAYTRACING_SIMD_VECTOR3 to 1 to compute Ray3::IntersectSphere and Sphere::sdf with SimdVector3f
+#ifndef RAYTRACING_SIMD_VECTOR3
+#define RAYTRACING_SIMD_VECTOR3 0
+#endif
+
+namespace maths {
+/**
+ *  \brief 3D vector held in one 16 bytes aligned SSE register, the fourth lane stays 0.
+ *  Opt-in for hot kernels that convert at their boundaries: Vector3f keeps its
+ *  12 bytes layout so the buffers, packed records and files storing it are unchanged.
+ *  Falls back to scalar code on targets without SSE2.
+ */
+class alignas(16) SimdVector3f {
+public:
+#if defined(MATHS_SIMD_VECTOR3_SSE2)
+    SimdVector3f() : value_(_mm_setzero_ps()) {}
+
+    SimdVector3f(float x, float y, float z) : value_(_mm_set_ps(0.0f, z, y, x)) {}
+
+    explicit SimdVector3f(const Vector3f& vector) : SimdVector3f(vector.x, vector.y, vector.z) {}
+
+    explicit SimdVector3f(__m128 value) : value_(value) {}
+
+    __m128 value() const { return value_; }
+
+    float x() const { return _mm_cvtss_f32(value_); }
+
+    float y() const { return _mm_cvtss_f32(_mm_shuffle_ps(value_, value_, _MM_SHUFFLE(1, 1, 1, 1))); }
+
+    float z() const { return _mm_cvtss_f32(_mm_shuffle_ps(value_, value_, _MM_SHUFFLE(2, 2, 2, 2))); }
+
+    SimdVector3f operator+(const SimdVector3f& rhs) const { return SimdVector3f(_mm_add_ps(value_, rhs.value_)); }
+
+    SimdVector3f operator-(const SimdVector3f& rhs) const { return SimdVector3f(_mm_sub_ps(value_, rhs.value_)); }
+
+    SimdVector3f operator*(float scalar) const { return SimdVector3f(_mm_mul_ps(value_, _mm_set1_ps(scalar))); }
+
+    SimdVector3f operator/(float scalar) const { return SimdVector3f(_mm_div_ps(value_, _mm_set1_ps(scalar))); }
+
+    // Dot product broadcast to every lane, avoids leaving the register in chained math
+    static __m128 DotSplat(const SimdVector3f& v1, const SimdVector3f& v2) {
+        const __m128 product = _mm_mul_ps(v1.value_, v2.value_);
+        const __m128 sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+
+    static float Dot(const SimdVector3f& v1, const SimdVector3f& v2) { return _mm_cvtss_f32(DotSplat(v1, v2)); }
+
+    static SimdVector3f Cross(const SimdVector3f& v1, const SimdVector3f& v2) {
+        const __m128 a_yzx = _mm_shuffle_ps(v1.value_, v1.value_, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 b_yzx = _mm_shuffle_ps(v2.value_, v2.value_, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 c = _mm_sub_ps(_mm_mul_ps(v1.value_, b_yzx), _mm_mul_ps(a_yzx, v2.value_));
+        return SimdVector3f(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1)));
+    }
+
+    float Magnitude() const { return _mm_cvtss_f32(_mm_sqrt_ss(DotSplat(*this, *this))); }
+
+    // Same result as Vector3f::Normalized, a zero vector stays zero
+    SimdVector3f Normalized() const {
+        const __m128 magnitude = _mm_sqrt_ps(DotSplat(*this, *this));
+        if (_mm_cvtss_f32(magnitude) < 0.0000001f) {
+            return SimdVector3f();
+        }
+        return SimdVector3f(_mm_div_ps(value_, magnitude));
+    }
+
+    Vector3f ToVector3f() const {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, value_);
+        return {lanes[0], lanes[1], lanes[2]};
+    }
+
+private:
+    __m128 value_;
+#else
+    SimdVector3f() = default;
+
+    SimdVector3f(float x, float y, float z) : value_(x, y, z) {}
+
+    explicit SimdVector3f(const Vector3f& vector) : value_(vector) {}
+
+    float x() const { return value_.x; }
+
+    float y() const { return value_.y; }
+
+    float z() const { return value_.z; }
+
+    SimdVector3f operator+(const SimdVector3f& rhs) const { return SimdVector3f(value_ + rhs.value_); }
+
+    SimdVector3f operator-(const SimdVector3f& rhs) const { return SimdVector3f(value_ - rhs.value_); }
+
+    SimdVector3f operator*(float scalar) const { return SimdVector3f(value_ * scalar); }
+
+    SimdVector3f operator/(float scalar) const { return SimdVector3f(value_ / scalar); }
+
+    static float Dot(const SimdVector3f& v1, const SimdVector3f& v2) { return Vector3f::Dot(v1.value_, v2.value_); }
+
+    static SimdVector3f Cross(const SimdVector3f& v1, const SimdVector3f& v2) {
+        return SimdVector3f(Vector3f::Cross(v1.value_, v2.value_));
+    }
+
+    float Magnitude() const { return value_.Magnitude(); }
+
+    SimdVector3f Normalized() const { return SimdVector3f(value_.Normalized()); }
+
+    Vector3f ToVector3f() const { return value_; }
+
+private:
+    Vector3f value_;
+#endif
+};
+} // namespace maths
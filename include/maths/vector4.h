@@ -23,11 +23,15 @@ SOFTWARE.
 */
 
 #pragma once
+#include <cmath>
+#include <cstddef>
 #include "maths/angle.h"
+#include "maths/maths_utils.h"
 
 namespace maths {
 /**
  *  \brief Class used to represent a 4D vector.
+ *  Defined in the header like Vector3f so its arithmetic is inlined and constexpr.
  */
 class Vector4f {
 public:
@@ -42,60 +46,130 @@ public:
         float coord[4]{};
     };
 
-    Vector4f()
+    constexpr Vector4f()
         : x(0),
           y(0),
           z(0),
           w(1) {
     }
 
-    Vector4f(float x, float y, float z, float w);
+    constexpr Vector4f(float x, float y, float z, float w)
+        : x(x),
+          y(y),
+          z(z),
+          w(w) {
+    }
 
-    Vector4f operator+(const Vector4f& rhs) const;
+    constexpr Vector4f operator+(const Vector4f& rhs) const {
+        return {x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w};
+    }
 
-    Vector4f& operator+=(const Vector4f& rhs);
+    constexpr Vector4f& operator+=(const Vector4f& rhs) {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        w += rhs.w;
+        return *this;
+    }
 
-    Vector4f operator-(const Vector4f& rhs) const;
+    constexpr Vector4f operator-(const Vector4f& rhs) const {
+        return {x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w};
+    }
 
-    Vector4f& operator-=(const Vector4f& rhs);
+    constexpr Vector4f& operator-=(const Vector4f& rhs) {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        w -= rhs.w;
+        return *this;
+    }
 
-    Vector4f operator*(float scalar) const;
+    constexpr Vector4f operator*(float scalar) const {
+        return {x * scalar, y * scalar, z * scalar, w * scalar};
+    }
 
-    Vector4f& operator*=(float scalar);
+    constexpr Vector4f& operator*=(float scalar) {
+        x *= scalar;
+        y *= scalar;
+        z *= scalar;
+        w *= scalar;
+        return *this;
+    }
 
-    Vector4f operator/(float scalar) const;
+    constexpr Vector4f operator/(float scalar) const {
+        return {x / scalar, y / scalar, z / scalar, w / scalar};
+    }
 
-    Vector4f& operator/=(float scalar);
+    constexpr Vector4f& operator/=(float scalar) {
+        x /= scalar;
+        y /= scalar;
+        z /= scalar;
+        w /= scalar;
+        return *this;
+    }
 
-    bool operator==(const Vector4f& rhs) const;
+    bool operator==(const Vector4f& rhs) const {
+        return Equal(x, rhs.x) && Equal(y, rhs.y) &&
+               Equal(z, rhs.z) && Equal(w, rhs.w);
+    }
 
-    bool operator!=(const Vector4f& rhs) const;
+    bool operator!=(const Vector4f& rhs) const {
+        return !(*this == rhs);
+    }
 
     // This function does the Dot product of four vectors.
-    float Dot(const Vector4f& v2) const;
+    constexpr float Dot(const Vector4f& v2) const {
+        return Dot(*this, v2);
+    }
 
-    static float Dot(const Vector4f& v1, const Vector4f& v2);
+    static constexpr float Dot(const Vector4f& v1, const Vector4f& v2) {
+        return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+    }
 
     // This function calculates the norm.
-    float Magnitude() const;
+    float Magnitude() const {
+        return std::sqrt(SqrMagnitude());
+    }
 
     // This function calculates the squared length of a vector.
-    float SqrMagnitude() const;
+    constexpr float SqrMagnitude() const {
+        return x * x + y * y + z * z + w * w;
+    }
 
     // Allows to read value at index.
-    float operator[](std::size_t index) const;
+    float operator[](std::size_t index) const {
+        return coord[index];
+    }
 
     // Allows to write value at index.
-    float& operator[](std::size_t index);
+    float& operator[](std::size_t index) {
+        return coord[index];
+    }
 
     // This function makes a vector have a magnitude of 1.
-    Vector4f Normalized() const;
+    Vector4f Normalized() const {
+        const float magnitude = Magnitude();
+        if (Equal(magnitude, 0)) {
+            return Vector4f(0, 0, 0, 0);
+        }
+        return {x / magnitude, y / magnitude, z / magnitude, w / magnitude};
+    }
 
-    void Normalize();
+    void Normalize() {
+        const float magnitude = Magnitude();
+        x /= magnitude;
+        y /= magnitude;
+        z /= magnitude;
+        w /= magnitude;
+    }
 
     // The function Lerp linearly interpolates between two points.
-    Vector4f Lerp(const Vector4f& v2, float t) const;
+    constexpr Vector4f Lerp(const Vector4f& v2, float t) const {
+        return Lerp(*this, v2, t);
+    }
 
-    static Vector4f Lerp(const Vector4f& v1, const Vector4f& v2, float t);
+    static constexpr Vector4f Lerp(const Vector4f& v1, const Vector4f& v2, float t) {
+        return v1 + (v2 - v1) * t;
+    }
 };
 } // namespace maths
@@ -30,6 +30,7 @@ SOFTWARE.
 #include "maths/aabb3.h"
 #include "maths/ray3.h"
 #include "maths/contact3.h"
+#include "sphere_table.h"
 
 class Octree
 {
@@ -37,17 +38,35 @@ public :
 	Octree() = default;
 	Octree(int max_sphere_number, int max_depth, maths::AABB3& AABB, int depth) : octree_aabb_(AABB), max_spheres_number_(max_sphere_number), max_depth_(max_depth), depth_(depth) {}
 
-	void Insert(const maths::Sphere& sphere);
+	// The octree only stores indices in the spheres array, the queries take
+	// the packed geometry of the same spheres in the same order
+	void Insert(const std::vector<maths::Sphere>& spheres, int sphere_index);
 
-	void Split();
+	void Split(const std::vector<maths::Sphere>& spheres);
 
-	std::vector<maths::Sphere> Retrieve_spheres( maths::Ray3 ray);
+	std::vector<int> Retrieve_spheres( maths::Ray3 ray);
 
-	void Retrieve_2(maths::Ray3 ray, std::vector<maths::Sphere>& spheres_to_check);
+	void Retrieve_2(maths::Ray3 ray, std::vector<int>& spheres_to_check);
+
+	// Find the index of the closest sphere hit by the ray, visiting the childs
+	// front to back and testing the spheres in place
+	bool ClosestHit(
+		const maths::Ray3& ray,
+		const PackedSphere* spheres,
+		int& sphere_index,
+		float& distance,
+		float max_distance = 1000000.0f) const;
+
+	// Return true as soon as any sphere is hit between min_distance and max_distance
+	bool Occluded(
+		const maths::Ray3& ray,
+		const PackedSphere* spheres,
+		float min_distance,
+		float max_distance) const;
 
 	bool has_split() const { return has_split_; }
 
-	std::vector<maths::Sphere> spheres() const { return spheres_; }
+	const std::vector<int>& sphere_indices() const { return sphere_indices_; }
 
 	maths::AABB3 aabb() const { return octree_aabb_; }
 
@@ -55,6 +74,20 @@ public :
 
 	
 private:
+	void ClosestHitRecursive(
+		const maths::Ray3& ray,
+		const maths::Vector3f& inv_direction,
+		const PackedSphere* spheres,
+		int& sphere_index,
+		float& best_distance) const;
+
+	bool OccludedRecursive(
+		const maths::Ray3& ray,
+		const maths::Vector3f& inv_direction,
+		const PackedSphere* spheres,
+		float min_distance,
+		float max_distance) const;
+
 	maths::AABB3 octree_aabb_ = {};
 	int depth_ = 1;
 	int max_spheres_number_ = 3;
@@ -62,5 +95,5 @@ private:
 	bool has_split_ = false;
 	
 	std::vector<Octree> childs_;
-	std::vector<maths::Sphere> spheres_;
+	std::vector<int> sphere_indices_;
 };
\ No newline at end of file
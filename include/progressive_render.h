@@ -0,0 +1,80 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <functional>
+#include <vector>
+
+#include "maths/vector3.h"
+#include "render_scheduler.h"
+#include "render_stats.h"
+#include "render_types.h"
+
+namespace raytracing {
+
+//When a progressive render stops, the first limit reached ends it
+struct ProgressiveSettings {
+	//Samples per pixel accumulated before stopping
+	int target_samples = 16;
+	//Wall time after which no new pass is started, 0 has no time limit
+	double time_budget_seconds = 0.0;
+	//Start with passes tracing one sample per block of 8, 4 then 2 pixels
+	bool preview_passes = true;
+};
+
+//State of the render target after a pass, given to the pass callback
+struct ProgressivePass {
+	int index = 0;
+	//Width and height of the pixel blocks sharing one sample, 1 once every pixel is sampled
+	int block_size = 1;
+	//Samples accumulated in every pixel, 0 during the preview passes
+	int samples = 0;
+	double elapsed_seconds = 0.0;
+};
+
+using ProgressiveCallback = std::function<void(const ProgressivePass& pass, const RenderTarget& target)>;
+
+//Sub-pixel position in [0, 1) of a sample, the first one is the pixel center and the next
+//ones follow the R2 low discrepancy sequence so any number of samples covers the pixel
+void SampleOffset(int sample, float& offset_x, float& offset_y);
+
+//Color of the primary ray through the image point x, y in pixels
+using SampleFunction = std::function<maths::Vector3f(float x, float y)>;
+
+//Render successive passes into the target: the preview passes first, then one sample
+//per pixel and per pass accumulated and averaged. The first sample goes through the pixel
+//centers like Render, the next ones are spread over the pixels to anti-alias the edges.
+//on_pass is called after every pass, stats covers the whole render.
+//Return the samples accumulated per pixel.
+int RenderProgressive(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const SampleFunction& trace_sample,
+	const ProgressiveSettings& settings,
+	const ProgressiveCallback& on_pass,
+	const RenderTarget& target,
+	RenderStats& stats);
+
+}// namespace raytracing
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <array>
+
+#include "maths/vector3.h"
+
+// Group of up to 8x8 coherent rays sharing the same origin, stored as
+// structure of arrays so the rays can be processed in simd lanes
+struct RayPacket
+{
+	static constexpr int kMaxRays = 64;
+
+	// Set the shared origin and forget the previous rays
+	void Reset(const maths::Vector3f& packet_origin);
+
+	// Add a normalized direction, return the lane of the ray
+	int Add(const maths::Vector3f& direction);
+
+	// Build the four side planes of the packet from its corner rays.
+	// Return false when the rays diverge too much to be traced together.
+	bool BuildFrustum(
+		const maths::Vector3f& top_left,
+		const maths::Vector3f& top_right,
+		const maths::Vector3f& bottom_left,
+		const maths::Vector3f& bottom_right);
+
+	// Return false only if the box is completely outside the packet frustum
+	bool FrustumOverlaps(const maths::Vector3f& aabb_min, const maths::Vector3f& aabb_max) const;
+
+	maths::Vector3f direction(int lane) const { return { direction_x[lane], direction_y[lane], direction_z[lane] }; }
+
+	maths::Vector3f origin;
+	// Direction of the middle of the packet, used to order the traversal
+	maths::Vector3f center_direction;
+	int ray_count = 0;
+
+	alignas(32) float direction_x[kMaxRays];
+	alignas(32) float direction_y[kMaxRays];
+	alignas(32) float direction_z[kMaxRays];
+
+	// Results of the traversal, sphere_index is -1 when nothing was hit
+	alignas(32) float distance[kMaxRays];
+	alignas(32) int sphere_index[kMaxRays];
+
+	std::array<maths::Vector3f, 4> frustum_normals;
+};
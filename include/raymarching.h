@@ -23,24 +23,38 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "maths/vector3.h"
 #include "maths/sphere.h"
 #include "maths/ray3.h"
 #include "maths/plane.h"
+#include "bvh.h"
+#include "sdf_brick_cache.h"
+#include "adaptive_sampling.h"
+#include "camera.h"
+#include "image_output.h"
+#include "progressive_render.h"
+#include "render_scheduler.h"
+#include "render_stats.h"
+#include "render_types.h"
+#include "scene_file.h"
+#include "sphere_table.h"
 
 namespace raytracing {
 
-	struct PointLight {
-		maths::Vector3f position{ 10.0f,10.0f,0.0f };
-	};
-
-	struct HitInfos
-	{
-		maths::Vector3f normal;
-		maths::Vector3f hit_position;
-		float distance;
+	//How the closest hit is searched along the rays
+	enum class MarchMethod {
+		//Steps of the scene distance until it is below a fixed threshold
+		kSphereTracing,
+		//Over-relaxed steps that fall back to plain steps on overshoot,
+		//the hit threshold grows with the pixel footprint along the ray
+		kRelaxed
 	};
 
 	class RayMarcher {
@@ -56,63 +70,242 @@ namespace raytracing {
 			const float& fov,
 			const double& bias)
 		{
-			spheres_ = spheres;
-			planes_ = planes;
-			light_ = light;
-			height_ = height;
-			width_ = width;
-			fov_ = fov;
-			int total = width_ * height_;
-			frame_buffer_ = std::vector<maths::Vector3f>(total);
-			bias_ = bias;
+			SetSceneParameters(spheres, planes, light, height, width, fov, bias);
+			scene_bvh_.Build(spheres, bvh_build_method_, scheduler_.thread_count());
 		}
 
+		//Set the scene of a scene file and use the bvh stored in it, the bvh is rebuilt
+		//if the file has none or a stale one. Return false if the file is not a valid scene file.
+		bool LoadScene(const std::string& path);
+
+		//Write the scene and its bvh into a scene file, return false if it could not be written
+		bool SaveScene(const std::string& path) const;
+
+		//Bake the scene distance into a sparse brick cache for static scenes rendered
+		//many times, marching then only evaluates the exact distance near the surfaces.
+		//The cache is cleared by SetScene.
+		void BakeDistanceCache(float cell_size, int brick_resolution = 8);
+
+		void ClearDistanceCache() { distance_cache_.Clear(); }
+
+		const SdfBrickCache& distance_cache() const { return distance_cache_; }
+
 		//Cast a shadow ray to check intersection with objects and render shadows
 		bool ShadowRay(
 			const maths::Vector3f& hit_position,
 			const maths::Vector3f& hit_normal,
 			const maths::Vector3f& light_normal);
 
+		//Return true if the march hits an object between the bias and max_distance,
+		//without resolving the hit sphere or its material
+		bool Occluded(
+			const maths::Vector3f& origin,
+			const maths::Vector3f& direction,
+			float max_distance);
+
 		//Calculate reflexion direction for the reflexion ray
 		maths::Vector3f Reflect(
 			const maths::Vector3f& ray_direction,
 			const maths::Vector3f& hit_normal);
 
-		//Base raytracing function that will start raytracing rendering
+		//Base raytracing function that will start raytracing rendering, into the frame buffer
 		void Render();
 
-		//Write scene result into a .ppm image
-		void WriteImage();
+		//Render into pixels owned by the caller, nothing is rendered and false is returned
+		//if the target is smaller than the scene image
+		bool Render(const RenderTarget& target);
+
+		//Render successive passes refining the frame buffer until the target samples or the
+		//time budget is reached, on_pass is called after every pass with the current image.
+		//The cone prepass is not used. Return the samples accumulated per pixel.
+		int RenderProgressive(const ProgressiveSettings& settings, const ProgressiveCallback& on_pass = nullptr);
+
+		//RenderProgressive into pixels owned by the caller, return 0 if the target is too small
+		int RenderProgressive(
+			const RenderTarget& target,
+			const ProgressiveSettings& settings,
+			const ProgressiveCallback& on_pass = nullptr);
+
+		//Write the last rendered image at the output path, return false if it could not be written.
+		//A caller owned target must still be alive.
+		bool WriteImage();
 		
+		//March from start_depth, the ray must not hit anything before it.
+		//Only the primitive id, hit position and distance of hit_infos are set.
+		//When visible_nodes is given only the spheres of those bvh nodes are marched.
 		float ClosestDistance(
 			maths::Ray3 ray, 
 			HitInfos& hit_infos, 
-			Material& hit_material);
+			float start_depth = 0.0f,
+			const std::uint8_t* visible_nodes = nullptr);
 
 		maths::Vector3f RayMarching(
 			maths::Vector3f ray_origin, 
 			maths::Vector3f ray_direction, 
-			const int& depth = 0);
+			const int& depth = 0,
+			float start_depth = 0.0f);
 
+		//Distance to the closest sphere and its index, -1 without spheres. Only the
+		//spheres of the bvh nodes that can be nearer than the best distance are evaluated
 		float SceneSDF(
 			maths::Vector3f position, 
-			maths::Sphere& closest_sphere);
+			int& sphere_index);
+
+		//Distance to the closest sphere without keeping track of which one it is
+		float SceneSDF(maths::Vector3f position);
+
+		//Image of the last Render without a target
+		const std::vector<maths::Vector3f>& frameBuffer() const { return frame_buffer_; }
+
+		//Scheduler splitting the image in tiles, to set the thread count and tile size
+		RenderScheduler& scheduler() { return scheduler_; }
+
+		//Camera of the primary rays, at the origin looking down -Z until it is moved.
+		//SetScene keeps its position and orientation and only changes its image.
+		Camera& camera() { return camera_; }
+		const Camera& camera() const { return camera_; }
+
+		//Deepest reflection ray that is still marched, 0 only marches the primary rays
+		void set_max_depth(int max_depth) { max_depth_ = max_depth; }
+
+		//Choose how ClosestDistance steps along the rays, factor is the over-relaxation
+		//of kRelaxed, between 1 (plain steps) and 2
+		void set_march_method(MarchMethod method, float factor = 1.6f)
+		{
+			march_method_ = method;
+			over_relaxation_ = std::min(std::max(factor, 1.0f), 2.0f);
+		}
+
+		//March cones covering blocks of 8x8 then 4x4 pixels before the primary rays,
+		//the primary rays then start from the depth their block cone reached
+		void set_cone_prepass(bool cone_prepass) { cone_prepass_ = cone_prepass; }
+
+		//Anti-alias Render by refining the pixels on edges, max_samples 1 disables it
+		void set_adaptive_sampling(const AdaptiveSamplingSettings& settings) { adaptive_sampling_ = settings; }
+
+		//Cull the bvh nodes outside the camera frustum before every frame, only the
+		//primary rays and the cones of the prepass skip them
+		void set_frustum_culling(bool frustum_culling) { frustum_culling_ = frustum_culling; }
+
+		//Choose how the next SetScene builds the bvh, kLbvh builds large scenes in parallel
+		void set_bvh_build_method(BvhBuildMethod method) { bvh_build_method_ = method; }
+
+		//Render writes the image to the output path when enabled
+		void set_write_image(bool write_image) { write_image_ = write_image; }
 
-		std::vector<maths::Vector3f> frameBuffer() const { return frame_buffer_; }
+		//Path of the image written by WriteImage, its extension chooses the format (.ppm, .qoi or .png)
+		void set_output_path(const std::string& output_path) { output_path_ = output_path; }
+
+		//Timings and counters of the last Render
+		const RenderStats& stats() const { return stats_; }
 
 	private:
+		void SetSceneParameters(
+			const std::vector<maths::Sphere>& spheres,
+			const std::vector<maths::Plane>& planes,
+			const PointLight light,
+			const int& height,
+			const int& width,
+			const float& fov,
+			const double& bias)
+		{
+			spheres_.Assign(spheres);
+			planes_ = planes;
+			light_ = light;
+			SetImageParameters(height, width, fov, bias);
+		}
+
+		void SetImageParameters(int height, int width, float fov, double bias)
+		{
+			height_ = height;
+			width_ = width;
+			camera_.SetImage(width_, height_, fov);
+			primitive_ids_.resize(width_ * height_);
+			bias_ = bias;
+			distance_cache_.Clear();
+		}
+
+		//ClosestDistance with over-relaxed steps and a pixel footprint hit threshold
+		float RelaxedClosestDistance(
+			const maths::Ray3& ray,
+			HitInfos& hit_infos,
+			float start_depth,
+			const std::uint8_t* visible_nodes);
+
+		//Color of a hit found by ClosestDistance, resolving its normal and material
+		//and casting the shadow and reflexion rays
+		maths::Vector3f ShadeHit(
+			const maths::Vector3f& ray_direction,
+			HitInfos& hit_infos,
+			const int& depth);
+
+		//March the primary ray through the image point x, y in pixels from start_depth
+		PixelSample PrimarySample(float x, float y, float start_depth = 0.0f);
+
+		//March a primary ray leaving the camera in the normalized direction from start_depth
+		PixelSample MarchPrimary(const maths::Vector3f& ray_direction, float start_depth);
+
+		//Flag the bvh nodes the primary rays of the next frame can reach
+		void CullPrimaryNodes();
+
+		//Render a block of at most 8x8 pixels whose rays all start from start_depth
+		void RenderBlock(int x, int y, int block_width, int block_height, float start_depth);
+
+		//Depth along the primary rays of the block of pixels before which none of them
+		//hits anything, the cone march starts after start_depth that is already known empty
+		float ConeStartDepth(int x, int y, int block_width, int block_height, float start_depth) const;
+
+		//Target of the frame buffer, allocated on the first render that uses it
+		RenderTarget FrameBufferTarget();
+
+		//Return false if the target cannot hold the image, otherwise render into it
+		bool SetTarget(const RenderTarget& target);
+
+		//Distance used as marching step: the baked lower bound far from the surfaces,
+		//the exact distance otherwise. sphere_index is -1 when the bound is used.
+		//Only the spheres of visible_nodes count when it is given.
+		float SceneDistance(
+			const maths::Vector3f& position,
+			int& sphere_index,
+			float max_distance,
+			const std::uint8_t* visible_nodes = nullptr) const;
+
 		maths::Vector3f background_color_{ 150.0f,200.0f,255.0f };
-		std::vector<maths::Sphere> spheres_;
+		//Geometry and material ids of the spheres, the primitive ids index it
+		SphereTable spheres_;
 		std::vector<maths::Plane> planes_;
 		PointLight light_;
 		int height_;
 		int width_;
-		float fov_;
+		Camera camera_;
 		std::vector<maths::Vector3f> frame_buffer_;
+		//Pixels written by the current render, the frame buffer or a caller owned target
+		RenderTarget target_;
+		//Sphere hit by the primary ray of every pixel, -1 for the background
+		std::vector<int> primitive_ids_;
 		double bias_;
+		Bvh scene_bvh_;
+		//Last loaded scene file, the spheres and the bvh may use its records in place
+		std::unique_ptr<MappedSceneFile> scene_file_;
+		bool frustum_culling_ = true;
+		//Bvh nodes inside the camera frustum, nullptr when the primary rays see every node
+		std::vector<std::uint8_t> visible_nodes_;
+		const std::uint8_t* primary_nodes_ = nullptr;
+		BvhBuildMethod bvh_build_method_ = BvhBuildMethod::kSah;
+		SdfBrickCache distance_cache_;
 		float min_distance_ = 0.00f;
 		float max_distance_ = 500.0f;
 		int max_marching_steps_ = 255;
+		MarchMethod march_method_ = MarchMethod::kSphereTracing;
+		float over_relaxation_ = 1.6f;
+		bool cone_prepass_ = false;
+		AdaptiveSamplingSettings adaptive_sampling_;
+		std::string output_path_ = "./ray_marching_image.ppm";
+		ImageRgb8 image_;
+		int max_depth_ = 3;
+		bool write_image_ = true;
+		RenderScheduler scheduler_;
+		RenderStats stats_;
 	};
 
 }// namespace raytracing
\ No newline at end of file
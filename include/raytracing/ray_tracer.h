@@ -23,6 +23,9 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "maths/vector3.h"
@@ -30,20 +33,20 @@ SOFTWARE.
 #include "maths/ray3.h"
 #include "maths/plane.h"
 #include "octree.h"
+#include "bvh.h"
+#include "adaptive_sampling.h"
+#include "camera.h"
+#include "image_output.h"
+#include "progressive_render.h"
+#include "render_scheduler.h"
+#include "render_stats.h"
+#include "render_types.h"
+#include "scene_file.h"
+#include "sphere_bins.h"
+#include "sphere_table.h"
 
 namespace raytracing {
 
-struct PointLight {
-	maths::Vector3f position{ 10.0f,10.0f,0.0f };
-};
-
-struct HitInfos
-{
-	maths::Vector3f normal;
-	maths::Vector3f hit_position;
-	float distance;
-};
-
 class RayTracer {
 public:
 	RayTracer() = default;
@@ -58,29 +61,53 @@ public:
 		const Octree scene_octree	
 	)
 	{
-		spheres_ = spheres;
-		light_ = light;
-		height_ = height;
-		width_ = width;
-		fov_ = fov;
-		int total = width_ * height_;
-		frame_buffer_.resize(total);
-		bias_ = bias;
+		SetSceneParameters(spheres, light, height, width, fov, bias);
 		scene_octree_ = scene_octree;
+		use_bvh_ = false;
+	}
+
+	//Set bases value and build a bvh over the spheres instead of using an octree
+	void SetScene(
+		std::vector<maths::Sphere>& spheres,
+		const PointLight light,
+		const int& height,
+		const int& width,
+		const float& fov,
+		const double& bias
+	)
+	{
+		SetSceneParameters(spheres, light, height, width, fov, bias);
+		scene_bvh_.Build(spheres, bvh_build_method_, scheduler_.thread_count());
+		use_bvh_ = true;
 	}
 
+	//Set the scene of a scene file and use the bvh stored in it, the bvh is rebuilt
+	//if the file has none or a stale one. Return false if the file is not a valid scene file.
+	bool LoadScene(const std::string& path);
+
+	//Write the scene and its bvh into a scene file, return false if it could not be written
+	bool SaveScene(const std::string& path) const;
+
 	//Cast ray for each pixel to check collision and render objects
 	maths::Vector3f RayCast(
 		const maths::Vector3f& origin,
 		const maths::Vector3f& ray_direction,
 		const int& depth = 0);
 
-	//Check intersection between the ray and each object in the scene
+	//Compute the color of a resolved hit point, casting shadow and reflexion rays
+	maths::Vector3f Shade(
+		const maths::Vector3f& ray_direction,
+		const HitInfos& hit_info,
+		const int& depth);
+
+	//Find the closest object hit by the ray, only the primitive id and
+	//the distance of hit_infos are set
 	bool ObjectIntersect(
-		maths::Ray3& ray, 
-		Material& hit_material, 
-		HitInfos& hit_infos, 
-		float& distance);
+		const maths::Ray3& ray, 
+		HitInfos& hit_infos);
+
+	//Compute the hit position and normal of the primitive found by ObjectIntersect
+	void ResolveHit(const maths::Ray3& ray, HitInfos& hit_infos) const;
 
 	//Cast a shadow ray to check intersection with objects and render shadows
 	bool ShadowRay(
@@ -88,30 +115,167 @@ public:
 		const maths::Vector3f& hit_normal, 
 		const maths::Vector3f& light_normal);
 		
+	//Return true if any object is hit between the bias and max_distance,
+	//without computing hit informations
+	bool Occluded(
+		const maths::Vector3f& origin,
+		const maths::Vector3f& direction,
+		float max_distance);
+
 	//Calculate reflexion direction for the reflexion ray
 	maths::Vector3f Reflect(
 		const maths::Vector3f& ray_direction, 
 		const maths::Vector3f& hit_normal);
 
-	//Base raytracing function that will start raytracing rendering
+	//Base raytracing function that will start raytracing rendering, into the frame buffer
 	void Render();
 
-	//Write scene result into a .ppm image
-	void WriteImage();
+	//Render into pixels owned by the caller, nothing is rendered and false is returned
+	//if the target is smaller than the scene image
+	bool Render(const RenderTarget& target);
+
+	//Render successive passes refining the frame buffer until the target samples or the
+	//time budget is reached, on_pass is called after every pass with the current image.
+	//Return the samples accumulated per pixel.
+	int RenderProgressive(const ProgressiveSettings& settings, const ProgressiveCallback& on_pass = nullptr);
+
+	//RenderProgressive into pixels owned by the caller, return 0 if the target is too small
+	int RenderProgressive(
+		const RenderTarget& target,
+		const ProgressiveSettings& settings,
+		const ProgressiveCallback& on_pass = nullptr);
+
+	//Set the width and height of the primary ray packets (1, 4 or 8),
+	//packets are only used with the bvh, 1 traces every ray on its own
+	void set_packet_size(int packet_size) { packet_size_ = packet_size < 4 ? 1 : (packet_size < 8 ? 4 : 8); }
+
+	//Anti-alias Render by refining the pixels on edges, max_samples 1 disables it
+	void set_adaptive_sampling(const AdaptiveSamplingSettings& settings) { adaptive_sampling_ = settings; }
+
+	//Cull the bvh nodes outside the camera frustum before every frame, only the primary
+	//rays skip them. The octree is never culled.
+	void set_frustum_culling(bool frustum_culling) { frustum_culling_ = frustum_culling; }
+
+	//Trace the primary rays against the spheres binned in screen tiles of bin_size pixels
+	//instead of the bvh or the octree, the tiles are rebuilt before every frame.
+	//The secondary rays still use the bvh or the octree.
+	void set_primary_binning(bool primary_binning, int bin_size = 8)
+	{
+		primary_binning_ = primary_binning;
+		bin_size_ = bin_size < 1 ? 1 : bin_size;
+	}
 
-	std::vector<maths::Vector3f> frameBuffer() const { return frame_buffer_; }
+	//Choose how the next SetScene builds the bvh, kLbvh builds large scenes in parallel
+	void set_bvh_build_method(BvhBuildMethod method) { bvh_build_method_ = method; }
+
+	//Scheduler splitting the image in tiles, to set the thread count and tile size
+	RenderScheduler& scheduler() { return scheduler_; }
+
+	//Camera of the primary rays, at the origin looking down -Z until it is moved.
+	//SetScene keeps its position and orientation and only changes its image.
+	Camera& camera() { return camera_; }
+	const Camera& camera() const { return camera_; }
+
+	//Deepest reflection ray that is still traced, 0 only traces the primary rays
+	void set_max_depth(int max_depth) { max_depth_ = max_depth; }
+
+	//Render writes the image to the output path when enabled
+	void set_write_image(bool write_image) { write_image_ = write_image; }
+
+	//Path of the image written by WriteImage, its extension chooses the format (.ppm, .qoi or .png)
+	void set_output_path(const std::string& output_path) { output_path_ = output_path; }
+
+	//Timings and counters of the last Render
+	const RenderStats& stats() const { return stats_; }
+
+	//Write the last rendered image at the output path, return false if it could not be written.
+	//A caller owned target must still be alive.
+	bool WriteImage();
+
+	//Image of the last Render without a target
+	const std::vector<maths::Vector3f>& frameBuffer() const { return frame_buffer_; }
 
 private:
+	//Trace the primary ray through the image point x, y in pixels
+	PixelSample PrimarySample(float x, float y);
+
+	//Trace the primary ray through the image point x, y in pixels, ray_direction is its
+	//normalized direction given by the camera
+	PixelSample TracePrimary(float x, float y, const maths::Vector3f& ray_direction);
+
+	//Bin the spheres in screen tiles or flag the bvh nodes the primary rays
+	//of the next frame can reach
+	void PreparePrimaryRays();
+
+	//Render the pixels of a block of at most packet_size * packet_size pixels
+	void RenderPacket(int column, int row, int columns, int rows);
+
+	//Render a tile of the image by packets of packet_size_ rays
+	void RenderTile(const Tile& tile);
+
+	//Target of the frame buffer, allocated on the first render that uses it
+	RenderTarget FrameBufferTarget();
+
+	//Return false if the target cannot hold the image, otherwise render into it
+	bool SetTarget(const RenderTarget& target);
+
+	void SetSceneParameters(
+		std::vector<maths::Sphere>& spheres,
+		const PointLight light,
+		const int& height,
+		const int& width,
+		const float& fov,
+		const double& bias)
+	{
+		spheres_.Assign(spheres);
+		light_ = light;
+		SetImageParameters(height, width, fov, bias);
+	}
+
+	void SetImageParameters(int height, int width, float fov, double bias)
+	{
+		height_ = height;
+		width_ = width;
+		camera_.SetImage(width_, height_, fov);
+		primitive_ids_.resize(width_ * height_);
+		bias_ = bias;
+	}
+
 	maths::Vector3f background_color_{ 150.0f,200.0f,255.0f };
-	std::vector<maths::Sphere> spheres_;
+	//Geometry and material ids of the spheres, the primitive ids index it
+	SphereTable spheres_;
 	std::vector<maths::Plane> planes_;
 	PointLight light_;
 	int height_;
 	int width_;
-	float fov_;
+	Camera camera_;
 	std::vector<maths::Vector3f> frame_buffer_;
+	//Pixels written by the current render, the frame buffer or a caller owned target
+	RenderTarget target_;
+	//Primitive hit by the primary ray of every pixel, -1 for the background
+	std::vector<int> primitive_ids_;
 	double bias_;
 	Octree scene_octree_;
+	Bvh scene_bvh_;
+	//Last loaded scene file, the spheres and the bvh may use its records in place
+	std::unique_ptr<MappedSceneFile> scene_file_;
+	bool use_bvh_ = false;
+	bool frustum_culling_ = true;
+	//Bvh nodes inside the camera frustum, nullptr when the primary rays see every node
+	std::vector<std::uint8_t> visible_nodes_;
+	const std::uint8_t* primary_nodes_ = nullptr;
+	bool primary_binning_ = false;
+	int bin_size_ = 8;
+	SphereBins sphere_bins_;
+	BvhBuildMethod bvh_build_method_ = BvhBuildMethod::kSah;
+	int packet_size_ = 8;
+	AdaptiveSamplingSettings adaptive_sampling_;
+	std::string output_path_ = "./image.ppm";
+	ImageRgb8 image_;
+	int max_depth_ = 4;
+	bool write_image_ = true;
+	RenderScheduler scheduler_;
+	RenderStats stats_;
 	};
 	
 }// namespace raytracing
\ No newline at end of file
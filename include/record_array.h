@@ -0,0 +1,179 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Records read by the queries of a structure. They are either owned, filled by
+// the builds through the vector like modifiers, or viewed in place in memory owned
+// elsewhere, like a mapped scene file, which has to outlive the view. Modifying a
+// view first copies it, so the viewed memory is never written.
+template <typename T>
+class RecordArray
+{
+public:
+	RecordArray() = default;
+
+	RecordArray(const RecordArray& other) : owned_(other.owned_), view_(other.view_)
+	{
+		Update(other.size_);
+	}
+
+	RecordArray(RecordArray&& other) noexcept
+		: owned_(std::move(other.owned_)), view_(other.view_)
+	{
+		Update(other.size_);
+		other.clear();
+	}
+
+	RecordArray& operator=(const RecordArray& other)
+	{
+		if (this != &other)
+		{
+			owned_ = other.owned_;
+			view_ = other.view_;
+			Update(other.size_);
+		}
+		return *this;
+	}
+
+	RecordArray& operator=(RecordArray&& other) noexcept
+	{
+		if (this != &other)
+		{
+			owned_ = std::move(other.owned_);
+			view_ = other.view_;
+			Update(other.size_);
+			other.clear();
+		}
+		return *this;
+	}
+
+	// Use the count records at data in place, data has to stay valid while they are read
+	void View(const T* data, std::size_t count)
+	{
+		owned_.clear();
+		owned_.shrink_to_fit();
+		view_ = data;
+		Update(count);
+	}
+
+	bool is_view() const { return view_ != nullptr; }
+
+	const T* data() const { return data_; }
+
+	std::size_t size() const { return size_; }
+
+	bool empty() const { return size_ == 0; }
+
+	const T& operator[](std::size_t index) const { return data_[index]; }
+
+	T& operator[](std::size_t index)
+	{
+		Own();
+		return owned_[index];
+	}
+
+	void clear()
+	{
+		owned_.clear();
+		view_ = nullptr;
+		Update(0);
+	}
+
+	void reserve(std::size_t count)
+	{
+		Own();
+		owned_.reserve(count);
+		Update(owned_.size());
+	}
+
+	void shrink_to_fit()
+	{
+		Own();
+		owned_.shrink_to_fit();
+		Update(owned_.size());
+	}
+
+	void resize(std::size_t count, const T& value = T())
+	{
+		Own();
+		owned_.resize(count, value);
+		Update(owned_.size());
+	}
+
+	void assign(std::size_t count, const T& value)
+	{
+		view_ = nullptr;
+		owned_.assign(count, value);
+		Update(owned_.size());
+	}
+
+	void assign(const T* first, const T* last)
+	{
+		view_ = nullptr;
+		owned_.assign(first, last);
+		Update(owned_.size());
+	}
+
+	void push_back(const T& value)
+	{
+		Own();
+		owned_.push_back(value);
+		Update(owned_.size());
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		Own();
+		owned_.emplace_back(std::forward<Args>(args)...);
+		Update(owned_.size());
+		return owned_.back();
+	}
+
+private:
+	// Copy the viewed records, the builds only modify owned ones
+	void Own()
+	{
+		if (view_ != nullptr)
+		{
+			owned_.assign(view_, view_ + size_);
+			view_ = nullptr;
+		}
+	}
+
+	void Update(std::size_t size)
+	{
+		size_ = size;
+		data_ = view_ != nullptr ? view_ : owned_.data();
+	}
+
+	std::vector<T> owned_;
+	const T* view_ = nullptr;
+	const T* data_ = nullptr;
+	std::size_t size_ = 0;
+};
@@ -0,0 +1,122 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace raytracing {
+
+//Threads started once and woken by a condition variable for every job, they wait for
+//the next one instead of being created and joined each time. The calling thread works
+//as worker 0, so a job on n workers wakes n - 1 threads.
+class WorkerPool {
+public:
+	WorkerPool() = default;
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	//Call job(worker_index) for every worker_index in [0, workers) on as many threads
+	//and return once every call returned. A job run from a worker of the pool runs
+	//its calls one after the other on that worker.
+	void Run(int workers, const std::function<void(int worker_index)>& job);
+
+private:
+	void WorkerLoop(int worker_index);
+
+	//Only one job runs at a time
+	std::mutex run_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::vector<std::thread> threads_;
+	const std::function<void(int)>* job_ = nullptr;
+	int job_workers_ = 0;
+	int pending_ = 0;
+	std::uint64_t generation_ = 0;
+	bool stop_ = false;
+};
+
+//Rectangle of pixels rendered as one unit of work
+struct Tile {
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
+//Split the image into tiles and render them on several threads.
+//Every thread owns a deque of tiles and steals from the others once it is empty.
+class RenderScheduler {
+public:
+	RenderScheduler() = default;
+	RenderScheduler(int thread_count, int tile_size) : thread_count_(thread_count), tile_size_(tile_size) {}
+	//A copy has the same settings and starts its own workers
+	RenderScheduler(const RenderScheduler& other) : thread_count_(other.thread_count_), tile_size_(other.tile_size_) {}
+	RenderScheduler& operator=(const RenderScheduler& other);
+
+	//Render every tile of the image, thread_index is in [0, thread_count())
+	void Run(
+		int width,
+		int height,
+		const std::function<void(const Tile& tile, int thread_index)>& render_tile);
+
+	//Run body on count items split in one contiguous chunk per thread of the scheduler
+	void ParallelFor(int count, const std::function<void(int begin, int end, int thread_index)>& body);
+
+	//Number of threads used by Run, 0 uses every hardware thread
+	void set_thread_count(int thread_count) { thread_count_ = thread_count; }
+	int thread_count() const;
+
+	//Width and height in pixels of the tiles
+	void set_tile_size(int tile_size) { tile_size_ = tile_size < 1 ? 1 : tile_size; }
+	int tile_size() const { return tile_size_; }
+
+private:
+	WorkerPool& pool();
+
+	int thread_count_ = 0;
+	int tile_size_ = 32;
+	//Started by the first run on several threads
+	std::unique_ptr<WorkerPool> pool_;
+};
+
+//Number of threads a thread count setting stands for, 0 uses every hardware thread
+int ResolveThreadCount(int thread_count);
+
+//Run body on count items split in one contiguous chunk per thread,
+//thread_count 0 uses every hardware thread. The threads are the ones of
+//a pool shared by every call.
+void ParallelFor(
+	int count,
+	int thread_count,
+	const std::function<void(int begin, int end, int thread_index)>& body);
+
+}// namespace raytracing
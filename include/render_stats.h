@@ -0,0 +1,111 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "render_scheduler.h"
+
+//Set RAYTRACING_ENABLE_STATS to 0 to remove every counter from the hot paths
+#ifndef RAYTRACING_ENABLE_STATS
+#define RAYTRACING_ENABLE_STATS 1
+#endif
+
+namespace raytracing {
+
+enum class RayType {
+	kPrimary,
+	kShadow,
+	kReflection,
+	kCount
+};
+
+//Counters incremented while rendering, every thread owns its own instance
+struct StatCounters {
+	std::uint64_t rays[static_cast<int>(RayType::kCount)] = {};
+	std::uint64_t nodes_visited = 0;
+	std::uint64_t sphere_tests = 0;
+	std::uint64_t march_steps = 0;
+	//Rays marched by the ray marcher and the most steps one of them took
+	std::uint64_t marched_rays = 0;
+	std::uint64_t max_march_steps = 0;
+
+	void Merge(const StatCounters& other);
+	void Reset() { *this = StatCounters(); }
+};
+
+#if RAYTRACING_ENABLE_STATS
+//Counters of the calling thread, merged by the renderer after each tile
+inline thread_local StatCounters local_stat_counters;
+
+#define RAYTRACING_STAT_ADD(counter, value) (::raytracing::local_stat_counters.counter += (value))
+#define RAYTRACING_STAT_RAYS(type, count) (::raytracing::local_stat_counters.rays[static_cast<int>(type)] += (count))
+#define RAYTRACING_STAT_MAX(counter, value) (::raytracing::local_stat_counters.counter = \
+	std::max<std::uint64_t>(::raytracing::local_stat_counters.counter, (value)))
+#else
+#define RAYTRACING_STAT_ADD(counter, value) ((void)0)
+#define RAYTRACING_STAT_RAYS(type, count) ((void)0)
+#define RAYTRACING_STAT_MAX(counter, value) ((void)0)
+#endif
+
+//Statistics of the last frame, queried with stats() after Render
+struct RenderStats {
+	//Wall time of the whole frame
+	double wall_seconds = 0.0;
+	StatCounters counters;
+	//Time each thread spent rendering tiles
+	std::vector<double> thread_busy_seconds;
+	//Primary samples traced by the adaptive anti-aliasing, all 0 without it
+	std::uint64_t pixel_samples = 0;
+	std::uint64_t sampled_pixels = 0;
+	std::uint64_t refined_pixels = 0;
+	int max_pixel_samples = 0;
+
+	//Add the counters and busy times of another pass of the same frame
+	void Accumulate(const RenderStats& pass);
+
+	//Millions of rays of the given type traced per second of wall time
+	double MraysPerSecond(RayType type) const;
+	double MraysPerSecond() const;
+
+	//Average number of steps of the marched rays
+	double AverageMarchSteps() const;
+
+	//Average number of primary samples of the anti-aliased pixels, 0 without anti-aliasing
+	double AverageSamplesPerPixel() const;
+};
+
+//Render every tile with the scheduler and fill stats with the frame wall time,
+//the busy time of every thread and the counters merged from every thread
+void RenderTiles(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const std::function<void(const Tile& tile)>& render_tile,
+	RenderStats& stats);
+
+}// namespace raytracing
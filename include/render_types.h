@@ -0,0 +1,60 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "maths/vector3.h"
+
+namespace raytracing {
+
+struct PointLight {
+	maths::Vector3f position{ 10.0f,10.0f,0.0f };
+};
+
+//Hit informations shared by the ray tracer and the ray marcher, the intersection
+//only finds the primitive and the distance, the rest is resolved for the closest hit
+struct HitInfos
+{
+	maths::Vector3f normal;
+	maths::Vector3f hit_position;
+	float distance;
+	//Index of the hit sphere in the scene, -1 when nothing is hit
+	int primitive_id = -1;
+};
+
+//Image the renderers write into, its pixels are owned by the caller. Row y starts at
+//pixels + y * stride so the target can also be a window of a larger image.
+struct RenderTarget
+{
+	maths::Vector3f* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	//Pixels from the start of a row to the start of the next one, 0 when the rows are packed
+	int stride = 0;
+
+	int row_stride() const { return stride > 0 ? stride : width; }
+
+	maths::Vector3f& at(int x, int y) const { return pixels[x + static_cast<size_t>(y) * row_stride()]; }
+};
+
+}// namespace raytracing
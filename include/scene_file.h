@@ -0,0 +1,186 @@
+#pragma once
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maths/plane.h"
+#include "maths/sphere.h"
+#include "bvh.h"
+#include "camera.h"
+#include "render_types.h"
+#include "sphere_table.h"
+
+namespace raytracing {
+
+//Scene files start with this header followed by sections of fixed size records, every
+//section starting on a kSceneFileAlignment boundary. The records only hold 32 bits floats
+//and integers in the byte order of the writer. The spheres and the bvh sections have the
+//layout of the sphere table and the bvh, which use them in place in the mapped file.
+constexpr char kSceneFileMagic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+constexpr std::uint32_t kSceneFileVersion = 3;
+//Read back as another value when the file was written with the other byte order
+constexpr std::uint32_t kSceneFileByteOrder = 0x01020304;
+constexpr std::uint64_t kSceneFileAlignment = 64;
+
+enum class SceneFileSection {
+	kMaterials,
+	//PackedSphere records
+	kSpheres,
+	//Index in the materials section of every sphere
+	kSphereMaterials,
+	kPlanes,
+	kBvhNodes,
+	//Arrays of the bvh sphere store, with its padding
+	kBvhCenterX,
+	kBvhCenterY,
+	kBvhCenterZ,
+	kBvhSquaredRadius,
+	//Index of the sphere of every position of the bvh sphere store
+	kBvhOrder,
+	kCount
+};
+
+struct SceneFileSectionRange {
+	std::uint64_t offset = 0;
+	std::uint64_t count = 0;
+};
+
+struct SceneFileCamera {
+	std::int32_t width = 0;
+	std::int32_t height = 0;
+	float fov = 0.0f;
+	float bias = 0.0f;
+	//Columns of the camera to world matrix
+	float camera_to_world[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+};
+
+struct SceneFileHeader {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint64_t file_size;
+	SceneFileCamera camera;
+	float light_position[3];
+	//Hash of the spheres section the stored bvh was built for, the bvh is stale if it differs
+	std::uint32_t bvh_spheres_hash;
+	SceneFileSectionRange sections[static_cast<int>(SceneFileSection::kCount)];
+};
+
+struct SceneFileMaterial {
+	float color[3];
+	float reflexion_index;
+};
+
+struct SceneFilePlane {
+	float point[3];
+	float normal[3];
+	std::int32_t material;
+};
+
+//Everything a scene file holds except the bvh
+struct SceneDescription {
+	std::vector<maths::Sphere> spheres;
+	std::vector<maths::Plane> planes;
+	PointLight light;
+	SceneFileCamera camera;
+};
+
+//Camera of a renderer as it is stored
+SceneFileCamera ToSceneFileCamera(const Camera& camera, float bias);
+
+maths::Matrix4f CameraTransform(const SceneFileCamera& camera);
+
+//Hash of the sphere records, stored with the bvh to detect a stale one
+std::uint32_t HashSceneSpheres(const PackedSphere* spheres, std::uint64_t count);
+
+//Write the scene and the bvh built over its spheres, the bvh is not stored when empty.
+//The materials shared by several primitives are stored once. Return false if the file
+//could not be written.
+bool SaveSceneFile(const std::string& path, const SceneDescription& scene, const Bvh& bvh);
+
+//Scene file mapped read-only in memory, the records are read where they are in the file
+//and the sphere table and the bvh given the file by ViewSpheres and ReadBvh keep using
+//them, the file has to stay open while they do
+class MappedSceneFile {
+public:
+	MappedSceneFile() = default;
+	~MappedSceneFile();
+	MappedSceneFile(const MappedSceneFile&) = delete;
+	MappedSceneFile& operator=(const MappedSceneFile&) = delete;
+
+	//Map the file and validate its header, sections and indices. Return false if it cannot
+	//be mapped or is not a valid scene file of this version and byte order.
+	bool Open(const std::string& path);
+
+	void Close();
+
+	bool is_open() const { return data_ != nullptr; }
+
+	const SceneFileHeader& header() const { return *reinterpret_cast<const SceneFileHeader*>(data_); }
+
+	template<typename T>
+	const T* section(SceneFileSection section) const {
+		return reinterpret_cast<const T*>(data_ + header().sections[static_cast<int>(section)].offset);
+	}
+
+	std::uint64_t count(SceneFileSection section) const {
+		return header().sections[static_cast<int>(section)].count;
+	}
+
+	//True if the file has a bvh built for its spheres as they are now
+	bool has_current_bvh() const;
+
+	//Copy the scene out of the file
+	void Read(SceneDescription& scene) const;
+
+	//Let the table use the sphere records of the file in place, only the materials are copied
+	void ViewSpheres(SphereTable& spheres) const;
+
+	std::vector<maths::Plane> ReadPlanes() const;
+
+	PointLight ReadLight() const;
+
+	//Let bvh use the stored hierarchy in place if it is current and valid, build it with
+	//method on thread_count threads over the spheres of the file otherwise.
+	//Return true if the stored bvh was used.
+	bool ReadBvh(BvhBuildMethod method, Bvh& bvh, int thread_count = 0) const;
+
+private:
+	bool Validate() const;
+
+	std::vector<Material> ReadMaterials() const;
+
+	const std::uint8_t* data_ = nullptr;
+	std::uint64_t size_ = 0;
+#if defined(_WIN32)
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
+
+}// namespace raytracing
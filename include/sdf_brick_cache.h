@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <vector>
+
+#include "maths/vector3.h"
+#include "bvh.h"
+
+// Scene distance baked once for static scenes. A coarse grid covers the scene,
+// cells far from every surface only store a lower bound of the distance and
+// cells near a surface own a brick of distance samples read with trilinear
+// interpolation. Every lookup returns a lower bound of the exact distance,
+// so it can be used as a sphere tracing step.
+class SdfBrickCache
+{
+public:
+	SdfBrickCache() = default;
+
+	// Bake the distances of the bvh spheres in [aabb_min, aabb_max], which must contain
+	// every sphere. Cells are cubes of cell_size, bricks have brick_resolution voxels
+	// per side. thread_count 0 uses every hardware thread.
+	void Build(
+		const Bvh& bvh,
+		const maths::Vector3f& aabb_min,
+		const maths::Vector3f& aabb_max,
+		float cell_size,
+		int brick_resolution = 8,
+		int thread_count = 0);
+
+	void Clear();
+
+	// Lower bound of the distance from point to the nearest sphere surface
+	float LowerBound(const maths::Vector3f& point) const
+	{
+		float upper_bound;
+		return Bounds(point, upper_bound);
+	}
+
+	// Return the lower bound and set upper_bound to an upper bound of the distance,
+	// an exact query can skip every sphere further than upper_bound
+	float Bounds(const maths::Vector3f& point, float& upper_bound) const;
+
+	// Below this bound the lookup is not precise enough and the exact distance should be used
+	float band() const { return band_; }
+
+	bool empty() const { return cells_.empty(); }
+
+	int brick_count() const { return brick_count_; }
+
+	int cell_count() const { return static_cast<int>(cells_.size()); }
+
+private:
+	// Index of the sample (x, y, z) of a brick
+	int SampleIndex(int brick, int x, int y, int z) const
+	{
+		const int side = brick_resolution_ + 1;
+		return ((brick * side + z) * side + y) * side + x;
+	}
+
+	maths::Vector3f aabb_min_;
+	maths::Vector3f aabb_max_;
+	float cell_size_ = 0.0f;
+	int cells_x_ = 0;
+	int cells_y_ = 0;
+	int cells_z_ = 0;
+	int brick_resolution_ = 8;
+	float voxel_size_ = 0.0f;
+	// Largest trilinear interpolation error of a distance field, half a voxel diagonal
+	float interpolation_error_ = 0.0f;
+	float half_diagonal_ = 0.0f;
+	float band_ = 0.0f;
+	int brick_count_ = 0;
+
+	// Brick of each cell, -1 for the cells far from every surface
+	std::vector<int> cells_;
+	// Distance at the center of each cell
+	std::vector<float> cell_distances_;
+	// (brick_resolution + 1)^3 samples per brick, shared faces are duplicated
+	std::vector<float> samples_;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <vector>
+
+#include "maths/ray3.h"
+#include "camera.h"
+#include "sphere_table.h"
+
+// Spheres projected on the image and binned in square tiles of pixels. Every tile lists the
+// spheres whose projected bounds overlap it, sorted by the depth of their nearest point
+// along the view direction, so the primary rays only test the spheres of their tile
+// and stop at the first one that starts behind their closest hit.
+class SphereBins
+{
+public:
+	SphereBins() = default;
+
+	// Bin the spheres seen by the camera in tiles of bin_size pixels, the spheres
+	// outside the image or behind the camera are not binned. The projection runs
+	// on thread_count threads, 0 uses every hardware thread.
+	void Build(const raytracing::Camera& camera, const SphereTable& spheres, int bin_size, int thread_count = 0);
+
+	void Clear();
+
+	// Find the closest sphere of the tile of the image point x, y hit by the ray, that has
+	// to start at the camera position. sphere_index is the index in the table given to Build.
+	bool Intersect(
+		float x,
+		float y,
+		const maths::Ray3& ray,
+		int& sphere_index,
+		float& distance,
+		float max_distance = 1000000.0f) const;
+
+	int bin_size() const { return bin_size_; }
+	int bins_x() const { return bins_x_; }
+	int bins_y() const { return bins_y_; }
+
+	// Spheres listed in the tile at bin_x, bin_y
+	int count(int bin_x, int bin_y) const
+	{
+		const int bin = bin_x + bin_y * bins_x_;
+		return bin_offsets_[bin + 1] - bin_offsets_[bin];
+	}
+
+	// Sum of the sphere counts of every tile, a sphere is counted once per tile it overlaps
+	int reference_count() const { return static_cast<int>(sphere_ids_.size()); }
+
+private:
+	int bin_size_ = 16;
+	int bins_x_ = 0;
+	int bins_y_ = 0;
+
+	// The references of the tile b are [bin_offsets_[b], bin_offsets_[b + 1])
+	std::vector<int> bin_offsets_;
+	// Copies of the spheres next to their id and depth so a tile is read in order
+	std::vector<PackedSphere> spheres_;
+	std::vector<int> sphere_ids_;
+	std::vector<float> min_depths_;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "maths/vector3.h"
+#include "maths/sphere.h"
+#include "record_array.h"
+
+// Structure of arrays holding only what the ray-sphere test needs.
+// The arrays are padded so a full simd batch can always be loaded
+// from any valid index, padding spheres can never be hit.
+class SphereStore
+{
+public:
+	// Number of spheres tested at once by the widest available kernel
+	static constexpr int kBatchSize = 8;
+
+	SphereStore() = default;
+
+	void Clear();
+
+	void Reserve(int count);
+
+	// Add a sphere, id is the index of the sphere in the scene
+	void Add(const maths::Sphere& sphere, int id);
+
+	// Resize the store to count spheres, to be filled with Set
+	void Resize(int count);
+
+	// Overwrite the sphere at index, different indices can be set from several threads
+	void Set(int index, const maths::Sphere& sphere, int id);
+
+	// Use count spheres stored elsewhere in place, every array holding
+	// padded_size(count) values padded the way this store pads its own
+	void View(
+		const float* center_x,
+		const float* center_y,
+		const float* center_z,
+		const float* squared_radius,
+		const int* ids,
+		int count);
+
+	// Test the spheres [begin, end) and keep the closest hit closer than distance.
+	// Return true if distance and index were updated.
+	bool IntersectClosest(
+		const maths::Vector3f& origin,
+		const maths::Vector3f& direction,
+		int begin,
+		int end,
+		float& distance,
+		int& index) const;
+
+	// Return true if one of the spheres [begin, end) is hit between min_distance and max_distance
+	bool IntersectAny(
+		const maths::Vector3f& origin,
+		const maths::Vector3f& direction,
+		int begin,
+		int end,
+		float min_distance,
+		float max_distance) const;
+
+	// Keep the smallest signed distance from point to the surface of the spheres
+	// [begin, end) if it is below distance. Return true if distance and index were updated.
+	bool NearestDistance(
+		const maths::Vector3f& point,
+		int begin,
+		int end,
+		float& distance,
+		int& index) const;
+
+	// Test the spheres [begin, end) against every ray of the packet and keep
+	// for each ray the closest hit, packet indices are indices in the store
+	void IntersectPacket(
+		const maths::Vector3f& origin,
+		const float* direction_x,
+		const float* direction_y,
+		const float* direction_z,
+		int ray_count,
+		int begin,
+		int end,
+		float* distance,
+		int* index) const;
+
+	int size() const { return size_; }
+
+	maths::Vector3f center(int index) const { return { center_x_[index], center_y_[index], center_z_[index] }; }
+
+	float squared_radius(int index) const { return squared_radius_[index]; }
+
+	int id(int index) const { return ids_[index]; }
+
+	// Length of the arrays holding count spheres with their padding
+	static int padded_size(int count) { return count + kBatchSize; }
+
+	const float* center_x_data() const { return center_x_.data(); }
+
+	const float* center_y_data() const { return center_y_.data(); }
+
+	const float* center_z_data() const { return center_z_.data(); }
+
+	const float* squared_radius_data() const { return squared_radius_.data(); }
+
+	const int* id_data() const { return ids_.data(); }
+
+private:
+	void Pad();
+
+	int size_ = 0;
+	RecordArray<float> center_x_;
+	RecordArray<float> center_y_;
+	RecordArray<float> center_z_;
+	RecordArray<float> squared_radius_;
+	RecordArray<int> ids_;
+};
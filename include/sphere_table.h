@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "maths/vector3.h"
+#include "maths/sphere.h"
+#include "maths/ray3.h"
+#include "raytracing/material.h"
+#include "record_array.h"
+
+// Hot record of a sphere, only what the intersection and distance tests read
+struct alignas(16) PackedSphere
+{
+	maths::Vector3f center;
+	float radius = 0.0f;
+
+	// Same result as maths::Ray3::IntersectSphere(sphere, distance)
+	bool Intersect(const maths::Ray3& ray, float& distance) const;
+};
+
+static_assert(sizeof(PackedSphere) == 16, "A packed sphere has to fit in 16 bytes");
+
+inline bool PackedSphere::Intersect(const maths::Ray3& ray, float& distance) const
+{
+	const maths::Vector3f v = center - ray.origin();
+	const float d = v.Dot(ray.direction());
+	if (d < 0.0f)
+	{
+		return false;
+	}
+	const float squared_distance = v.Dot(v) - d * d;
+	const float squared_radius = radius * radius;
+	if (squared_distance > squared_radius)
+	{
+		return false;
+	}
+	const float q = std::sqrt(squared_radius - squared_distance);
+	distance = d - q >= 0.0f ? d - q : d + q;
+	return true;
+}
+
+// Spheres of a scene split in their hot geometry and their cold material ids kept in
+// a parallel array, the materials are stored once in a table indexed by the ids
+class SphereTable
+{
+public:
+	SphereTable() = default;
+
+	// Replace the content with the spheres, the identical materials share one id
+	void Assign(const std::vector<maths::Sphere>& spheres);
+
+	// Use count spheres stored elsewhere in place, like the records of a mapped scene file,
+	// the material ids index materials
+	void View(
+		const PackedSphere* geometry,
+		const std::int32_t* material_ids,
+		int count,
+		std::vector<Material> materials);
+
+	void Clear();
+
+	int size() const { return static_cast<int>(geometry_.size()); }
+
+	bool empty() const { return geometry_.empty(); }
+
+	const PackedSphere* geometry() const { return geometry_.data(); }
+
+	const std::int32_t* material_ids() const { return material_ids_.data(); }
+
+	const PackedSphere& geometry(int index) const { return geometry_[index]; }
+
+	int material_id(int index) const { return material_ids_[index]; }
+
+	const Material& material(int index) const { return materials_[material_ids_[index]]; }
+
+	const std::vector<Material>& materials() const { return materials_; }
+
+	// Sphere with its material, for the code taking scene spheres
+	maths::Sphere sphere(int index) const;
+
+	std::vector<maths::Sphere> ToSpheres() const;
+
+private:
+	RecordArray<PackedSphere> geometry_;
+	RecordArray<std::int32_t> material_ids_;
+	std::vector<Material> materials_;
+};
@@ -0,0 +1,132 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "adaptive_sampling.h"
+#include "progressive_render.h"
+
+namespace raytracing {
+
+namespace {
+
+//Samples of every refined pixel before checking if they still disagree
+constexpr int kFirstRefinementSamples = 2;
+
+float MaxChannelDifference(const maths::Vector3f& a, const maths::Vector3f& b) {
+	return std::max(std::max(std::abs(a.x - b.x), std::abs(a.y - b.y)), std::abs(a.z - b.z));
+}
+
+}// namespace
+
+void RefineAdaptive(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const PixelSampleFunction& trace_sample,
+	const AdaptiveSamplingSettings& settings,
+	const std::vector<int>& primitive_ids,
+	const RenderTarget& target,
+	RenderStats& stats) {
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point begin = Clock::now();
+	const int pixel_count = width * height;
+	//The neighbours are compared with the first samples while the refined pixels are written
+	std::vector<maths::Vector3f> first_colors(pixel_count);
+	for (int i = 0; i < height; ++i) {
+		std::copy(&target.at(0, i), &target.at(0, i) + width, first_colors.begin() + i * width);
+	}
+	std::vector<int> sample_counts(pixel_count, 1);
+
+	const int max_samples = std::max(settings.max_samples, 1);
+	const float variance_threshold = 0.25f * settings.contrast_threshold * settings.contrast_threshold;
+	RenderStats refine_stats;
+	RenderTiles(scheduler, width, height, [&](const Tile& tile) {
+		for (int i = tile.y; i < tile.y + tile.height; ++i) {
+			for (int j = tile.x; j < tile.x + tile.width; ++j) {
+				const int pixel = j + i * width;
+				const maths::Vector3f& color = first_colors[pixel];
+				const int id = primitive_ids[pixel];
+				//Edges of primitives and of shadows or reflections are where the aliasing shows
+				bool refine = false;
+				const int neighbours[4][2] = { { j - 1, i }, { j + 1, i }, { j, i - 1 }, { j, i + 1 } };
+				for (const auto& neighbour : neighbours) {
+					if (neighbour[0] < 0 || neighbour[0] >= width || neighbour[1] < 0 || neighbour[1] >= height) {
+						continue;
+					}
+					const int other = neighbour[0] + neighbour[1] * width;
+					if (primitive_ids[other] != id
+						|| MaxChannelDifference(first_colors[other], color) > settings.contrast_threshold) {
+						refine = true;
+						break;
+					}
+				}
+				if (!refine || max_samples == 1) {
+					continue;
+				}
+
+				maths::Vector3f sum = color;
+				maths::Vector3f square_sum(color.x * color.x, color.y * color.y, color.z * color.z);
+				int samples = 1;
+				while (samples < max_samples) {
+					if (samples >= kFirstRefinementSamples) {
+						//Stop once the variance of the samples is low
+						const maths::Vector3f mean = sum / static_cast<float>(samples);
+						const maths::Vector3f variance = square_sum / static_cast<float>(samples)
+							- maths::Vector3f(mean.x * mean.x, mean.y * mean.y, mean.z * mean.z);
+						if (std::max(std::max(variance.x, variance.y), variance.z) <= variance_threshold) {
+							break;
+						}
+					}
+					float offset_x;
+					float offset_y;
+					SampleOffset(samples, offset_x, offset_y);
+					const PixelSample sample = trace_sample(j + offset_x, i + offset_y);
+					sum += sample.color;
+					square_sum += maths::Vector3f(sample.color.x * sample.color.x,
+						sample.color.y * sample.color.y, sample.color.z * sample.color.z);
+					++samples;
+				}
+				target.at(j, i) = sum / static_cast<float>(samples);
+				sample_counts[pixel] = samples;
+			}
+		}
+	}, refine_stats);
+
+	stats.Accumulate(refine_stats);
+	stats.wall_seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+	stats.sampled_pixels = pixel_count;
+	stats.pixel_samples = 0;
+	stats.refined_pixels = 0;
+	stats.max_pixel_samples = 0;
+	for (int samples : sample_counts) {
+		stats.pixel_samples += samples;
+		stats.refined_pixels += samples > 1 ? 1 : 0;
+		stats.max_pixel_samples = std::max(stats.max_pixel_samples, samples);
+	}
+}
+
+}// namespace raytracing
@@ -0,0 +1,867 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "render_scheduler.h"
+#include "render_stats.h"
+
+namespace {
+
+constexpr int kSahBins = 16;
+constexpr int kStackSize = 64;
+// Cost of one traversal step relative to one sphere test
+constexpr float kTraversalCost = 1.0f;
+constexpr float kIntersectionCost = 1.0f;
+
+// Fixed size stack of the traversals, a tree deeper than kStackSize (degenerate
+// SAH splits, clustered Morton codes) spills to the heap instead of dropping nodes
+template <typename T>
+class TraversalStack
+{
+public:
+	bool empty() const { return size_ == 0 && overflow_.empty(); }
+
+	void Push(const T& value)
+	{
+		if (size_ < kStackSize)
+		{
+			entries_[size_++] = value;
+		}
+		else
+		{
+			overflow_.push_back(value);
+		}
+	}
+
+	T Pop()
+	{
+		// The overflow only fills once the inline entries are full, it holds the top
+		if (!overflow_.empty())
+		{
+			const T value = overflow_.back();
+			overflow_.pop_back();
+			return value;
+		}
+		return entries_[--size_];
+	}
+
+private:
+	T entries_[kStackSize];
+	int size_ = 0;
+	std::vector<T> overflow_;
+};
+
+struct Bin
+{
+	maths::Vector3f aabb_min{ std::numeric_limits<float>::max(),
+		std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	maths::Vector3f aabb_max{ -std::numeric_limits<float>::max(),
+		-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+	int count = 0;
+
+	void Grow(const maths::Vector3f& point_min, const maths::Vector3f& point_max)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			aabb_min[axis] = std::min(aabb_min[axis], point_min[axis]);
+			aabb_max[axis] = std::max(aabb_max[axis], point_max[axis]);
+		}
+	}
+
+	void Grow(const Bin& other)
+	{
+		if (other.count == 0) return;
+		Grow(other.aabb_min, other.aabb_max);
+		count += other.count;
+	}
+
+	float HalfArea() const
+	{
+		if (count == 0) return 0.0f;
+		const maths::Vector3f e = aabb_max - aabb_min;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+};
+
+// Slab test returning the entry distance, or max float when the box is missed
+inline float IntersectNode(
+	const BvhNode& node,
+	const maths::Vector3f& origin,
+	const maths::Vector3f& inv_direction,
+	float max_distance)
+{
+	const float tx1 = (node.aabb_min.x - origin.x) * inv_direction.x;
+	const float tx2 = (node.aabb_max.x - origin.x) * inv_direction.x;
+	float tmin = std::min(tx1, tx2);
+	float tmax = std::max(tx1, tx2);
+	const float ty1 = (node.aabb_min.y - origin.y) * inv_direction.y;
+	const float ty2 = (node.aabb_max.y - origin.y) * inv_direction.y;
+	tmin = std::max(tmin, std::min(ty1, ty2));
+	tmax = std::min(tmax, std::max(ty1, ty2));
+	const float tz1 = (node.aabb_min.z - origin.z) * inv_direction.z;
+	const float tz2 = (node.aabb_max.z - origin.z) * inv_direction.z;
+	tmin = std::max(tmin, std::min(tz1, tz2));
+	tmax = std::min(tmax, std::max(tz1, tz2));
+
+	if (tmax >= tmin && tmax > 0.0f && tmin < max_distance)
+	{
+		return std::max(tmin, 0.0f);
+	}
+	return std::numeric_limits<float>::max();
+}
+
+// Distance from the point to the closest point of the box
+inline float DistanceToNode(const BvhNode& node, const maths::Vector3f& point)
+{
+	const float dx = std::max(std::max(node.aabb_min.x - point.x, 0.0f), point.x - node.aabb_max.x);
+	const float dy = std::max(std::max(node.aabb_min.y - point.y, 0.0f), point.y - node.aabb_max.y);
+	const float dz = std::max(std::max(node.aabb_min.z - point.z, 0.0f), point.z - node.aabb_max.z);
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Spread the lower 21 bits of value so there are two zero bits between each of them
+inline std::uint64_t ExpandBits(std::uint64_t value)
+{
+	value &= 0x1fffff;
+	value = (value | value << 32) & 0x1f00000000ffff;
+	value = (value | value << 16) & 0x1f0000ff0000ff;
+	value = (value | value << 8) & 0x100f00f00f00f00f;
+	value = (value | value << 4) & 0x10c30c30c30c30c3;
+	value = (value | value << 2) & 0x1249249249249249;
+	return value;
+}
+
+inline int CountLeadingZeros(std::uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	return _BitScanReverse64(&index, value) ? 63 - static_cast<int>(index) : 64;
+#else
+	return value == 0 ? 64 : __builtin_clzll(value);
+#endif
+}
+
+struct MortonSphere
+{
+	std::uint64_t code;
+	int index;
+};
+
+// Least significant digit radix sort on 8 bits digits, every pass is split
+// between the threads: local histograms, global offsets, then scatter
+void ParallelRadixSort(std::vector<MortonSphere>& items, int thread_count)
+{
+	const int count = static_cast<int>(items.size());
+	const int workers = std::min(raytracing::ResolveThreadCount(thread_count), std::max(count, 1));
+	std::vector<MortonSphere> buffer(items.size());
+	std::vector<std::array<int, 256>> histograms(workers);
+
+	auto chunk_begin = [&](int worker) {
+		return static_cast<int>(static_cast<long long>(count) * worker / workers);
+	};
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		raytracing::ParallelFor(workers, workers, [&](int begin, int end, int) {
+			for (int worker = begin; worker < end; ++worker)
+			{
+				std::array<int, 256>& histogram = histograms[worker];
+				histogram.fill(0);
+				for (int i = chunk_begin(worker); i < chunk_begin(worker + 1); ++i)
+				{
+					histogram[(items[i].code >> shift) & 0xff]++;
+				}
+			}
+		});
+
+		// Skip the digits shared by every code, usually the high ones
+		bool single_digit = false;
+		for (int digit = 0; digit < 256 && !single_digit; ++digit)
+		{
+			int digit_count = 0;
+			for (int worker = 0; worker < workers; ++worker)
+			{
+				digit_count += histograms[worker][digit];
+			}
+			single_digit = digit_count == count;
+		}
+		if (single_digit) continue;
+
+		// Turn the histograms into the first output position of every worker and digit
+		int offset = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			for (int worker = 0; worker < workers; ++worker)
+			{
+				const int digit_count = histograms[worker][digit];
+				histograms[worker][digit] = offset;
+				offset += digit_count;
+			}
+		}
+
+		raytracing::ParallelFor(workers, workers, [&](int begin, int end, int) {
+			for (int worker = begin; worker < end; ++worker)
+			{
+				std::array<int, 256>& positions = histograms[worker];
+				for (int i = chunk_begin(worker); i < chunk_begin(worker + 1); ++i)
+				{
+					buffer[positions[(items[i].code >> shift) & 0xff]++] = items[i];
+				}
+			}
+		});
+		items.swap(buffer);
+	}
+}
+
+// Internal node of the binary radix tree, childs are internal node indices
+// or ~leaf_index for leaves
+struct RadixNode
+{
+	int first;
+	int last;
+	int left;
+	int right;
+};
+
+} // namespace
+
+void Bvh::Build(const std::vector<maths::Sphere>& spheres)
+{
+	nodes_.clear();
+	store_.Clear();
+	build_spheres_ = &spheres;
+	sphere_indices_.resize(spheres.size());
+	centroids_.resize(spheres.size());
+	for (int i = 0; i < static_cast<int>(spheres.size()); ++i)
+	{
+		sphere_indices_[i] = i;
+		centroids_[i] = spheres[i].center();
+	}
+	if (spheres.empty()) return;
+
+	nodes_.reserve(2 * spheres.size() - 1);
+	BvhNode root;
+	root.left_first = 0;
+	root.count = static_cast<int>(spheres.size());
+	nodes_.push_back(root);
+	UpdateNodeBounds(0);
+	Subdivide(0);
+
+	// Store the spheres in leaf order so leaves index them directly
+	store_.Reserve(static_cast<int>(spheres.size()));
+	for (int i = 0; i < static_cast<int>(spheres.size()); ++i)
+	{
+		store_.Add(spheres[sphere_indices_[i]], sphere_indices_[i]);
+	}
+	build_spheres_ = nullptr;
+	sphere_indices_.clear();
+	sphere_indices_.shrink_to_fit();
+	centroids_.clear();
+	centroids_.shrink_to_fit();
+	nodes_.shrink_to_fit();
+}
+
+bool Bvh::Assign(const BvhNode* nodes, int node_count, const SphereStore& store)
+{
+	nodes_.clear();
+	store_.Clear();
+	const int sphere_count = store.size();
+	if (sphere_count == 0 || node_count <= 0 || node_count > 2 * sphere_count)
+	{
+		return sphere_count == 0 && node_count == 0;
+	}
+
+	// Childs are always stored after their parent, so a valid node array has no cycle
+	for (int n = 0; n < node_count; ++n)
+	{
+		const BvhNode& node = nodes[n];
+		const bool valid = node.is_leaf()
+			? node.left_first >= 0 && node.count <= sphere_count - node.left_first
+			: node.count == 0 && node.left_first > n && node.left_first < node_count - 1;
+		if (!valid) return false;
+	}
+	std::vector<bool> stored(sphere_count, false);
+	for (int i = 0; i < sphere_count; ++i)
+	{
+		const int id = store.id(i);
+		if (id < 0 || id >= sphere_count || stored[id]) return false;
+		stored[id] = true;
+	}
+	// Padding spheres may be tested by the simd kernels, they must never be hit
+	for (int i = sphere_count; i < SphereStore::padded_size(sphere_count); ++i)
+	{
+		if (!(store.squared_radius_data()[i] < 0.0f)) return false;
+	}
+
+	nodes_.View(nodes, node_count);
+	store_ = store;
+	return true;
+}
+
+void Bvh::UpdateNodeBounds(int node_index)
+{
+	BvhNode& node = nodes_[node_index];
+	Bin bounds;
+	for (int i = node.left_first; i < node.left_first + node.count; ++i)
+	{
+		const maths::Sphere& sphere = (*build_spheres_)[sphere_indices_[i]];
+		const maths::Vector3f radius(sphere.radius(), sphere.radius(), sphere.radius());
+		bounds.Grow(sphere.center() - radius, sphere.center() + radius);
+	}
+	node.aabb_min = bounds.aabb_min;
+	node.aabb_max = bounds.aabb_max;
+}
+
+float Bvh::FindBestSplit(const BvhNode& node, int& axis, float& split_position) const
+{
+	float best_cost = std::numeric_limits<float>::max();
+	for (int a = 0; a < 3; ++a)
+	{
+		float bounds_min = std::numeric_limits<float>::max();
+		float bounds_max = -std::numeric_limits<float>::max();
+		for (int i = node.left_first; i < node.left_first + node.count; ++i)
+		{
+			bounds_min = std::min(bounds_min, centroids_[sphere_indices_[i]][a]);
+			bounds_max = std::max(bounds_max, centroids_[sphere_indices_[i]][a]);
+		}
+		if (bounds_min == bounds_max) continue;
+
+		Bin bins[kSahBins];
+		const float scale = kSahBins / (bounds_max - bounds_min);
+		for (int i = node.left_first; i < node.left_first + node.count; ++i)
+		{
+			const maths::Sphere& sphere = (*build_spheres_)[sphere_indices_[i]];
+			const int bin_index = std::min(kSahBins - 1,
+				static_cast<int>((centroids_[sphere_indices_[i]][a] - bounds_min) * scale));
+			const maths::Vector3f radius(sphere.radius(), sphere.radius(), sphere.radius());
+			bins[bin_index].Grow(sphere.center() - radius, sphere.center() + radius);
+			bins[bin_index].count++;
+		}
+
+		// Sweep from both sides to get the cost of every bin boundary
+		float left_area[kSahBins - 1];
+		float right_area[kSahBins - 1];
+		int left_count[kSahBins - 1];
+		int right_count[kSahBins - 1];
+		Bin left_box;
+		Bin right_box;
+		for (int i = 0; i < kSahBins - 1; ++i)
+		{
+			left_box.Grow(bins[i]);
+			left_count[i] = left_box.count;
+			left_area[i] = left_box.HalfArea();
+			right_box.Grow(bins[kSahBins - 1 - i]);
+			right_count[kSahBins - 2 - i] = right_box.count;
+			right_area[kSahBins - 2 - i] = right_box.HalfArea();
+		}
+		const float bin_width = (bounds_max - bounds_min) / kSahBins;
+		for (int i = 0; i < kSahBins - 1; ++i)
+		{
+			const float cost = left_count[i] * left_area[i] + right_count[i] * right_area[i];
+			if (cost < best_cost)
+			{
+				axis = a;
+				split_position = bounds_min + bin_width * (i + 1);
+				best_cost = cost;
+			}
+		}
+	}
+	return best_cost;
+}
+
+void Bvh::Subdivide(int node_index)
+{
+	BvhNode node = nodes_[node_index];
+	if (node.count <= 1) return;
+
+	int axis = 0;
+	float split_position = 0.0f;
+	const float split_cost = FindBestSplit(node, axis, split_position);
+
+	const maths::Vector3f e = node.aabb_max - node.aabb_min;
+	const float parent_area = e.x * e.y + e.y * e.z + e.z * e.x;
+	const float leaf_cost = node.count * kIntersectionCost;
+	const float split_total = kTraversalCost + kIntersectionCost * split_cost /
+		std::max(parent_area, std::numeric_limits<float>::min());
+	if (node.count <= max_leaf_size_ && split_total >= leaf_cost) return;
+	if (split_cost == std::numeric_limits<float>::max()) return;
+
+	// Partition the sphere indices around the split plane
+	int i = node.left_first;
+	int j = i + node.count - 1;
+	while (i <= j)
+	{
+		if (centroids_[sphere_indices_[i]][axis] < split_position)
+		{
+			++i;
+		}
+		else
+		{
+			std::swap(sphere_indices_[i], sphere_indices_[j--]);
+		}
+	}
+	const int left_count = i - node.left_first;
+	if (left_count == 0 || left_count == node.count) return;
+
+	const int left_index = static_cast<int>(nodes_.size());
+	BvhNode left;
+	left.left_first = node.left_first;
+	left.count = left_count;
+	BvhNode right;
+	right.left_first = i;
+	right.count = node.count - left_count;
+	nodes_.push_back(left);
+	nodes_.push_back(right);
+
+	nodes_[node_index].left_first = left_index;
+	nodes_[node_index].count = 0;
+
+	UpdateNodeBounds(left_index);
+	UpdateNodeBounds(left_index + 1);
+	Subdivide(left_index);
+	Subdivide(left_index + 1);
+}
+
+bool Bvh::Intersect(
+	const maths::Ray3& ray,
+	int& sphere_index,
+	float& distance,
+	float max_distance,
+	const std::uint8_t* visible_nodes) const
+{
+	if (nodes_.empty() || (visible_nodes != nullptr && !visible_nodes[0])) return false;
+
+	const maths::Vector3f origin = ray.origin();
+	const maths::Vector3f direction = ray.direction();
+	const maths::Vector3f inv_direction(
+		1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	float best = max_distance;
+	int best_index = -1;
+
+	struct StackEntry
+	{
+		int node;
+		float entry;
+	};
+	TraversalStack<StackEntry> stack;
+
+	float root_entry = IntersectNode(nodes_[0], origin, inv_direction, best);
+	if (root_entry == std::numeric_limits<float>::max()) return false;
+	stack.Push({ 0, root_entry });
+
+	while (!stack.empty())
+	{
+		const StackEntry current = stack.Pop();
+		// Early termination, a closer hit was found since this node was pushed
+		if (current.entry >= best) continue;
+		RAYTRACING_STAT_ADD(nodes_visited, 1);
+
+		if (visible_nodes != nullptr && !visible_nodes[current.node]) continue;
+
+		const BvhNode& node = nodes_[current.node];
+		if (node.is_leaf())
+		{
+			store_.IntersectClosest(origin, direction,
+				node.left_first, node.left_first + node.count, best, best_index);
+			continue;
+		}
+
+		int near_child = node.left_first;
+		int far_child = node.left_first + 1;
+		float near_entry = IntersectNode(nodes_[near_child], origin, inv_direction, best);
+		float far_entry = IntersectNode(nodes_[far_child], origin, inv_direction, best);
+		if (far_entry < near_entry)
+		{
+			std::swap(near_child, far_child);
+			std::swap(near_entry, far_entry);
+		}
+		// Push the far child first so the near one is visited next
+		if (far_entry != std::numeric_limits<float>::max())
+		{
+			stack.Push({ far_child, far_entry });
+		}
+		if (near_entry != std::numeric_limits<float>::max())
+		{
+			stack.Push({ near_child, near_entry });
+		}
+	}
+
+	if (best_index < 0) return false;
+	sphere_index = store_.id(best_index);
+	distance = best;
+	return true;
+}
+
+bool Bvh::Occluded(
+	const maths::Ray3& ray,
+	float min_distance,
+	float max_distance) const
+{
+	if (nodes_.empty()) return false;
+
+	const maths::Vector3f origin = ray.origin();
+	const maths::Vector3f direction = ray.direction();
+	const maths::Vector3f inv_direction(
+		1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// No ordering is needed, the first hit found ends the query
+	TraversalStack<int> stack;
+	stack.Push(0);
+
+	while (!stack.empty())
+	{
+		const BvhNode& node = nodes_[stack.Pop()];
+		RAYTRACING_STAT_ADD(nodes_visited, 1);
+		if (IntersectNode(node, origin, inv_direction, max_distance) == std::numeric_limits<float>::max())
+		{
+			continue;
+		}
+		if (node.is_leaf())
+		{
+			if (store_.IntersectAny(origin, direction,
+				node.left_first, node.left_first + node.count, min_distance, max_distance))
+			{
+				return true;
+			}
+			continue;
+		}
+		stack.Push(node.left_first + 1);
+		stack.Push(node.left_first);
+	}
+	return false;
+}
+
+float Bvh::NearestDistance(
+	const maths::Vector3f& point,
+	int& sphere_index,
+	float max_distance,
+	const std::uint8_t* visible_nodes) const
+{
+	sphere_index = -1;
+	if (nodes_.empty() || (visible_nodes != nullptr && !visible_nodes[0])) return max_distance;
+
+	// The spheres are inside their node so the distance to a node is a lower bound
+	// of the distance to any of its spheres, nodes further than the best are skipped
+	float best = max_distance;
+	int best_index = -1;
+
+	struct StackEntry
+	{
+		int node;
+		float distance;
+	};
+	TraversalStack<StackEntry> stack;
+	stack.Push({ 0, DistanceToNode(nodes_[0], point) });
+
+	while (!stack.empty())
+	{
+		const StackEntry current = stack.Pop();
+		if (current.distance >= best) continue;
+		if (visible_nodes != nullptr && !visible_nodes[current.node]) continue;
+		RAYTRACING_STAT_ADD(nodes_visited, 1);
+
+		const BvhNode& node = nodes_[current.node];
+		if (node.is_leaf())
+		{
+			store_.NearestDistance(point, node.left_first, node.left_first + node.count, best, best_index);
+			continue;
+		}
+
+		int near_child = node.left_first;
+		int far_child = node.left_first + 1;
+		float near_distance = DistanceToNode(nodes_[near_child], point);
+		float far_distance = DistanceToNode(nodes_[far_child], point);
+		if (far_distance < near_distance)
+		{
+			std::swap(near_child, far_child);
+			std::swap(near_distance, far_distance);
+		}
+		// Push the far child first so the near one is visited next
+		if (far_distance < best)
+		{
+			stack.Push({ far_child, far_distance });
+		}
+		if (near_distance < best)
+		{
+			stack.Push({ near_child, near_distance });
+		}
+	}
+
+	if (best_index >= 0)
+	{
+		sphere_index = store_.id(best_index);
+	}
+	return best;
+}
+
+void Bvh::IntersectPacket(
+	RayPacket& packet,
+	float max_distance,
+	const std::uint8_t* visible_nodes) const
+{
+	for (int i = 0; i < packet.ray_count; ++i)
+	{
+		packet.distance[i] = max_distance;
+		packet.sphere_index[i] = -1;
+	}
+	if (nodes_.empty()) return;
+
+	// Farthest closest hit of the packet, nodes further away can not improve any ray
+	float packet_max_distance = max_distance;
+
+	TraversalStack<int> stack;
+	stack.Push(0);
+
+	while (!stack.empty())
+	{
+		const int node_index = stack.Pop();
+		if (visible_nodes != nullptr && !visible_nodes[node_index]) continue;
+		const BvhNode& node = nodes_[node_index];
+		RAYTRACING_STAT_ADD(nodes_visited, 1);
+		if (DistanceToNode(node, packet.origin) >= packet_max_distance
+			|| !packet.FrustumOverlaps(node.aabb_min, node.aabb_max))
+		{
+			continue;
+		}
+
+		if (node.is_leaf())
+		{
+			store_.IntersectPacket(packet.origin,
+				packet.direction_x, packet.direction_y, packet.direction_z, packet.ray_count,
+				node.left_first, node.left_first + node.count,
+				packet.distance, packet.sphere_index);
+			packet_max_distance = 0.0f;
+			for (int i = 0; i < packet.ray_count; ++i)
+			{
+				packet_max_distance = std::max(packet_max_distance, packet.distance[i]);
+			}
+			continue;
+		}
+
+		// Visit first the child closest along the middle ray of the packet
+		int near_child = node.left_first;
+		int far_child = node.left_first + 1;
+		const BvhNode& left = nodes_[near_child];
+		const BvhNode& right = nodes_[far_child];
+		const float left_depth = maths::Vector3f::Dot(
+			(left.aabb_min + left.aabb_max) * 0.5f - packet.origin, packet.center_direction);
+		const float right_depth = maths::Vector3f::Dot(
+			(right.aabb_min + right.aabb_max) * 0.5f - packet.origin, packet.center_direction);
+		if (right_depth < left_depth)
+		{
+			std::swap(near_child, far_child);
+		}
+		stack.Push(far_child);
+		stack.Push(near_child);
+	}
+
+	for (int i = 0; i < packet.ray_count; ++i)
+	{
+		if (packet.sphere_index[i] >= 0)
+		{
+			packet.sphere_index[i] = store_.id(packet.sphere_index[i]);
+		}
+	}
+}
+
+int Bvh::CullFrustum(const maths::Frustum& frustum, std::vector<std::uint8_t>& visible_nodes) const
+{
+	visible_nodes.resize(nodes_.size());
+	if (nodes_.empty()) return 0;
+
+	// Runs once per frame, no subtree may keep a stale flag
+	int visible_spheres = 0;
+	std::vector<int> stack;
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const int node_index = stack.back();
+		stack.pop_back();
+		const BvhNode& node = nodes_[node_index];
+		const bool visible = frustum.contains(maths::AABB3(node.aabb_min, node.aabb_max));
+		visible_nodes[node_index] = visible ? 1 : 0;
+		if (!visible) continue;
+
+		if (node.is_leaf())
+		{
+			visible_spheres += node.count;
+			continue;
+		}
+		stack.push_back(node.left_first + 1);
+		stack.push_back(node.left_first);
+	}
+	return visible_spheres;
+}
+
+void Bvh::BuildLbvh(const std::vector<maths::Sphere>& spheres, int thread_count)
+{
+	nodes_.clear();
+	store_.Clear();
+	const int count = static_cast<int>(spheres.size());
+	if (count == 0) return;
+
+	// Bounds of the sphere centers, reduced per thread
+	const int workers = raytracing::ResolveThreadCount(thread_count);
+	std::vector<Bin> center_bounds(workers);
+	raytracing::ParallelFor(count, workers, [&](int begin, int end, int thread_index) {
+		for (int i = begin; i < end; ++i)
+		{
+			center_bounds[thread_index].Grow(spheres[i].center(), spheres[i].center());
+		}
+	});
+	Bin scene_bounds;
+	for (const Bin& bounds : center_bounds)
+	{
+		scene_bounds.Grow(bounds.aabb_min, bounds.aabb_max);
+	}
+
+	std::vector<MortonSphere> sorted(count);
+	const maths::Vector3f extent = scene_bounds.aabb_max - scene_bounds.aabb_min;
+	const float grid_size = static_cast<float>((1 << 21) - 1);
+	const maths::Vector3f scale(
+		extent.x > 0.0f ? grid_size / extent.x : 0.0f,
+		extent.y > 0.0f ? grid_size / extent.y : 0.0f,
+		extent.z > 0.0f ? grid_size / extent.z : 0.0f);
+	raytracing::ParallelFor(count, workers, [&](int begin, int end, int) {
+		for (int i = begin; i < end; ++i)
+		{
+			const maths::Vector3f p = spheres[i].center() - scene_bounds.aabb_min;
+			sorted[i].code = ExpandBits(static_cast<std::uint64_t>(p.x * scale.x)) << 2
+				| ExpandBits(static_cast<std::uint64_t>(p.y * scale.y)) << 1
+				| ExpandBits(static_cast<std::uint64_t>(p.z * scale.z));
+			sorted[i].index = i;
+		}
+	});
+	ParallelRadixSort(sorted, workers);
+
+	// Length of the common prefix of two codes, equal codes are told apart by their position
+	auto delta = [&](int i, int j) {
+		if (j < 0 || j >= count) return -1;
+		if (sorted[i].code == sorted[j].code)
+		{
+			return 64 + CountLeadingZeros(static_cast<std::uint64_t>(i ^ j)) - 32;
+		}
+		return CountLeadingZeros(sorted[i].code ^ sorted[j].code);
+	};
+
+	// Every internal node of the radix tree is found independently (Karras 2012)
+	std::vector<RadixNode> radix_nodes(std::max(count - 1, 0));
+	raytracing::ParallelFor(count - 1, workers, [&](int begin, int end, int) {
+		for (int i = begin; i < end; ++i)
+		{
+			const int direction = delta(i, i + 1) - delta(i, i - 1) >= 0 ? 1 : -1;
+			const int delta_min = delta(i, i - direction);
+			int length_max = 2;
+			while (delta(i, i + length_max * direction) > delta_min)
+			{
+				length_max *= 2;
+			}
+			int length = 0;
+			for (int t = length_max / 2; t >= 1; t /= 2)
+			{
+				if (delta(i, i + (length + t) * direction) > delta_min)
+				{
+					length += t;
+				}
+			}
+			const int j = i + length * direction;
+
+			const int delta_node = delta(i, j);
+			int split = 0;
+			for (int divisor = 2, t = (length + 1) / 2; ; divisor *= 2, t = (length + divisor - 1) / divisor)
+			{
+				if (delta(i, i + (split + t) * direction) > delta_node)
+				{
+					split += t;
+				}
+				if (t <= 1) break;
+			}
+			const int gamma = i + split * direction + std::min(direction, 0);
+
+			RadixNode& node = radix_nodes[i];
+			node.first = std::min(i, j);
+			node.last = std::max(i, j);
+			node.left = node.first == gamma ? ~gamma : gamma;
+			node.right = node.last == gamma + 1 ? ~(gamma + 1) : gamma + 1;
+		}
+	});
+
+	// Emit the flat layout with adjacent childs, collapsing small subtrees into leaves.
+	// Parents are always emitted before their childs.
+	nodes_.reserve(2 * count - 1);
+	nodes_.emplace_back();
+	struct EmitEntry
+	{
+		int radix_node;
+		int node;
+	};
+	std::vector<EmitEntry> stack;
+	stack.push_back({ count == 1 ? ~0 : 0, 0 });
+	while (!stack.empty())
+	{
+		const EmitEntry entry = stack.back();
+		stack.pop_back();
+		const int first = entry.radix_node < 0 ? ~entry.radix_node : radix_nodes[entry.radix_node].first;
+		const int last = entry.radix_node < 0 ? ~entry.radix_node : radix_nodes[entry.radix_node].last;
+		if (entry.radix_node < 0 || last - first + 1 <= max_leaf_size_)
+		{
+			nodes_[entry.node].left_first = first;
+			nodes_[entry.node].count = last - first + 1;
+			continue;
+		}
+		const int left_index = static_cast<int>(nodes_.size());
+		nodes_.emplace_back();
+		nodes_.emplace_back();
+		nodes_[entry.node].left_first = left_index;
+		nodes_[entry.node].count = 0;
+		stack.push_back({ radix_nodes[entry.radix_node].right, left_index + 1 });
+		stack.push_back({ radix_nodes[entry.radix_node].left, left_index });
+	}
+
+	store_.Resize(count);
+	raytracing::ParallelFor(count, workers, [&](int begin, int end, int) {
+		for (int i = begin; i < end; ++i)
+		{
+			store_.Set(i, spheres[sorted[i].index], sorted[i].index);
+		}
+	});
+
+	// Leaf bounds in parallel, then internal bounds from the last node to the root
+	const int node_count = static_cast<int>(nodes_.size());
+	raytracing::ParallelFor(node_count, workers, [&](int begin, int end, int) {
+		for (int n = begin; n < end; ++n)
+		{
+			BvhNode& node = nodes_[n];
+			if (!node.is_leaf()) continue;
+			Bin bounds;
+			for (int i = node.left_first; i < node.left_first + node.count; ++i)
+			{
+				const maths::Sphere& sphere = spheres[sorted[i].index];
+				const maths::Vector3f radius(sphere.radius(), sphere.radius(), sphere.radius());
+				bounds.Grow(sphere.center() - radius, sphere.center() + radius);
+			}
+			node.aabb_min = bounds.aabb_min;
+			node.aabb_max = bounds.aabb_max;
+		}
+	});
+	for (int n = node_count - 1; n >= 0; --n)
+	{
+		BvhNode& node = nodes_[n];
+		if (node.is_leaf()) continue;
+		Bin bounds;
+		bounds.Grow(nodes_[node.left_first].aabb_min, nodes_[node.left_first].aabb_max);
+		bounds.Grow(nodes_[node.left_first + 1].aabb_min, nodes_[node.left_first + 1].aabb_max);
+		node.aabb_min = bounds.aabb_min;
+		node.aabb_max = bounds.aabb_max;
+	}
+}
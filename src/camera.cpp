@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+
+#include "camera.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAMERA_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace raytracing {
+
+void Camera::SetImage(int width, int height, float fov) {
+	width_ = width;
+	height_ = height;
+	fov_ = fov;
+	UpdateSteps();
+}
+
+void Camera::SetTransform(const maths::Matrix4f& camera_to_world) {
+	camera_to_world_ = camera_to_world;
+	UpdateSteps();
+}
+
+void Camera::LookAt(
+	const maths::Vector3f& position,
+	const maths::Vector3f& target,
+	const maths::Vector3f& up) {
+	const maths::Vector3f backward = (position - target).Normalized();
+	const maths::Vector3f right = maths::Vector3f::Cross(up, backward).Normalized();
+	const maths::Vector3f camera_up = maths::Vector3f::Cross(backward, right);
+	SetTransform(maths::Matrix4f(
+		maths::Vector4f(right.x, right.y, right.z, 0.0f),
+		maths::Vector4f(camera_up.x, camera_up.y, camera_up.z, 0.0f),
+		maths::Vector4f(backward.x, backward.y, backward.z, 0.0f),
+		maths::Vector4f(position.x, position.y, position.z, 1.0f)));
+}
+
+void Camera::UpdateSteps() {
+	//The image plane is at the distance where it is height pixels tall,
+	//so a step of one pixel is one unit along the camera axes
+	const float tan_half_fov = std::tan(fov_ / 2.0f);
+	focal_length_ = height_ / (2.0f * tan_half_fov);
+	const maths::Vector3f top_left(-width_ / 2.0f, height_ / 2.0f, -focal_length_);
+	top_left_ = camera_to_world_.TransformDirection(top_left);
+	column_step_ = camera_to_world_.TransformDirection(maths::Vector3f(1.0f, 0.0f, 0.0f));
+	row_step_ = camera_to_world_.TransformDirection(maths::Vector3f(0.0f, -1.0f, 0.0f));
+	position_ = camera_to_world_.TransformPoint(maths::Vector3f(0.0f, 0.0f, 0.0f));
+	forward_ = camera_to_world_.TransformDirection(maths::Vector3f(0.0f, 0.0f, -1.0f)).Normalized();
+	pixel_cone_ = tan_half_fov / height_;
+}
+
+maths::Frustum Camera::ViewFrustum(float near_distance, float far_distance) const {
+	const maths::Vector3f top_right = top_left_ + column_step_ * static_cast<float>(width_);
+	const maths::Vector3f bottom_left = top_left_ + row_step_ * static_cast<float>(height_);
+	const maths::Vector3f bottom_right = bottom_left + column_step_ * static_cast<float>(width_);
+	maths::Frustum frustum;
+	frustum.calculate_frustum(position_, forward_, top_left_, top_right, bottom_left, bottom_right,
+		near_distance, far_distance);
+	return frustum;
+}
+
+void Camera::BlockDirections(
+	int x,
+	int y,
+	int width,
+	int height,
+	float* direction_x,
+	float* direction_y,
+	float* direction_z) const {
+	int lane = 0;
+	for (int i = 0; i < height; ++i) {
+		//Direction through the center of the first pixel of the row
+		const maths::Vector3f row = top_left_ + column_step_ * (x + 0.5f) + row_step_ * (y + i + 0.5f);
+		int j = 0;
+#if defined(__AVX__)
+		const __m256 row_x = _mm256_set1_ps(row.x);
+		const __m256 row_y = _mm256_set1_ps(row.y);
+		const __m256 row_z = _mm256_set1_ps(row.z);
+		const __m256 step_x = _mm256_set1_ps(column_step_.x);
+		const __m256 step_y = _mm256_set1_ps(column_step_.y);
+		const __m256 step_z = _mm256_set1_ps(column_step_.z);
+		for (; j + 8 <= width; j += 8, lane += 8) {
+			const __m256 column = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(j)),
+				_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+			const __m256 dx = _mm256_add_ps(row_x, _mm256_mul_ps(step_x, column));
+			const __m256 dy = _mm256_add_ps(row_y, _mm256_mul_ps(step_y, column));
+			const __m256 dz = _mm256_add_ps(row_z, _mm256_mul_ps(step_z, column));
+			const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx),
+				_mm256_add_ps(_mm256_mul_ps(dy, dy), _mm256_mul_ps(dz, dz))));
+			_mm256_storeu_ps(direction_x + lane, _mm256_div_ps(dx, length));
+			_mm256_storeu_ps(direction_y + lane, _mm256_div_ps(dy, length));
+			_mm256_storeu_ps(direction_z + lane, _mm256_div_ps(dz, length));
+		}
+#elif defined(CAMERA_SSE2)
+		const __m128 row_x = _mm_set1_ps(row.x);
+		const __m128 row_y = _mm_set1_ps(row.y);
+		const __m128 row_z = _mm_set1_ps(row.z);
+		const __m128 step_x = _mm_set1_ps(column_step_.x);
+		const __m128 step_y = _mm_set1_ps(column_step_.y);
+		const __m128 step_z = _mm_set1_ps(column_step_.z);
+		for (; j + 4 <= width; j += 4, lane += 4) {
+			const __m128 column = _mm_add_ps(_mm_set1_ps(static_cast<float>(j)),
+				_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+			const __m128 dx = _mm_add_ps(row_x, _mm_mul_ps(step_x, column));
+			const __m128 dy = _mm_add_ps(row_y, _mm_mul_ps(step_y, column));
+			const __m128 dz = _mm_add_ps(row_z, _mm_mul_ps(step_z, column));
+			const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx),
+				_mm_add_ps(_mm_mul_ps(dy, dy), _mm_mul_ps(dz, dz))));
+			_mm_storeu_ps(direction_x + lane, _mm_div_ps(dx, length));
+			_mm_storeu_ps(direction_y + lane, _mm_div_ps(dy, length));
+			_mm_storeu_ps(direction_z + lane, _mm_div_ps(dz, length));
+		}
+#endif
+		for (; j < width; ++j, ++lane) {
+			const maths::Vector3f direction = (row + column_step_ * static_cast<float>(j)).Normalized();
+			direction_x[lane] = direction.x;
+			direction_y[lane] = direction.y;
+			direction_z[lane] = direction.z;
+		}
+	}
+}
+
+}// namespace raytracing
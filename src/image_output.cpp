@@ -0,0 +1,511 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_OUTPUT_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "image_output.h"
+#include "render_scheduler.h"
+
+namespace raytracing {
+
+namespace {
+
+//Rows of the PNG deflated together, each chunk only references bytes of its own rows
+constexpr int kPngChunksPerThread = 4;
+//Candidates compared when searching the longest match, more compress better and slower
+constexpr int kMaxMatchCandidates = 32;
+constexpr int kMinMatch = 3;
+constexpr int kMaxMatch = 258;
+constexpr int kWindowSize = 32768;
+constexpr int kHashBits = 15;
+
+void PushBigEndian32(std::vector<std::uint8_t>& data, std::uint32_t value) {
+	data.push_back(static_cast<std::uint8_t>(value >> 24));
+	data.push_back(static_cast<std::uint8_t>(value >> 16));
+	data.push_back(static_cast<std::uint8_t>(value >> 8));
+	data.push_back(static_cast<std::uint8_t>(value));
+}
+
+const std::array<std::uint32_t, 256>& CrcTable() {
+	static const std::array<std::uint32_t, 256> table = []() {
+		std::array<std::uint32_t, 256> crc_table{};
+		for (std::uint32_t n = 0; n < 256; ++n) {
+			std::uint32_t c = n;
+			for (int k = 0; k < 8; ++k) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			crc_table[n] = c;
+		}
+		return crc_table;
+	}();
+	return table;
+}
+
+std::uint32_t Crc32(const std::uint8_t* data, size_t size, std::uint32_t crc = 0) {
+	const std::array<std::uint32_t, 256>& table = CrcTable();
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+std::uint32_t Adler32(const std::vector<std::uint8_t>& data) {
+	//5552 bytes is the most that can be summed before the 32 bits sums overflow
+	std::uint32_t a = 1;
+	std::uint32_t b = 0;
+	size_t i = 0;
+	while (i < data.size()) {
+		const size_t end = std::min(data.size(), i + 5552);
+		for (; i < end; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+//Append a PNG chunk: length, type, data and the crc of the type and data
+void PushPngChunk(std::vector<std::uint8_t>& png, const char* type, const std::vector<std::uint8_t>& chunk_data) {
+	PushBigEndian32(png, static_cast<std::uint32_t>(chunk_data.size()));
+	const size_t type_begin = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), chunk_data.begin(), chunk_data.end());
+	PushBigEndian32(png, Crc32(png.data() + type_begin, png.size() - type_begin));
+}
+
+//Deflate bits are packed from the least significant bit of every byte
+class BitWriter {
+public:
+	explicit BitWriter(std::vector<std::uint8_t>& data) : data_(data) {}
+
+	void Write(std::uint32_t value, int bit_count) {
+		bits_ |= static_cast<std::uint64_t>(value) << bit_count_;
+		bit_count_ += bit_count;
+		while (bit_count_ >= 8) {
+			data_.push_back(static_cast<std::uint8_t>(bits_));
+			bits_ >>= 8;
+			bit_count_ -= 8;
+		}
+	}
+
+	//Huffman codes are stored from their most significant bit
+	void WriteCode(std::uint32_t code, int length) {
+		std::uint32_t reversed = 0;
+		for (int i = 0; i < length; ++i) {
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+		Write(reversed, length);
+	}
+
+	void AlignToByte() {
+		if (bit_count_ > 0) {
+			data_.push_back(static_cast<std::uint8_t>(bits_));
+			bits_ = 0;
+			bit_count_ = 0;
+		}
+	}
+
+private:
+	std::vector<std::uint8_t>& data_;
+	std::uint64_t bits_ = 0;
+	int bit_count_ = 0;
+};
+
+void WriteLiteral(BitWriter& writer, int symbol) {
+	//Fixed Huffman codes of the deflate specification
+	if (symbol < 144) {
+		writer.WriteCode(0x30 + symbol, 8);
+	}
+	else if (symbol < 256) {
+		writer.WriteCode(0x190 + symbol - 144, 9);
+	}
+	else if (symbol < 280) {
+		writer.WriteCode(symbol - 256, 7);
+	}
+	else {
+		writer.WriteCode(0xC0 + symbol - 280, 8);
+	}
+}
+
+const int kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const int kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const int kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const int kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+void WriteMatch(BitWriter& writer, int length, int distance) {
+	const int length_code = static_cast<int>(
+		std::upper_bound(kLengthBase, kLengthBase + 29, length) - kLengthBase) - 1;
+	WriteLiteral(writer, 257 + length_code);
+	writer.Write(length - kLengthBase[length_code], kLengthExtra[length_code]);
+
+	const int distance_code = static_cast<int>(
+		std::upper_bound(kDistanceBase, kDistanceBase + 30, distance) - kDistanceBase) - 1;
+	writer.WriteCode(distance_code, 5);
+	writer.Write(distance - kDistanceBase[distance_code], kDistanceExtra[distance_code]);
+}
+
+inline std::uint32_t Hash3(const std::uint8_t* bytes) {
+	const std::uint32_t value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+	return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+//Deflate one fixed Huffman block with matches found by hash chains. The chunks that are
+//not the last end with an empty stored block so the next chunk starts on a byte boundary.
+void DeflateChunk(const std::uint8_t* bytes, int size, bool last, std::vector<std::uint8_t>& data) {
+	BitWriter writer(data);
+	writer.Write(last ? 1 : 0, 1);
+	writer.Write(1, 2);
+
+	std::vector<int> head(1 << kHashBits, -1);
+	std::vector<int> previous(size, -1);
+	auto insert = [&](int position) {
+		const std::uint32_t hash = Hash3(bytes + position);
+		previous[position] = head[hash];
+		head[hash] = position;
+	};
+
+	int position = 0;
+	while (position < size) {
+		int best_length = 0;
+		int best_distance = 0;
+		if (position + kMinMatch <= size) {
+			const int max_length = std::min(kMaxMatch, size - position);
+			int candidate = head[Hash3(bytes + position)];
+			for (int i = 0; i < kMaxMatchCandidates && candidate >= 0
+				&& position - candidate <= kWindowSize; ++i) {
+				int length = 0;
+				while (length < max_length && bytes[candidate + length] == bytes[position + length]) {
+					++length;
+				}
+				if (length > best_length) {
+					best_length = length;
+					best_distance = position - candidate;
+					if (length == max_length) {
+						break;
+					}
+				}
+				candidate = previous[candidate];
+			}
+		}
+
+		if (best_length >= kMinMatch) {
+			WriteMatch(writer, best_length, best_distance);
+			for (int i = 0; i < best_length; ++i, ++position) {
+				if (position + kMinMatch <= size) {
+					insert(position);
+				}
+			}
+		}
+		else {
+			WriteLiteral(writer, bytes[position]);
+			if (position + kMinMatch <= size) {
+				insert(position);
+			}
+			++position;
+		}
+	}
+	WriteLiteral(writer, 256);
+
+	if (!last) {
+		writer.Write(0, 3);
+		writer.AlignToByte();
+		const std::uint8_t empty_stored_block[4] = { 0x00, 0x00, 0xFF, 0xFF };
+		data.insert(data.end(), empty_stored_block, empty_stored_block + 4);
+	}
+	writer.AlignToByte();
+}
+
+inline std::uint8_t Paeth(int left, int up, int up_left) {
+	const int estimate = left + up - up_left;
+	const int distance_left = std::abs(estimate - left);
+	const int distance_up = std::abs(estimate - up);
+	const int distance_up_left = std::abs(estimate - up_left);
+	if (distance_left <= distance_up && distance_left <= distance_up_left) {
+		return static_cast<std::uint8_t>(left);
+	}
+	return static_cast<std::uint8_t>(distance_up <= distance_up_left ? up : up_left);
+}
+
+//Write the filter byte and the filtered bytes of a row, choosing among the
+//none, sub, up and paeth filters the one with the smallest sum of absolute values
+void FilterRow(const ImageRgb8& image, int row, std::uint8_t* filtered) {
+	const int stride = image.width * 3;
+	const std::uint8_t* current = image.pixels.data() + static_cast<size_t>(row) * stride;
+	const std::uint8_t* above = row > 0 ? current - stride : nullptr;
+
+	int best_filter = 0;
+	long best_cost = -1;
+	for (int filter = 0; filter < 5; ++filter) {
+		if (filter == 3) {
+			//The average filter is rarely the best one on rendered images
+			continue;
+		}
+		long cost = 0;
+		for (int i = 0; i < stride; ++i) {
+			const int left = i >= 3 ? current[i - 3] : 0;
+			const int up = above ? above[i] : 0;
+			const int up_left = (above && i >= 3) ? above[i - 3] : 0;
+			int predicted = 0;
+			switch (filter) {
+			case 1: predicted = left; break;
+			case 2: predicted = up; break;
+			case 4: predicted = Paeth(left, up, up_left); break;
+			default: break;
+			}
+			const std::uint8_t value = static_cast<std::uint8_t>(current[i] - predicted);
+			filtered[1 + i] = value;
+			cost += value < 128 ? value : 256 - value;
+		}
+		if (best_cost < 0 || cost < best_cost) {
+			best_cost = cost;
+			best_filter = filter;
+		}
+	}
+
+	//The last filter tried is left in the buffer, refilter with the best one
+	filtered[0] = static_cast<std::uint8_t>(best_filter);
+	for (int i = 0; i < stride; ++i) {
+		const int left = i >= 3 ? current[i - 3] : 0;
+		const int up = above ? above[i] : 0;
+		const int up_left = (above && i >= 3) ? above[i - 3] : 0;
+		int predicted = 0;
+		switch (best_filter) {
+		case 1: predicted = left; break;
+		case 2: predicted = up; break;
+		case 4: predicted = Paeth(left, up, up_left); break;
+		default: break;
+		}
+		filtered[1 + i] = static_cast<std::uint8_t>(current[i] - predicted);
+	}
+}
+
+//Clamp and truncate floats to bytes, NaN becomes 0
+void ConvertValues(const float* values, size_t value_count, std::uint8_t* pixels) {
+	size_t i = 0;
+#if defined(IMAGE_OUTPUT_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 max_value = _mm_set1_ps(255.0f);
+	for (; i + 16 <= value_count; i += 16) {
+		//max returns its second operand for NaN, so NaN becomes 0
+		const __m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i), zero), max_value));
+		const __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 4), zero), max_value));
+		const __m128i c = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 8), zero), max_value));
+		const __m128i d = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(values + i + 12), zero), max_value));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i),
+			_mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+#endif
+	for (; i < value_count; ++i) {
+		const float value = values[i];
+		pixels[i] = static_cast<std::uint8_t>(value > 0.0f ? (value < 255.0f ? value : 255.0f) : 0.0f);
+	}
+}
+
+}// namespace
+
+void ConvertToRgb8(const RenderTarget& target, ImageRgb8& image) {
+	image.width = target.width;
+	image.height = target.height;
+	const size_t row_values = static_cast<size_t>(target.width) * 3;
+	image.pixels.resize(row_values * target.height);
+	if (image.pixels.empty()) {
+		return;
+	}
+	if (target.row_stride() == target.width) {
+		ConvertValues(&target.pixels[0].x, row_values * target.height, image.pixels.data());
+		return;
+	}
+	for (int i = 0; i < target.height; ++i) {
+		ConvertValues(&target.at(0, i).x, row_values, image.pixels.data() + row_values * i);
+	}
+}
+
+ImageFormat ImageFormatFromPath(const std::string& path) {
+	const size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) {
+		return ImageFormat::kPpm;
+	}
+	std::string extension = path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+		[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension == "qoi") {
+		return ImageFormat::kQoi;
+	}
+	if (extension == "png") {
+		return ImageFormat::kPng;
+	}
+	return ImageFormat::kPpm;
+}
+
+void EncodePpm(const ImageRgb8& image, std::vector<std::uint8_t>& data) {
+	const std::string header = "P6\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+	data.clear();
+	data.reserve(header.size() + image.pixels.size());
+	data.insert(data.end(), header.begin(), header.end());
+	data.insert(data.end(), image.pixels.begin(), image.pixels.end());
+}
+
+void EncodeQoi(const ImageRgb8& image, std::vector<std::uint8_t>& data) {
+	data.clear();
+	data.reserve(14 + image.pixels.size() + image.pixels.size() / 3 + 8);
+	const char magic[4] = { 'q', 'o', 'i', 'f' };
+	data.insert(data.end(), magic, magic + 4);
+	PushBigEndian32(data, static_cast<std::uint32_t>(image.width));
+	PushBigEndian32(data, static_cast<std::uint32_t>(image.height));
+	data.push_back(3);
+	data.push_back(0);
+
+	std::array<std::uint32_t, 64> seen{};
+	std::uint8_t previous[3] = { 0, 0, 0 };
+	int run = 0;
+	const size_t pixel_count = image.pixels.size() / 3;
+	for (size_t i = 0; i < pixel_count; ++i) {
+		const std::uint8_t* pixel = &image.pixels[i * 3];
+		if (pixel[0] == previous[0] && pixel[1] == previous[1] && pixel[2] == previous[2]) {
+			++run;
+			if (run == 62 || i + 1 == pixel_count) {
+				data.push_back(static_cast<std::uint8_t>(0xC0 | (run - 1)));
+				run = 0;
+			}
+			continue;
+		}
+		if (run > 0) {
+			data.push_back(static_cast<std::uint8_t>(0xC0 | (run - 1)));
+			run = 0;
+		}
+
+		//Every pixel is opaque, the alpha of the hash is always 255
+		const int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+		const std::uint32_t packed = 0xFF000000u | (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+		if (seen[hash] == packed) {
+			data.push_back(static_cast<std::uint8_t>(hash));
+		}
+		else {
+			seen[hash] = packed;
+			const int dr = static_cast<std::int8_t>(pixel[0] - previous[0]);
+			const int dg = static_cast<std::int8_t>(pixel[1] - previous[1]);
+			const int db = static_cast<std::int8_t>(pixel[2] - previous[2]);
+			const int dr_dg = dr - dg;
+			const int db_dg = db - dg;
+			if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+				data.push_back(static_cast<std::uint8_t>(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+			}
+			else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+				data.push_back(static_cast<std::uint8_t>(0x80 | (dg + 32)));
+				data.push_back(static_cast<std::uint8_t>(((dr_dg + 8) << 4) | (db_dg + 8)));
+			}
+			else {
+				data.push_back(0xFE);
+				data.insert(data.end(), pixel, pixel + 3);
+			}
+		}
+		previous[0] = pixel[0];
+		previous[1] = pixel[1];
+		previous[2] = pixel[2];
+	}
+	const std::uint8_t end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	data.insert(data.end(), end_marker, end_marker + 8);
+}
+
+void EncodePng(const ImageRgb8& image, std::vector<std::uint8_t>& data, int thread_count) {
+	const int stride = image.width * 3 + 1;
+	std::vector<std::uint8_t> filtered(static_cast<size_t>(stride) * image.height);
+
+	const int threads = ResolveThreadCount(thread_count);
+	const int chunk_count = std::max(1, std::min(image.height, threads * kPngChunksPerThread));
+	const int rows_per_chunk = (image.height + chunk_count - 1) / std::max(1, chunk_count);
+	std::vector<std::vector<std::uint8_t>> chunks(chunk_count);
+	ParallelFor(chunk_count, thread_count, [&](int begin, int end, int) {
+		for (int chunk = begin; chunk < end; ++chunk) {
+			const int first_row = chunk * rows_per_chunk;
+			const int last_row = std::min(image.height, first_row + rows_per_chunk);
+			if (first_row >= last_row) {
+				//Empty chunks still need their block to keep the stream well formed
+				DeflateChunk(nullptr, 0, chunk + 1 == chunk_count, chunks[chunk]);
+				continue;
+			}
+			for (int row = first_row; row < last_row; ++row) {
+				FilterRow(image, row, &filtered[static_cast<size_t>(row) * stride]);
+			}
+			DeflateChunk(&filtered[static_cast<size_t>(first_row) * stride],
+				(last_row - first_row) * stride, chunk + 1 == chunk_count, chunks[chunk]);
+		}
+	});
+
+	//zlib stream: header for deflate with a 32K window, the chunks and the adler32 of the rows
+	std::vector<std::uint8_t> idat = { 0x78, 0x01 };
+	for (const std::vector<std::uint8_t>& chunk : chunks) {
+		idat.insert(idat.end(), chunk.begin(), chunk.end());
+	}
+	PushBigEndian32(idat, Adler32(filtered));
+
+	std::vector<std::uint8_t> ihdr;
+	PushBigEndian32(ihdr, static_cast<std::uint32_t>(image.width));
+	PushBigEndian32(ihdr, static_cast<std::uint32_t>(image.height));
+	//8 bits per channel, RGB, deflate, adaptive filters, no interlacing
+	const std::uint8_t format[5] = { 8, 2, 0, 0, 0 };
+	ihdr.insert(ihdr.end(), format, format + 5);
+
+	const std::uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	data.assign(signature, signature + 8);
+	PushPngChunk(data, "IHDR", ihdr);
+	PushPngChunk(data, "IDAT", idat);
+	PushPngChunk(data, "IEND", {});
+}
+
+bool SaveImage(const std::string& path, const ImageRgb8& image, int thread_count) {
+	std::vector<std::uint8_t> data;
+	switch (ImageFormatFromPath(path)) {
+	case ImageFormat::kQoi:
+		EncodeQoi(image, data);
+		break;
+	case ImageFormat::kPng:
+		EncodePng(image, data, thread_count);
+		break;
+	default:
+		EncodePpm(image, data);
+		break;
+	}
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(ofs);
+}
+
+}// namespace raytracing
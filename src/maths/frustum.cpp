@@ -78,64 +78,59 @@ void Frustum::calculate_frustum(
 	planes_[TOP] = Plane(ntr, ftr, ftl);
 	planes_[BOTTOM] = Plane(nbr, nbl, fbl);
 }
-bool Frustum::contains(const Sphere& sphere) {
-	float distance;
+void Frustum::calculate_frustum(
+		Vector3f position,
+		Vector3f direction,
+		Vector3f top_left,
+		Vector3f top_right,
+		Vector3f bottom_left,
+		Vector3f bottom_right,
+		float near_plane_distance,
+		float far_plane_distance)
+{
+	const Vector3f normal = direction.Normalized();
+	planes_[NEAR] = Plane{ position + normal * near_plane_distance, normal };
+	planes_[FAR] = Plane{ position + normal * far_plane_distance, normal * -1.0f };
+
+	// The side planes go through the position, their normals are turned to the inside
+	const std::array<Vector3f, 4> corners = { top_left, top_right, bottom_right, bottom_left };
+	const std::array<Planes, 4> sides = { TOP, RIGHT, BOTTOM, LEFT };
+	for (int i = 0; i < 4; i++) {
+		Vector3f side_normal = Vector3f::Cross(corners[i], corners[(i + 1) % 4]).Normalized();
+		if (Vector3f::Dot(side_normal, normal) < 0.0f) {
+			side_normal = side_normal * -1.0f;
+		}
+		planes_[sides[i]] = Plane{ position, side_normal };
+	}
+}
 
+bool Frustum::contains(const Sphere& sphere) const {
 	for (int i = 0; i < 6; i++) {
-		distance = planes_[i].Distance(sphere.center());
-
-		if (distance < -sphere.radius()) {
+		if (planes_[i].Distance(sphere.center()) < -sphere.radius()) {
 			return false;
 		}
-		else if (distance < sphere.radius()) {
-			return true;
-		}
 	}
 	return true;
 }
 
-bool Frustum::contains(const AABB3& aabb) {
-	std::array<Vector3f, 8> aabbBounds;
-
-	aabbBounds[0] = aabb.bottom_left();
-	aabbBounds[1] = Vector3f(aabb.bottom_left().x, 
-					aabb.bottom_left().y, 
-					aabb.top_right().z);
-	aabbBounds[2] = Vector3f(aabb.bottom_left().x, 
-					aabb.top_right().y, 
-					aabb.bottom_left().z);
-	aabbBounds[3] = Vector3f(aabb.bottom_left().x, 
-					aabb.top_right().y, 
-					aabb.top_right().z);
-	aabbBounds[4] = Vector3f(aabb.top_right().x, 
-					aabb.bottom_left().y, 
-					aabb.bottom_left().z);
-	aabbBounds[5] = Vector3f(aabb.top_right().x, 
-					aabb.bottom_left().y, 
-					aabb.top_right().z);
-	aabbBounds[6] = Vector3f(aabb.top_right().x, 
-					aabb.top_right().y, 
-					aabb.bottom_left().z);
-	aabbBounds[7] = aabb.top_right();
+bool Frustum::contains(const AABB3& aabb) const {
+	const Vector3f bottom_left = aabb.bottom_left();
+	const Vector3f top_right = aabb.top_right();
 
 	for (int i = 0; i < 6; i++) {
-		float min = planes_[i].Distance(aabbBounds[0]);
-
-		float max = min;
-
-		for (int j = 1; j < 8; j++) {
-			if (planes_[i].Distance(aabbBounds[j]) > max)
-				max = planes_[i].Distance(aabbBounds[j]);
-			if (planes_[i].Distance(aabbBounds[j]) < min)
-				min = planes_[i].Distance(aabbBounds[j]);
-		}
-		if (max < 0.0f)
+		// Corner of the box that goes the furthest inside this plane
+		const Vector3f normal = planes_[i].normal();
+		const Vector3f corner(
+			normal.x >= 0.0f ? top_right.x : bottom_left.x,
+			normal.y >= 0.0f ? top_right.y : bottom_left.y,
+			normal.z >= 0.0f ? top_right.z : bottom_left.z);
+		if (planes_[i].Distance(corner) < 0.0f)
 			return false;
 	}
 	return true;
 }
 
-bool Frustum::contains( const Vector3f& point)
+bool Frustum::contains( const Vector3f& point) const
 {
 	for (int i = 0; i < 6; i++) {
 		if (planes_[i].Distance(point) < 0.0f) {
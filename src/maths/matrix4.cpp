@@ -24,9 +24,153 @@ SOFTWARE.
 #include "maths/matrix4.h"
 #include "maths/maths_utils.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATHS_MATRIX4_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
 
 namespace maths
 {
+namespace
+{
+#if defined(MATHS_MATRIX4_SSE2)
+// Lanes (a[x], a[y], b[z], b[w])
+#define MATHS_MATRIX4_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+inline __m128 LoadColumn(const Vector4f& column) {
+	
+	return _mm_loadu_ps(column.coord);
+}
+
+inline void StoreColumn(Vector4f& column, __m128 value) {
+	
+	_mm_storeu_ps(column.coord, value);
+}
+
+template<int Lane>
+inline __m128 Splat(__m128 value) {
+	
+	return _mm_shuffle_ps(value, value, _MM_SHUFFLE(Lane, Lane, Lane, Lane));
+}
+
+// Product of the matrix with (x, y, z, w), each given in every lane
+inline __m128 Combine(const __m128 columns[4], __m128 x, __m128 y, __m128 z, __m128 w) {
+	
+	return _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(columns[0], x), _mm_mul_ps(columns[1], y)),
+		_mm_add_ps(_mm_mul_ps(columns[2], z), _mm_mul_ps(columns[3], w)));
+}
+
+// The inverse works on 2x2 blocks stored as (m00, m01, m10, m11) in one register
+inline __m128 Mat2Mul(__m128 a, __m128 b) {
+	
+	return _mm_add_ps(_mm_mul_ps(a, MATHS_MATRIX4_SHUFFLE(b, b, 0, 3, 0, 3)),
+		_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(a, a, 1, 0, 3, 2), MATHS_MATRIX4_SHUFFLE(b, b, 2, 1, 2, 1)));
+}
+
+// adjugate(a) * b
+inline __m128 Mat2AdjMul(__m128 a, __m128 b) {
+	
+	return _mm_sub_ps(_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(a, a, 3, 3, 0, 0), b),
+		_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(a, a, 1, 1, 2, 2), MATHS_MATRIX4_SHUFFLE(b, b, 2, 3, 0, 1)));
+}
+
+// a * adjugate(b)
+inline __m128 Mat2MulAdj(__m128 a, __m128 b) {
+	
+	return _mm_sub_ps(_mm_mul_ps(a, MATHS_MATRIX4_SHUFFLE(b, b, 3, 0, 3, 0)),
+		_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(a, a, 1, 0, 3, 2), MATHS_MATRIX4_SHUFFLE(b, b, 2, 1, 2, 1)));
+}
+#endif
+
+// Shared by the point and direction transforms, directions pass a zero translation
+void TransformArray(const Matrix4f& matrix, const Vector4f& translation,
+	const Vector3f* in, Vector3f* out, std::size_t count) {
+	
+#if defined(MATHS_MATRIX4_SSE2)
+	const __m128 columns[4] = {
+		LoadColumn(matrix[0]), LoadColumn(matrix[1]), LoadColumn(matrix[2]), LoadColumn(translation) };
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (std::size_t i = 0; i < count; ++i) {
+
+		const __m128 result = Combine(columns,
+			_mm_set1_ps(in[i].x), _mm_set1_ps(in[i].y), _mm_set1_ps(in[i].z), one);
+		//Vector3f is 12 bytes, a 16 bytes store would write over the next point
+		_mm_storel_pi(reinterpret_cast<__m64*>(out[i].coord), result);
+		_mm_store_ss(&out[i].z, _mm_movehl_ps(result, result));
+	}
+#else
+	for (std::size_t i = 0; i < count; ++i) {
+
+		const Vector3f p = in[i];
+		for (int j = 0; j < 3; ++j) {
+
+			out[i][j] = matrix[0][j] * p.x + matrix[1][j] * p.y + matrix[2][j] * p.z + translation[j];
+		}
+	}
+#endif
+}
+
+void TransformArray(const Matrix4f& matrix, const Vector4f& translation,
+	const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z, std::size_t count) {
+	
+	std::size_t i = 0;
+#if defined(__AVX__)
+	__m256 m[12];
+	for (int j = 0; j < 12; ++j) {
+
+		m[j] = _mm256_set1_ps(j < 9 ? matrix[j / 3][j % 3] : translation[j - 9]);
+	}
+
+	for (; i + 8 <= count; i += 8) {
+
+		const __m256 x = _mm256_loadu_ps(in_x + i);
+		const __m256 y = _mm256_loadu_ps(in_y + i);
+		const __m256 z = _mm256_loadu_ps(in_z + i);
+		_mm256_storeu_ps(out_x + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0], x), _mm256_mul_ps(m[3], y)),
+			_mm256_add_ps(_mm256_mul_ps(m[6], z), m[9])));
+		_mm256_storeu_ps(out_y + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[1], x), _mm256_mul_ps(m[4], y)),
+			_mm256_add_ps(_mm256_mul_ps(m[7], z), m[10])));
+		_mm256_storeu_ps(out_z + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[2], x), _mm256_mul_ps(m[5], y)),
+			_mm256_add_ps(_mm256_mul_ps(m[8], z), m[11])));
+	}
+#elif defined(MATHS_MATRIX4_SSE2)
+	__m128 m[12];
+	for (int j = 0; j < 12; ++j) {
+
+		m[j] = _mm_set1_ps(j < 9 ? matrix[j / 3][j % 3] : translation[j - 9]);
+	}
+
+	for (; i + 4 <= count; i += 4) {
+
+		const __m128 x = _mm_loadu_ps(in_x + i);
+		const __m128 y = _mm_loadu_ps(in_y + i);
+		const __m128 z = _mm_loadu_ps(in_z + i);
+		_mm_storeu_ps(out_x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], x), _mm_mul_ps(m[3], y)),
+			_mm_add_ps(_mm_mul_ps(m[6], z), m[9])));
+		_mm_storeu_ps(out_y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[1], x), _mm_mul_ps(m[4], y)),
+			_mm_add_ps(_mm_mul_ps(m[7], z), m[10])));
+		_mm_storeu_ps(out_z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[2], x), _mm_mul_ps(m[5], y)),
+			_mm_add_ps(_mm_mul_ps(m[8], z), m[11])));
+	}
+#endif
+	for (; i < count; ++i) {
+
+		const float x = in_x[i];
+		const float y = in_y[i];
+		const float z = in_z[i];
+		out_x[i] = matrix[0][0] * x + matrix[1][0] * y + matrix[2][0] * z + translation[0];
+		out_y[i] = matrix[0][1] * x + matrix[1][1] * y + matrix[2][1] * z + translation[1];
+		out_z[i] = matrix[0][2] * x + matrix[1][2] * y + matrix[2][2] * z + translation[2];
+	}
+}
+}// namespace
+
 Matrix4f::Matrix4f(const Vector4f& v1, const Vector4f& v2, const Vector4f& v3, const Vector4f& v4) {
 	
 	matrix_[0] = v1;
@@ -51,10 +195,11 @@ Matrix4f Matrix4f::operator+(const Matrix4f& rhs) const {
 
 	for (int i = 0; i < matrix_.size(); i++) {
 
-		for (int j = 0; j < matrix_.size(); j++) {
-
-			tmp_mat[i][j] = matrix_[i][j] + rhs[i][j];
-		}
+#if defined(MATHS_MATRIX4_SSE2)
+		StoreColumn(tmp_mat[i], _mm_add_ps(LoadColumn(matrix_[i]), LoadColumn(rhs[i])));
+#else
+		tmp_mat[i] = matrix_[i] + rhs[i];
+#endif
 	}
 
 	return tmp_mat;
@@ -73,10 +218,11 @@ Matrix4f Matrix4f::operator-(const Matrix4f& rhs) const {
 
 	for (int i = 0; i < matrix_.size(); i++) {
 
-		for (int j = 0; j < matrix_.size(); j++) {
-
-			tmp_mat[i][j] = matrix_[i][j] - rhs[i][j];
-		}
+#if defined(MATHS_MATRIX4_SSE2)
+		StoreColumn(tmp_mat[i], _mm_sub_ps(LoadColumn(matrix_[i]), LoadColumn(rhs[i])));
+#else
+		tmp_mat[i] = matrix_[i] - rhs[i];
+#endif
 	}
 
 	return tmp_mat;
@@ -93,16 +239,23 @@ Matrix4f Matrix4f::operator*(const Matrix4f& rhs) const {
 	
 	Matrix4f tmp_mat;
 
-	for (int i = 0; i < matrix_.size(); i++) {
+#if defined(MATHS_MATRIX4_SSE2)
+	const __m128 columns[4] = {
+		LoadColumn(matrix_[0]), LoadColumn(matrix_[1]), LoadColumn(matrix_[2]), LoadColumn(matrix_[3]) };
 
-		for (int j = 0; j < matrix_.size(); j++) {
+	//Every column of the result is this matrix times the column of rhs
+	for (int j = 0; j < matrix_.size(); j++) {
 
-			for (int k = 0; k < matrix_.size(); k++) {
+		const __m128 column = LoadColumn(rhs[j]);
+		StoreColumn(tmp_mat[j], Combine(columns,
+			Splat<0>(column), Splat<1>(column), Splat<2>(column), Splat<3>(column)));
+	}
+#else
+	for (int j = 0; j < matrix_.size(); j++) {
 
-				tmp_mat[j][i] += matrix_[k][i] * rhs[j][k];
-			}
-		}
+		tmp_mat[j] = *this * rhs[j];
 	}
+#endif
 
 	return tmp_mat;
 }
@@ -118,10 +271,17 @@ Vector4f Matrix4f::operator*(Vector4f rhs) const {
 	
 	Vector4f tmp_vec;
 
+#if defined(MATHS_MATRIX4_SSE2)
+	const __m128 columns[4] = {
+		LoadColumn(matrix_[0]), LoadColumn(matrix_[1]), LoadColumn(matrix_[2]), LoadColumn(matrix_[3]) };
+	StoreColumn(tmp_vec, Combine(columns,
+		_mm_set1_ps(rhs.x), _mm_set1_ps(rhs.y), _mm_set1_ps(rhs.z), _mm_set1_ps(rhs.w)));
+#else
 	tmp_vec.x = ((matrix_[0][0] * rhs.x) + (matrix_[1][0] * rhs.y) + (matrix_[2][0] * rhs.z) + (matrix_[3][0] * rhs.w));
 	tmp_vec.y = ((matrix_[0][1] * rhs.x) + (matrix_[1][1] * rhs.y) + (matrix_[2][1] * rhs.z) + (matrix_[3][1] * rhs.w));
 	tmp_vec.z = ((matrix_[0][2] * rhs.x) + (matrix_[1][2] * rhs.y) + (matrix_[2][2] * rhs.z) + (matrix_[3][2] * rhs.w));
 	tmp_vec.w = ((matrix_[0][3] * rhs.x) + (matrix_[1][3] * rhs.y) + (matrix_[2][3] * rhs.z) + (matrix_[3][3] * rhs.w));
+#endif
 
 	return tmp_vec;
 }
@@ -130,10 +290,7 @@ Matrix4f& Matrix4f::operator*=(float scalar) {
 	
 	for (int i = 0; i < matrix_.size(); ++i) {
 		
-		for (int j = 0; j < matrix_.size(); ++j) {
-			
-			matrix_[i][j] *= scalar;
-		}
+		matrix_[i] *= scalar;
 	}
 
 	return *this;
@@ -171,41 +328,172 @@ float Matrix4f::cofactor(int row, int column) const {
 
 float Matrix4f::determinant() const {
 	
-	const float kDet = matrix_[0][0] * cofactor(0, 0)
-					+ matrix_[0][1] * cofactor(1, 0)
-					+ matrix_[0][2] * cofactor(2, 0)
-					+ matrix_[0][3] * cofactor(3, 0);
-
-	return kDet;
+	//Laplace expansion over the 2x2 sub-determinants of the first two and last two columns
+	const std::array<Vector4f, 4>& m = matrix_;
+	const float kS0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	const float kS1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	const float kS2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	const float kS3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	const float kS4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	const float kS5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+	const float kC0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	const float kC1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	const float kC2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	const float kC3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	const float kC4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	const float kC5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+	return kS0 * kC5 - kS1 * kC4 + kS2 * kC3 + kS3 * kC2 - kS4 * kC1 + kS5 * kC0;
 }
 
 Matrix4f Matrix4f::Inverse() const {
 
-	const float kDet = determinant();
+#if defined(MATHS_MATRIX4_SSE2)
+	//Block inverse over the 2x2 sub-matrices | A B |
+	//                                        | C D |
+	const __m128 c0 = LoadColumn(matrix_[0]);
+	const __m128 c1 = LoadColumn(matrix_[1]);
+	const __m128 c2 = LoadColumn(matrix_[2]);
+	const __m128 c3 = LoadColumn(matrix_[3]);
+	const __m128 a = _mm_movelh_ps(c0, c1);
+	const __m128 b = _mm_movehl_ps(c1, c0);
+	const __m128 c = _mm_movelh_ps(c2, c3);
+	const __m128 d = _mm_movehl_ps(c3, c2);
+
+	//(|A|, |B|, |C|, |D|)
+	const __m128 det_sub = _mm_sub_ps(
+		_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(c0, c2, 0, 2, 0, 2), MATHS_MATRIX4_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+		_mm_mul_ps(MATHS_MATRIX4_SHUFFLE(c0, c2, 1, 3, 1, 3), MATHS_MATRIX4_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+	const __m128 det_a = Splat<0>(det_sub);
+	const __m128 det_b = Splat<1>(det_sub);
+	const __m128 det_c = Splat<2>(det_sub);
+	const __m128 det_d = Splat<3>(det_sub);
+
+	const __m128 d_c = Mat2AdjMul(d, c);
+	const __m128 a_b = Mat2AdjMul(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), Mat2Mul(b, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), Mat2Mul(c, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), Mat2MulAdj(d, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), Mat2MulAdj(a, d_c));
+
+	//|M| = |A| |D| + |B| |C| - trace(adjugate(A) B adjugate(D) C)
+	__m128 trace = _mm_mul_ps(a_b, MATHS_MATRIX4_SHUFFLE(d_c, d_c, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2, 3, 0, 1)));
+	trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 0, 3, 2)));
+	const __m128 det = _mm_sub_ps(
+		_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+	if (Equal(_mm_cvtss_f32(det), 0.0f)) {
+		
+		return *this;
+	}
+
+	const __m128 inverse_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inverse_det);
+	y = _mm_mul_ps(y, inverse_det);
+	z = _mm_mul_ps(z, inverse_det);
+	w = _mm_mul_ps(w, inverse_det);
+
+	Matrix4f tmp_mat;
+	StoreColumn(tmp_mat[0], MATHS_MATRIX4_SHUFFLE(x, y, 3, 1, 3, 1));
+	StoreColumn(tmp_mat[1], MATHS_MATRIX4_SHUFFLE(x, y, 2, 0, 2, 0));
+	StoreColumn(tmp_mat[2], MATHS_MATRIX4_SHUFFLE(z, w, 3, 1, 3, 1));
+	StoreColumn(tmp_mat[3], MATHS_MATRIX4_SHUFFLE(z, w, 2, 0, 2, 0));
+
+	return tmp_mat;
+#else
+	//Same sub-determinants as determinant(), reused for every cofactor
+	const std::array<Vector4f, 4>& m = matrix_;
+	const float kS0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	const float kS1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	const float kS2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	const float kS3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	const float kS4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	const float kS5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+	const float kC0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	const float kC1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	const float kC2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	const float kC3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	const float kC4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	const float kC5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	const float kDet = kS0 * kC5 - kS1 * kC4 + kS2 * kC3 + kS3 * kC2 - kS4 * kC1 + kS5 * kC0;
 	
 	if(Equal(kDet, 0.0f)) {
 		
 		return *this;
 	}
+
+	const float kInverseDet = 1.0f / kDet;
+	return Matrix4f(
+		Vector4f(m[1][1] * kC5 - m[1][2] * kC4 + m[1][3] * kC3,
+			-m[0][1] * kC5 + m[0][2] * kC4 - m[0][3] * kC3,
+			m[3][1] * kS5 - m[3][2] * kS4 + m[3][3] * kS3,
+			-m[2][1] * kS5 + m[2][2] * kS4 - m[2][3] * kS3) * kInverseDet,
+		Vector4f(-m[1][0] * kC5 + m[1][2] * kC2 - m[1][3] * kC1,
+			m[0][0] * kC5 - m[0][2] * kC2 + m[0][3] * kC1,
+			-m[3][0] * kS5 + m[3][2] * kS2 - m[3][3] * kS1,
+			m[2][0] * kS5 - m[2][2] * kS2 + m[2][3] * kS1) * kInverseDet,
+		Vector4f(m[1][0] * kC4 - m[1][1] * kC2 + m[1][3] * kC0,
+			-m[0][0] * kC4 + m[0][1] * kC2 - m[0][3] * kC0,
+			m[3][0] * kS4 - m[3][1] * kS2 + m[3][3] * kS0,
+			-m[2][0] * kS4 + m[2][1] * kS2 - m[2][3] * kS0) * kInverseDet,
+		Vector4f(-m[1][0] * kC3 + m[1][1] * kC1 - m[1][2] * kC0,
+			m[0][0] * kC3 - m[0][1] * kC1 + m[0][2] * kC0,
+			-m[3][0] * kS3 + m[3][1] * kS1 - m[3][2] * kS0,
+			m[2][0] * kS3 - m[2][1] * kS1 + m[2][2] * kS0) * kInverseDet);
+#endif
+}
+
+Matrix4f Matrix4f::InverseAffine() const {
 	
-	if (IsOrthogonal()) {
+	//The rows of the inverse 3x3 part are the cross products of its columns over the determinant
+	const Vector3f kX(matrix_[0].x, matrix_[0].y, matrix_[0].z);
+	const Vector3f kY(matrix_[1].x, matrix_[1].y, matrix_[1].z);
+	const Vector3f kZ(matrix_[2].x, matrix_[2].y, matrix_[2].z);
+	const Vector3f kRow0 = Vector3f::Cross(kY, kZ);
+	const float kDet = Vector3f::Dot(kX, kRow0);
+
+	if (Equal(kDet, 0.0f)) {
 		
-		return Transpose();
+		return *this;
 	}
-	
-	Matrix4f tmp_mat = adjoint();
 
-	tmp_mat *= (1.0f / determinant());
-
-	return tmp_mat;
+	const float kInverseDet = 1.0f / kDet;
+	const Vector3f kRow1 = Vector3f::Cross(kZ, kX) * kInverseDet;
+	const Vector3f kRow2 = Vector3f::Cross(kX, kY) * kInverseDet;
+	const Vector3f kScaledRow0 = kRow0 * kInverseDet;
+	const Vector3f kTranslation(matrix_[3].x, matrix_[3].y, matrix_[3].z);
+
+	return Matrix4f(Vector4f(kScaledRow0.x, kRow1.x, kRow2.x, 0),
+					Vector4f(kScaledRow0.y, kRow1.y, kRow2.y, 0),
+					Vector4f(kScaledRow0.z, kRow1.z, kRow2.z, 0),
+					Vector4f(-Vector3f::Dot(kScaledRow0, kTranslation),
+						-Vector3f::Dot(kRow1, kTranslation),
+						-Vector3f::Dot(kRow2, kTranslation), 1));
 }
 
 Matrix4f Matrix4f::Transpose() const {
 	
+#if defined(MATHS_MATRIX4_SSE2)
+	__m128 c0 = LoadColumn(matrix_[0]);
+	__m128 c1 = LoadColumn(matrix_[1]);
+	__m128 c2 = LoadColumn(matrix_[2]);
+	__m128 c3 = LoadColumn(matrix_[3]);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+	Matrix4f tmp_mat;
+	StoreColumn(tmp_mat[0], c0);
+	StoreColumn(tmp_mat[1], c1);
+	StoreColumn(tmp_mat[2], c2);
+	StoreColumn(tmp_mat[3], c3);
+
+	return tmp_mat;
+#else
 	return Matrix4f(Vector4f(matrix_[0][0], matrix_[1][0], matrix_[2][0], matrix_[3][0]),
 					Vector4f(matrix_[0][1], matrix_[1][1], matrix_[2][1], matrix_[3][1]),
 					Vector4f(matrix_[0][2], matrix_[1][2], matrix_[2][2], matrix_[3][2]),
 					Vector4f(matrix_[0][3], matrix_[1][3], matrix_[2][3], matrix_[3][3]));
+#endif
 }
 
 Matrix4f Matrix4f::adjoint() const {
@@ -228,6 +516,44 @@ bool Matrix4f::IsOrthogonal() const {
 	return Equal(determinant(), 1.0f);
 }
 
+Vector3f Matrix4f::TransformPoint(const Vector3f& point) const {
+	
+	Vector3f tmp_vec;
+	TransformArray(*this, matrix_[3], &point, &tmp_vec, 1);
+
+	return tmp_vec;
+}
+
+Vector3f Matrix4f::TransformDirection(const Vector3f& direction) const {
+	
+	Vector3f tmp_vec;
+	TransformArray(*this, Vector4f(0, 0, 0, 0), &direction, &tmp_vec, 1);
+
+	return tmp_vec;
+}
+
+void Matrix4f::TransformPoints(const Vector3f* in, Vector3f* out, std::size_t count) const {
+	
+	TransformArray(*this, matrix_[3], in, out, count);
+}
+
+void Matrix4f::TransformPoints(const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z, std::size_t count) const {
+	
+	TransformArray(*this, matrix_[3], in_x, in_y, in_z, out_x, out_y, out_z, count);
+}
+
+void Matrix4f::TransformDirections(const Vector3f* in, Vector3f* out, std::size_t count) const {
+	
+	TransformArray(*this, Vector4f(0, 0, 0, 0), in, out, count);
+}
+
+void Matrix4f::TransformDirections(const float* in_x, const float* in_y, const float* in_z,
+	float* out_x, float* out_y, float* out_z, std::size_t count) const {
+	
+	TransformArray(*this, Vector4f(0, 0, 0, 0), in_x, in_y, in_z, out_x, out_y, out_z, count);
+}
+
 Matrix4f Matrix4f::identity() {
 	
 	return Matrix4f(Vector4f(1, 0, 0, 0), 
@@ -238,43 +564,32 @@ Matrix4f Matrix4f::identity() {
 
 Matrix4f Matrix4f::rotationMatrix(radian_t angle, char axis) {
 	
-	if(axis != 'x' && axis != 'y' && axis != 'z') {
+	switch(axis) {
+		
+	case 'x':
+		return Matrix4f(Vector4f(1, 0, 0, 0),
+						Vector4f(0, cos(angle), sin(angle), 0),
+						Vector4f(0, -sin(angle), cos(angle), 0),
+						Vector4f(0, 0, 0, 1));
+		
+	case 'y':
+		return Matrix4f(Vector4f(cos(angle), 0, -sin(angle), 0),
+						Vector4f(0, 1, 0, 0),
+						Vector4f(sin(angle), 0, cos(angle), 0),
+						Vector4f(0, 0, 0, 1));
 		
+	case 'z':
+		return Matrix4f(Vector4f(cos(angle), sin(angle), 0, 0),
+						Vector4f(-sin(angle), cos(angle), 0, 0),
+						Vector4f(0, 0, 1, 0),
+						Vector4f(0, 0, 0, 1));
+		
+	default:
 		return Matrix4f(Vector4f(0, 0, 0, 0),
 						Vector4f(0, 0, 0, 0),
 						Vector4f(0, 0, 0, 0),
 						Vector4f(0, 0, 0, 0));
 	}
-	
-	switch(axis) {
-		
-	case 'x': {
-			
-			return Matrix4f(Vector4f(0, cos(angle), -sin(angle), 0),
-							Vector4f(0, sin(angle), cos(angle), 0),
-							Vector4f(0, 1, 0, 0),
-							Vector4f(0, 0, 0, 1));
-			break;
-		}
-		
-	case 'y': {
-			
-			return Matrix4f(Vector4f(-sin(angle), 0, cos(angle), 0),
-							Vector4f(cos(angle), 0, sin(angle), 0),
-							Vector4f(0, 1, 0, 0),
-							Vector4f(0, 0, 0, 1));
-			break;
-		}
-		
-	case 'z': {
-			
-			return Matrix4f(Vector4f(cos(angle), -sin(angle), 0, 0),
-							Vector4f(sin(angle), cos(angle), 0, 0),
-							Vector4f(0, 1, 0, 0),
-							Vector4f(0, 0, 0, 1));
-			break;
-		}
-	}
 }
 
 Matrix4f Matrix4f::scalingMatrix(Vector3f axisValues) {
@@ -287,10 +602,10 @@ Matrix4f Matrix4f::scalingMatrix(Vector3f axisValues) {
 
 Matrix4f Matrix4f::translationMatrix(Vector3f axisValues) {
 	
-	return Matrix4f(Vector4f(1, 0, 0, axisValues.x),
-					Vector4f(0, 1, 0, axisValues.y),
-					Vector4f(0, 0, 1, axisValues.z),
-					Vector4f(0, 0, 0, 1));
+	return Matrix4f(Vector4f(1, 0, 0, 0),
+					Vector4f(0, 1, 0, 0),
+					Vector4f(0, 0, 1, 0),
+					Vector4f(axisValues.x, axisValues.y, axisValues.z, 1));
 }
 	
 }//namespace maths
\ No newline at end of file
@@ -26,49 +26,6 @@ SOFTWARE.
 
 namespace maths {
 
-bool Ray3::IntersectSphere(const Sphere& sphere, Vector3f& hitPosition, float& distance) {
-
-    const Vector3f v = sphere.center() - origin_;
-    const float d = v.Dot(direction_); // Distance to closest point to sphere center
-    //float distance;
-    if (d < 0) {
-        return false;
-    }
-
-    const float squaredDistance = v.Dot(v) - (d * d); // squared Distance between closest point to sphere center
-    const float radius2 = sphere.radius() * sphere.radius();
-    if (squaredDistance > radius2) {
-        return false;
-    }
-
-    const auto q = std::sqrt(radius2 - squaredDistance);
-
-    const auto t0 = d + q;
-    const auto t1 = d - q;
-
-    bool hasHit = false;
-    if (t0 >= 0) {
-        distance = t0;
-        hasHit = true;
-    }
-
-    if (t1 >= 0) {
-        if (!hasHit || t1 < distance) {
-            distance = t1;
-            hasHit = true;
-        }
-    }
-
-    if (!hasHit) {
-        return false;
-    }
-
-    // calculate the position where the ray hit
-    hitPosition = origin_ + direction_ * distance;
-
-    return true;
-}
-
 bool Ray3::IntersectAABB3(const AABB3& aabb) {
     const Vector3f lb = aabb.bottom_left();
     const Vector3f rt = aabb.top_right();
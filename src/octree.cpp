@@ -1,24 +1,50 @@
 #include "octree.h"
+#include "render_stats.h"
 
-void Octree::Insert(const maths::Sphere& sphere)
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Slab test returning the entry distance, or max float when the box is missed.
+// Split can create boxes with swapped corners so min/max are taken per axis.
+float EntryDistance(
+	const maths::AABB3& aabb,
+	const maths::Vector3f& origin,
+	const maths::Vector3f& inv_direction)
+{
+	float tmin = 0.0f;
+	float tmax = std::numeric_limits<float>::max();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float t1 = (aabb.bottom_left()[axis] - origin[axis]) * inv_direction[axis];
+		const float t2 = (aabb.top_right()[axis] - origin[axis]) * inv_direction[axis];
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+	}
+	if (tmin > tmax)
+	{
+		return std::numeric_limits<float>::max();
+	}
+	return tmin;
+}
+
+} // namespace
+
+void Octree::Insert(const std::vector<maths::Sphere>& spheres, int sphere_index)
 {
-		if (spheres_.size() >= max_spheres_number_ && depth_ < max_depth_ && !has_split_)
+		if (sphere_indices_.size() >= max_spheres_number_ && depth_ < max_depth_ && !has_split_)
 		{
-			std::cout << "first aabb childs number = " << childs_.size() << "\n";
-			std::cout << " firt aabb center = " << octree_aabb_.center().x << ", " << octree_aabb_.center().y << ", " << octree_aabb_.center().z << "\n";
-			Split();
-			std::cout << "first aabb childs number = " << childs_.size() << "\n";
+			Split(spheres);
 		}
 		if(has_split_)
 		{
 			bool inserted_sphere = false;
 			for (int i = 0; i< childs_.size(); ++i)
 			{
-				//std::cout << " childs_ size = " << childs_.size() << "\n";
-				std::cout << "child aabb center = " << childs_[i].aabb().center().x << "," << childs_[i].aabb().center().y << "," << childs_[i].aabb().center().z << "\n";
-				if(maths::AABBContainSphere(sphere,childs_[i].aabb()))
+				if(maths::AABBContainSphere(spheres[sphere_index],childs_[i].aabb()))
 				{
-					childs_[i].Insert(sphere);
+					childs_[i].Insert(spheres, sphere_index);
 					inserted_sphere = true;
 				}
 				//std::cout << "childs spheres_size = " << child.spheres_.size() << "\n";
@@ -28,23 +54,19 @@ void Octree::Insert(const maths::Sphere& sphere)
 			// so it is added into this aabb and not the childs
 			if(!inserted_sphere) 
 			{
-				spheres_.push_back(sphere);
-				std::cout << "couldn't fit sphere \n";
+				sphere_indices_.push_back(sphere_index);
 			}
 		}
 		else
 		{
-			spheres_.push_back(sphere);
-			std::cout << "added sphere \n";
+			sphere_indices_.push_back(sphere_index);
 		}
 }
 
-void Octree::Split()
+void Octree::Split(const std::vector<maths::Sphere>& spheres)
 {
 	has_split_ = true;
 
-	std::cout << "split \n";
-
 	/*float child_width = (octree_aabb_.extent()).Magnitude() / sqrt(3);
 	float parent_width = octree_aabb_.extent().x * 2;*/
 	float child_width = octree_aabb_.extent().x/2;
@@ -100,30 +122,38 @@ void Octree::Split()
 	childs_.resize(8);
 	childs_ = { firstoctant,secondoctant,thirdoctant,fourthoctant,fifthoctant,sixthtoctant,seventhoctant,eightoctant };
 	
-	for (Octree child : childs_)
+	// Move the spheres into the childs that can contain them,
+	// the others stay in this node
+	std::vector<int> remaining_spheres;
+	for (int sphere_index : sphere_indices_)
 	{
-		for(int i = 0; i < spheres_.size(); ++i)
+		bool inserted_sphere = false;
+		for (Octree& child : childs_)
 		{
-			if(AABBContainSphere(spheres_[i],child.aabb()))
+			if(AABBContainSphere(spheres[sphere_index],child.aabb()))
 			{
-				std::cout << "erased \n";
-				child.Insert(spheres_[i]);
-				spheres_.erase(spheres_.begin()+i);
+				child.Insert(spheres, sphere_index);
+				inserted_sphere = true;
 			}
 		}
+		if(!inserted_sphere)
+		{
+			remaining_spheres.push_back(sphere_index);
+		}
 	}
+	sphere_indices_.swap(remaining_spheres);
 	//std::cout << spheres_.size() << "\n";
 }
 
-std::vector<maths::Sphere> Octree::Retrieve_spheres(maths::Ray3 ray)
+std::vector<int> Octree::Retrieve_spheres(maths::Ray3 ray)
 {
 //	auto begin = std::chrono::high_resolution_clock::now();
-	std::vector<maths::Sphere> spheres_to_check;
+	std::vector<int> spheres_to_check;
 	spheres_to_check.reserve(1);
 	
 	if(ray.IntersectAABB3(octree_aabb_))
 	{
-		for (maths::Sphere sphere : spheres_)
+		for (int sphere : sphere_indices_)
 		{
 			if(spheres_to_check.size() == spheres_to_check.capacity())
 			{
@@ -133,13 +163,13 @@ std::vector<maths::Sphere> Octree::Retrieve_spheres(maths::Ray3 ray)
 		}
 		if(has_split_)
 		{
-			for (Octree child : childs_)
+			for (Octree& child : childs_)
 			{
-				std::vector<maths::Sphere> childs_spheres;
+				std::vector<int> childs_spheres;
 				childs_spheres.reserve(1);
 				childs_spheres = child.Retrieve_spheres(ray);
 
-				for (maths::Sphere sphere : childs_spheres)
+				for (int sphere : childs_spheres)
 				{
 					if(spheres_to_check.size() == spheres_to_check.capacity())
 					{
@@ -156,11 +186,11 @@ std::vector<maths::Sphere> Octree::Retrieve_spheres(maths::Ray3 ray)
 	return spheres_to_check;
 }
 
-void Octree::Retrieve_2(maths::Ray3 ray, std::vector<maths::Sphere>& spheres_to_check)
+void Octree::Retrieve_2(maths::Ray3 ray, std::vector<int>& spheres_to_check)
 {
 	if(ray.IntersectAABB3(octree_aabb_))
 	{
-		for (maths::Sphere sphere : spheres_)
+		for (int sphere : sphere_indices_)
 		{
 			if (spheres_to_check.size() == spheres_to_check.capacity())
 			{
@@ -170,7 +200,7 @@ void Octree::Retrieve_2(maths::Ray3 ray, std::vector<maths::Sphere>& spheres_to_
 		}
 		if(has_split())
 		{
-			for (Octree child : childs_)
+			for (Octree& child : childs_)
 			{
 				child.Retrieve_2(ray, spheres_to_check);
 			}
@@ -180,6 +210,134 @@ void Octree::Retrieve_2(maths::Ray3 ray, std::vector<maths::Sphere>& spheres_to_
 	
 }
 
+bool Octree::ClosestHit(
+	const maths::Ray3& ray,
+	const PackedSphere* spheres,
+	int& sphere_index,
+	float& distance,
+	float max_distance) const
+{
+	const maths::Vector3f direction = ray.direction();
+	const maths::Vector3f inv_direction(
+		1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	if (EntryDistance(octree_aabb_, ray.origin(), inv_direction) >= max_distance)
+	{
+		return false;
+	}
+
+	float best_distance = max_distance;
+	int best_sphere = -1;
+	ClosestHitRecursive(ray, inv_direction, spheres, best_sphere, best_distance);
+	if (best_sphere < 0)
+	{
+		return false;
+	}
+	sphere_index = best_sphere;
+	distance = best_distance;
+	return true;
+}
+
+void Octree::ClosestHitRecursive(
+	const maths::Ray3& ray,
+	const maths::Vector3f& inv_direction,
+	const PackedSphere* spheres,
+	int& sphere_index,
+	float& best_distance) const
+{
+	RAYTRACING_STAT_ADD(nodes_visited, 1);
+	RAYTRACING_STAT_ADD(sphere_tests, sphere_indices_.size());
+	// Spheres that could not fit in a child are stored in this node
+	for (int index : sphere_indices_)
+	{
+		float distance;
+		if (spheres[index].Intersect(ray, distance) && distance < best_distance)
+		{
+			best_distance = distance;
+			sphere_index = index;
+		}
+	}
+	if (!has_split_)
+	{
+		return;
+	}
+
+	// Sort the childs by entry distance so the nearest octant is visited first
+	std::array<std::pair<float, int>, 8> order;
+	int order_size = 0;
+	for (int i = 0; i < static_cast<int>(childs_.size()) && i < 8; ++i)
+	{
+		const float entry = EntryDistance(childs_[i].octree_aabb_, ray.origin(), inv_direction);
+		if (entry >= best_distance)
+		{
+			continue;
+		}
+		int position = order_size++;
+		while (position > 0 && order[position - 1].first > entry)
+		{
+			order[position] = order[position - 1];
+			--position;
+		}
+		order[position] = { entry, i };
+	}
+
+	for (int i = 0; i < order_size; ++i)
+	{
+		// Prune the childs that start after the closest hit found so far
+		if (order[i].first >= best_distance)
+		{
+			break;
+		}
+		childs_[order[i].second].ClosestHitRecursive(ray, inv_direction, spheres, sphere_index, best_distance);
+	}
+}
+
+bool Octree::Occluded(
+	const maths::Ray3& ray,
+	const PackedSphere* spheres,
+	float min_distance,
+	float max_distance) const
+{
+	const maths::Vector3f direction = ray.direction();
+	const maths::Vector3f inv_direction(
+		1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	return OccludedRecursive(ray, inv_direction, spheres, min_distance, max_distance);
+}
+
+bool Octree::OccludedRecursive(
+	const maths::Ray3& ray,
+	const maths::Vector3f& inv_direction,
+	const PackedSphere* spheres,
+	float min_distance,
+	float max_distance) const
+{
+	if (EntryDistance(octree_aabb_, ray.origin(), inv_direction) > max_distance)
+	{
+		return false;
+	}
+	RAYTRACING_STAT_ADD(nodes_visited, 1);
+	RAYTRACING_STAT_ADD(sphere_tests, sphere_indices_.size());
+	for (int index : sphere_indices_)
+	{
+		float distance;
+		if (spheres[index].Intersect(ray, distance) && distance >= min_distance && distance <= max_distance)
+		{
+			return true;
+		}
+	}
+	if (has_split_)
+	{
+		for (const Octree& child : childs_)
+		{
+			if (child.OccludedRecursive(ray, inv_direction, spheres, min_distance, max_distance))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 //std::string Octree::ToString()
 //{
 //	/*std::string s;
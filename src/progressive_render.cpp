@@ -0,0 +1,114 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "progressive_render.h"
+
+namespace raytracing {
+
+void SampleOffset(int sample, float& offset_x, float& offset_y) {
+	const double g1 = 0.7548776662466927;
+	const double g2 = 0.5698402909980532;
+	double integer_part;
+	offset_x = static_cast<float>(std::modf(0.5 + sample * g1, &integer_part));
+	offset_y = static_cast<float>(std::modf(0.5 + sample * g2, &integer_part));
+}
+
+int RenderProgressive(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const SampleFunction& trace_sample,
+	const ProgressiveSettings& settings,
+	const ProgressiveCallback& on_pass,
+	const RenderTarget& target,
+	RenderStats& stats) {
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point begin = Clock::now();
+	stats = RenderStats();
+	std::vector<maths::Vector3f> accumulation(static_cast<size_t>(width) * height, maths::Vector3f(0.0f, 0.0f, 0.0f));
+
+	ProgressivePass pass;
+	RenderStats pass_stats;
+	auto end_pass = [&]() {
+		stats.Accumulate(pass_stats);
+		pass.elapsed_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+		if (on_pass) {
+			on_pass(pass, target);
+		}
+		++pass.index;
+		return settings.time_budget_seconds > 0.0 && pass.elapsed_seconds >= settings.time_budget_seconds;
+	};
+
+	bool out_of_time = false;
+	if (settings.preview_passes) {
+		for (int block_size = 8; block_size > 1 && !out_of_time; block_size /= 2) {
+			//One sample in the middle of every block, copied to all its pixels
+			RenderTiles(scheduler, width, height, [&](const Tile& tile) {
+				for (int y = tile.y; y < tile.y + tile.height; y += block_size) {
+					for (int x = tile.x; x < tile.x + tile.width; x += block_size) {
+						const int block_width = std::min(block_size, tile.x + tile.width - x);
+						const int block_height = std::min(block_size, tile.y + tile.height - y);
+						const maths::Vector3f color = trace_sample(
+							x + block_width * 0.5f, y + block_height * 0.5f);
+						for (int i = y; i < y + block_height; ++i) {
+							for (int j = x; j < x + block_width; ++j) {
+								target.at(j, i) = color;
+							}
+						}
+					}
+				}
+			}, pass_stats);
+			pass.block_size = block_size;
+			out_of_time = end_pass();
+		}
+	}
+
+	pass.block_size = 1;
+	while (!out_of_time && pass.samples < settings.target_samples) {
+		float offset_x;
+		float offset_y;
+		SampleOffset(pass.samples, offset_x, offset_y);
+		const float weight = 1.0f / (pass.samples + 1);
+		RenderTiles(scheduler, width, height, [&](const Tile& tile) {
+			for (int i = tile.y; i < tile.y + tile.height; ++i) {
+				for (int j = tile.x; j < tile.x + tile.width; ++j) {
+					const int pixel = j + i * width;
+					accumulation[pixel] = accumulation[pixel] + trace_sample(j + offset_x, i + offset_y);
+					target.at(j, i) = accumulation[pixel] * weight;
+				}
+			}
+		}, pass_stats);
+		++pass.samples;
+		out_of_time = end_pass();
+	}
+
+	stats.wall_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+	return pass.samples;
+}
+
+}// namespace raytracing
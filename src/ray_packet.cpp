@@ -0,0 +1,70 @@
+#include "ray_packet.h"
+
+namespace {
+
+// Packets whose corner rays are further apart than this from the center
+// ray are traced as single rays, the frustum would reject too few nodes
+constexpr float kMinCornerCosine = 0.9f;
+
+} // namespace
+
+void RayPacket::Reset(const maths::Vector3f& packet_origin)
+{
+	origin = packet_origin;
+	ray_count = 0;
+}
+
+int RayPacket::Add(const maths::Vector3f& direction)
+{
+	const int lane = ray_count++;
+	direction_x[lane] = direction.x;
+	direction_y[lane] = direction.y;
+	direction_z[lane] = direction.z;
+	return lane;
+}
+
+bool RayPacket::BuildFrustum(
+	const maths::Vector3f& top_left,
+	const maths::Vector3f& top_right,
+	const maths::Vector3f& bottom_left,
+	const maths::Vector3f& bottom_right)
+{
+	center_direction = (top_left + top_right + bottom_left + bottom_right).Normalized();
+	if (maths::Vector3f::Dot(center_direction, top_left) < kMinCornerCosine
+		|| maths::Vector3f::Dot(center_direction, top_right) < kMinCornerCosine
+		|| maths::Vector3f::Dot(center_direction, bottom_left) < kMinCornerCosine
+		|| maths::Vector3f::Dot(center_direction, bottom_right) < kMinCornerCosine)
+	{
+		return false;
+	}
+
+	// Every plane goes through the shared origin and faces the inside of the packet
+	const std::array<maths::Vector3f, 4> corners = { top_left, top_right, bottom_right, bottom_left };
+	for (int i = 0; i < 4; ++i)
+	{
+		maths::Vector3f normal = maths::Vector3f::Cross(corners[i], corners[(i + 1) % 4]);
+		if (maths::Vector3f::Dot(normal, center_direction) < 0.0f)
+		{
+			normal = normal * -1.0f;
+		}
+		frustum_normals[i] = normal;
+	}
+	return true;
+}
+
+bool RayPacket::FrustumOverlaps(const maths::Vector3f& aabb_min, const maths::Vector3f& aabb_max) const
+{
+	for (const maths::Vector3f& normal : frustum_normals)
+	{
+		// Corner of the box that goes the furthest inside this plane
+		const maths::Vector3f corner(
+			normal.x >= 0.0f ? aabb_max.x : aabb_min.x,
+			normal.y >= 0.0f ? aabb_max.y : aabb_min.y,
+			normal.z >= 0.0f ? aabb_max.z : aabb_min.z);
+		if (maths::Vector3f::Dot(corner - origin, normal) < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -18,76 +18,250 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-#include <omp.h>
-#include <fstream>
-#include  <chrono>
+#include <algorithm>
 
 #include "raymarching.h"
 
 namespace raytracing {
-	
-	float raymarching_clamp(float& rgb_value) {
-		if (rgb_value > 255.0f) {
-			rgb_value = 255.0f;
-		}
-		if (rgb_value < 0.0f) {
-			rgb_value = 0.0f;
+
+	//Sizes in pixels of the blocks covered by the cones of the prepass, coarse then fine
+	constexpr int kConeCoarseBlock = 8;
+	constexpr int kConeFineBlock = 4;
+
+	RenderTarget RayMarcher::FrameBufferTarget() {
+		frame_buffer_.resize(static_cast<size_t>(width_) * height_);
+		return RenderTarget{ frame_buffer_.data(), width_, height_, width_ };
+	}
+
+	bool RayMarcher::SetTarget(const RenderTarget& target) {
+		if (target.pixels == nullptr || target.width < width_ || target.height < height_
+			|| target.row_stride() < target.width) {
+			return false;
 		}
-		return rgb_value;
+		target_ = target;
+		return true;
 	}
 
 	void RayMarcher::Render() {
-	auto begin = std::chrono::high_resolution_clock::now();
+		Render(FrameBufferTarget());
+	}
+
+	bool RayMarcher::Render(const RenderTarget& target) {
+		if (!SetTarget(target)) {
+			return false;
+		}
+		CullPrimaryNodes();
+		RenderTiles(scheduler_, width_, height_, [this](const Tile& tile) {
+			const int tile_end_x = tile.x + tile.width;
+			const int tile_end_y = tile.y + tile.height;
+			//The fine cones start where the coarse cone containing them stopped
+			//and the primary rays start where their fine cone stopped
+			for (int coarse_y = tile.y; coarse_y < tile_end_y; coarse_y += kConeCoarseBlock) {
+				for (int coarse_x = tile.x; coarse_x < tile_end_x; coarse_x += kConeCoarseBlock) {
+					const int coarse_end_x = std::min(coarse_x + kConeCoarseBlock, tile_end_x);
+					const int coarse_end_y = std::min(coarse_y + kConeCoarseBlock, tile_end_y);
+					if (!cone_prepass_) {
+						RenderBlock(coarse_x, coarse_y, coarse_end_x - coarse_x, coarse_end_y - coarse_y, 0.0f);
+						continue;
+					}
+					const float coarse_depth = ConeStartDepth(coarse_x, coarse_y,
+						coarse_end_x - coarse_x, coarse_end_y - coarse_y, 0.0f);
+
+					for (int fine_y = coarse_y; fine_y < coarse_end_y; fine_y += kConeFineBlock) {
+						for (int fine_x = coarse_x; fine_x < coarse_end_x; fine_x += kConeFineBlock) {
+							const int fine_end_x = std::min(fine_x + kConeFineBlock, coarse_end_x);
+							const int fine_end_y = std::min(fine_y + kConeFineBlock, coarse_end_y);
+							const float fine_depth = ConeStartDepth(fine_x, fine_y,
+								fine_end_x - fine_x, fine_end_y - fine_y, coarse_depth);
+							RenderBlock(fine_x, fine_y, fine_end_x - fine_x, fine_end_y - fine_y, fine_depth);
+						}
+					}
+				}
+			}
+		}, stats_);
+		if (adaptive_sampling_.max_samples > 1) {
+			RefineAdaptive(scheduler_, width_, height_,
+				[this](float x, float y) { return PrimarySample(x, y); },
+				adaptive_sampling_, primitive_ids_, target_, stats_);
+		}
+		if (write_image_) {
+			WriteImage();
+		}
+		return true;
+	}
+
+	void RayMarcher::CullPrimaryNodes() {
+		primary_nodes_ = nullptr;
+		if (!frustum_culling_ || scene_bvh_.empty()) {
+			return;
+		}
+		scene_bvh_.CullFrustum(camera_.ViewFrustum(0.0f, max_distance_), visible_nodes_);
+		primary_nodes_ = visible_nodes_.data();
+	}
 
-	#pragma omp parallel for
-		for (int i = 0; i < height_; ++i) {
-			for (int j = 0; j < width_; ++j) {
-				double dir_x = (j + 0.5f) - width_ / 2.0;
-				double dir_y = -(i + 0.5f) + height_ / 2.0;
-				double dir_z = -height_ / (2.0 * tan(fov_ / 2.0));
+	void RayMarcher::RenderBlock(int x, int y, int block_width, int block_height, float start_depth) {
+		float direction_x[kConeCoarseBlock * kConeCoarseBlock];
+		float direction_y[kConeCoarseBlock * kConeCoarseBlock];
+		float direction_z[kConeCoarseBlock * kConeCoarseBlock];
+		camera_.BlockDirections(x, y, block_width, block_height, direction_x, direction_y, direction_z);
+		int lane = 0;
+		for (int i = y; i < y + block_height; ++i) {
+			for (int j = x; j < x + block_width; ++j, ++lane) {
+				const PixelSample sample = MarchPrimary(
+					maths::Vector3f(direction_x[lane], direction_y[lane], direction_z[lane]), start_depth);
+				target_.at(j, i) = sample.color;
+				primitive_ids_[j + i * width_] = sample.primitive_id;
+			}
+		}
+	}
+
+	PixelSample RayMarcher::PrimarySample(float x, float y, float start_depth) {
+		return MarchPrimary(camera_.Direction(x, y), start_depth);
+	}
 
-				maths::Vector3f ray_direction = maths::Vector3f(dir_x, dir_y, dir_z).Normalized();
+	PixelSample RayMarcher::MarchPrimary(const maths::Vector3f& ray_direction, float start_depth) {
+		if (max_depth_ < 0) {
+			return PixelSample{ background_color_, -1 };
+		}
+		RAYTRACING_STAT_RAYS(RayType::kPrimary, 1);
+		const maths::Ray3 ray(camera_.position(), ray_direction);
+		PixelSample sample;
+		HitInfos hit_infos;
+		if (ClosestDistance(ray, hit_infos, start_depth, primary_nodes_) > max_distance_ - 0.0001f) {
+			sample.color = background_color_;
+			return sample;
+		}
+		sample.color = ShadeHit(ray_direction, hit_infos, 0);
+		sample.primitive_id = hit_infos.primitive_id;
+		return sample;
+	}
 
-				frame_buffer_[j + i * width_] = RayMarching(maths::Vector3f(0.0f, 0.0f, 0.0f),
-					ray_direction);
+	float RayMarcher::ConeStartDepth(
+		int x,
+		int y,
+		int block_width,
+		int block_height,
+		float start_depth) const {
+		const maths::Vector3f axis = camera_.Direction(x + block_width * 0.5f, y + block_height * 0.5f);
+		//The cone contains the rays through the corners of the block and so every pixel ray of it
+		float cos_angle = 1.0f;
+		const float corners_x[2] = { static_cast<float>(x), static_cast<float>(x + block_width) };
+		const float corners_y[2] = { static_cast<float>(y), static_cast<float>(y + block_height) };
+		for (float corner_y : corners_y) {
+			for (float corner_x : corners_x) {
+				cos_angle = std::min(cos_angle,
+					maths::Vector3f::Dot(axis, camera_.Direction(corner_x, corner_y)));
 			}
 		}
-		auto end = std::chrono::high_resolution_clock::now();
-		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-		std::cout << " raymarching duration : " << duration.count() << " microsecondes " << "\n";
-		WriteImage();
+		const float tan_angle = std::sqrt(std::max(0.0f, 1.0f - cos_angle * cos_angle)) / cos_angle;
+
+		//A ray of the cone reaches the axis depth t at a depth of at least t,
+		//the rays are empty before start_depth so the cone is before its projection on the axis
+		const maths::Ray3 ray(camera_.position(), axis);
+		float depth = start_depth * cos_angle;
+		for (int i = 0; i < max_marching_steps_ && depth < max_distance_; ++i) {
+			RAYTRACING_STAT_ADD(march_steps, 1);
+			int sphere_index;
+			const float dist = SceneDistance(ray.PointInRay(depth), sphere_index, max_distance_ - depth, primary_nodes_);
+			//The empty sphere around the axis point contains the cone section up to depth + step
+			const float cone_radius = depth * tan_angle;
+			const float step = (dist - cone_radius) / (1.0f + tan_angle);
+			//Steps smaller than the cone are left to the finer cones and the rays
+			if (step <= 0.0f || step < cone_radius) {
+				break;
+			}
+			depth += step;
+		}
+		return std::min(std::max(depth, start_depth), max_distance_);
+	}
+
+	int RayMarcher::RenderProgressive(const ProgressiveSettings& settings, const ProgressiveCallback& on_pass) {
+		return RenderProgressive(FrameBufferTarget(), settings, on_pass);
+	}
+
+	int RayMarcher::RenderProgressive(
+		const RenderTarget& target,
+		const ProgressiveSettings& settings,
+		const ProgressiveCallback& on_pass) {
+		if (!SetTarget(target)) {
+			return 0;
+		}
+		CullPrimaryNodes();
+		const int samples = raytracing::RenderProgressive(scheduler_, width_, height_,
+			[this](float x, float y) { return PrimarySample(x, y).color; },
+			settings, on_pass, target_, stats_);
+		if (write_image_) {
+			WriteImage();
+		}
+		return samples;
+	}
+
+	bool RayMarcher::LoadScene(const std::string& path) {
+		//The file replaces the previous one once nothing uses the records of that one
+		auto file = std::make_unique<MappedSceneFile>();
+		if (!file->Open(path)) {
+			return false;
+		}
+		const SceneFileCamera& camera = file->header().camera;
+		file->ViewSpheres(spheres_);
+		planes_ = file->ReadPlanes();
+		light_ = file->ReadLight();
+		SetImageParameters(camera.height, camera.width, camera.fov, camera.bias);
+		camera_.SetTransform(CameraTransform(camera));
+		file->ReadBvh(bvh_build_method_, scene_bvh_, scheduler_.thread_count());
+		scene_file_ = std::move(file);
+		return true;
 	}
 
-	void RayMarcher::WriteImage() {
-		std::ofstream ofs("./ray_marching_image.ppm", std::ios::out | std::ios::binary);
-		ofs << "P6\n" << width_ << " " << height_ << "\n255\n";
-		for (uint32_t i = 0; i < height_ * width_; ++i) {
-			char r = static_cast<char>(raymarching_clamp(frame_buffer_[i].x));
-			char g = static_cast<char>(raymarching_clamp(frame_buffer_[i].y));
-			char b = static_cast<char>(raymarching_clamp(frame_buffer_[i].z));
+	bool RayMarcher::SaveScene(const std::string& path) const {
+		SceneDescription scene;
+		scene.spheres = spheres_.ToSpheres();
+		scene.planes = planes_;
+		scene.light = light_;
+		scene.camera = ToSceneFileCamera(camera_, static_cast<float>(bias_));
+		return SaveSceneFile(path, scene, scene_bvh_);
+	}
 
-			ofs << r << g << b;
+	bool RayMarcher::WriteImage() {
+		if (target_.pixels == nullptr) {
+			return false;
 		}
-		ofs.close();
+		ConvertToRgb8(RenderTarget{ target_.pixels, width_, height_, target_.row_stride() }, image_);
+		return SaveImage(output_path_, image_, scheduler_.thread_count());
 	}
 
 	bool RayMarcher::ShadowRay(
 		const maths::Vector3f& hit_position,
 		const maths::Vector3f& hit_normal,
 		const maths::Vector3f& light_normal) {
+		RAYTRACING_STAT_RAYS(RayType::kShadow, 1);
 		//Add a bias along the normal to prevent self collision
 		const maths::Vector3f shadow_ray_origin(hit_position + hit_normal * bias_);
-		maths::Ray3 shadow_ray(shadow_ray_origin, light_normal);
-		Material tmp_material;
-		HitInfos shadow_hit_info;
+		const float light_distance = (light_.position - shadow_ray_origin).Magnitude();
 
-		float tmp_distance = ClosestDistance(shadow_ray, shadow_hit_info, tmp_material);
-		if(tmp_distance != max_distance_) {
-			return false;
+		// Return false if the point is in the shadow
+		return !Occluded(shadow_ray_origin, light_normal, light_distance);
+	}
+
+	bool RayMarcher::Occluded(
+		const maths::Vector3f& origin,
+		const maths::Vector3f& direction,
+		float max_distance) {
+		const maths::Ray3 ray(origin, direction);
+		const float end = std::min(max_distance, max_distance_);
+		float depth = static_cast<float>(bias_);
+
+		for (int i = 0; i < max_marching_steps_ && depth < end; ++i) {
+			RAYTRACING_STAT_ADD(march_steps, 1);
+			//Spheres further than the end of the segment can not stop the march
+			int sphere_index;
+			const float dist = SceneDistance(ray.PointInRay(depth), sphere_index, end - depth);
+			if (dist < 0.0001f) {
+				return true;
+			}
+			depth += dist;
 		}
-		
-		// Return that the point is in the light
-		return true;
+		return false;
 	}
 
 	maths::Vector3f RayMarcher::Reflect(
@@ -102,18 +276,27 @@ namespace raytracing {
 
 	float RayMarcher::ClosestDistance(maths::Ray3 ray, 
 									  HitInfos& hit_infos, 
-									  Material& hit_material) {
-		float depth = min_distance_;
-		maths::Sphere closest_sphere;
+									  float start_depth,
+									  const std::uint8_t* visible_nodes) {
+		RAYTRACING_STAT_ADD(marched_rays, 1);
+		if (march_method_ == MarchMethod::kRelaxed) {
+			return RelaxedClosestDistance(ray, hit_infos, start_depth, visible_nodes);
+		}
+		float depth = std::max(min_distance_, start_depth);
 
 		for (int i = 0; i < max_marching_steps_; ++i) {
+			RAYTRACING_STAT_ADD(march_steps, 1);
+			RAYTRACING_STAT_MAX(max_march_steps, i + 1);
 			maths::Vector3f p = ray.PointInRay(depth);
-			float dist = SceneSDF(p, closest_sphere);
+			//Only the spheres closer than the end of the march are evaluated,
+			//the sphere is resolved once it is hit
+			int sphere_index;
+			float dist = SceneDistance(p, sphere_index, max_distance_ - depth, visible_nodes);
 
-			if(dist < 0.0001f) {
-				hit_material = closest_sphere.material();
+			if(dist < 0.0001f && sphere_index >= 0) {
+				hit_infos.primitive_id = sphere_index;
 				hit_infos.hit_position = p;
-				hit_infos.normal = (p - closest_sphere.center()).Normalized();
+				hit_infos.distance = depth;
 				return depth;
 			}
 
@@ -125,20 +308,91 @@ namespace raytracing {
 		return max_distance_;
 	}
 
+	float RayMarcher::RelaxedClosestDistance(
+		const maths::Ray3& ray,
+		HitInfos& hit_infos,
+		float start_depth,
+		const std::uint8_t* visible_nodes) {
+		float factor = over_relaxation_;
+		float depth = std::max(min_distance_, start_depth);
+		float previous_depth = depth;
+		float previous_dist = 0.0f;
+
+		for (int i = 0; i < max_marching_steps_; ++i) {
+			RAYTRACING_STAT_ADD(march_steps, 1);
+			RAYTRACING_STAT_MAX(max_march_steps, i + 1);
+			maths::Vector3f p = ray.PointInRay(depth);
+			int sphere_index;
+			float dist = SceneDistance(p, sphere_index, max_distance_ - depth, visible_nodes);
+
+			//The empty spheres around the last two points do not overlap so a surface may
+			//have been stepped over, go back and only take plain steps from there
+			if (factor > 1.0f && i > 0 && dist + previous_dist < depth - previous_depth) {
+				factor = 1.0f;
+				depth = previous_depth + previous_dist;
+				continue;
+			}
+
+			//Nothing smaller than the pixel footprint can be seen, stop there
+			const float hit_threshold = std::max(0.0001f, camera_.pixel_cone() * depth);
+			if (dist < hit_threshold && sphere_index >= 0) {
+				//The point is only within a pixel of the surface, snap the hit on the sphere
+				//so the shading and the secondary rays start from the surface
+				float surface_depth;
+				if (spheres_.geometry(sphere_index).Intersect(ray, surface_depth)) {
+					hit_infos.primitive_id = sphere_index;
+					hit_infos.hit_position = ray.PointInRay(surface_depth);
+					hit_infos.distance = surface_depth;
+					return surface_depth;
+				}
+				//The ray only grazes the sphere, pass it with steps of at least the
+				//pixel footprint so the silhouettes are not dilated
+				previous_depth = depth;
+				previous_dist = dist;
+				depth += std::max(dist, hit_threshold);
+				if (depth >= max_distance_) {
+					return max_distance_;
+				}
+				continue;
+			}
+
+			previous_depth = depth;
+			previous_dist = dist;
+			depth += dist * factor;
+			if (depth >= max_distance_) {
+				return max_distance_;
+			}
+		}
+		return max_distance_;
+	}
+
 	maths::Vector3f RayMarcher::RayMarching(maths::Vector3f ray_origin, 
 											maths::Vector3f ray_direction,
-											const int& depth) {
+											const int& depth,
+											float start_depth) {
+		//Rays deeper than the max depth are not marched at all
+		if (depth > max_depth_) {
+			return background_color_;
+		}
 		maths::Ray3 ray{ ray_origin,ray_direction };
+		RAYTRACING_STAT_RAYS(depth == 0 ? RayType::kPrimary : RayType::kReflection, 1);
 
 		HitInfos hit_infos;
-		Material hit_material;
-
-		float distance = ClosestDistance(ray, hit_infos, hit_material);
+		float distance = ClosestDistance(ray, hit_infos, start_depth);
 
 		//didn't hit
-		if (distance > max_distance_ - 0.0001f || depth >=4) {
+		if (distance > max_distance_ - 0.0001f) {
 			return background_color_;
 		}
+		return ShadeHit(ray_direction, hit_infos, depth);
+	}
+
+	maths::Vector3f RayMarcher::ShadeHit(const maths::Vector3f& ray_direction,
+										 HitInfos& hit_infos,
+										 const int& depth) {
+		//The normal and the material are only resolved for the final hit
+		const Material& hit_material = spheres_.material(hit_infos.primitive_id);
+		hit_infos.normal = (hit_infos.hit_position - spheres_.geometry(hit_infos.primitive_id).center).Normalized();
 
 		//Compute the normal or direction of the light
 		maths::Vector3f light_normal(light_.position - hit_infos.hit_position);
@@ -167,30 +421,52 @@ namespace raytracing {
 			 const maths::Vector3f reflection_color = 
 				 RayMarching(reflection_origin, reflection_direction, depth + 1);
 
-			 hit_material.set_color(hit_material.color() * light_value
-				 += reflection_color * hit_material.reflexion_index());
-		 }
-		 else {
-			 //Point is in the shadow
-			 hit_material.set_color(hit_material.color() * light_value * in_light);
+			 return hit_material.color() * light_value
+				 + reflection_color * hit_material.reflexion_index();
 		 }
-		 return hit_material.color();
+		 //Point is in the shadow
+		 return hit_material.color() * light_value * in_light;
 	}
 
-	float RayMarcher::SceneSDF(maths::Vector3f position, maths::Sphere& closest_sphere) {
-		float dist = 100000.0f;
-
-		for(int i = 0; i < spheres_.size(); ++i) {
-			float distance = 0.0f;
+	float RayMarcher::SceneSDF(maths::Vector3f position, int& sphere_index) {
+		return scene_bvh_.NearestDistance(position, sphere_index, 100000.0f);
+	}
 
-			distance = spheres_[i].sdf(position);
+	float RayMarcher::SceneSDF(maths::Vector3f position) {
+		int sphere_index;
+		return scene_bvh_.NearestDistance(position, sphere_index, 100000.0f);
+	}
 
-			if(distance < dist) {
-				dist = distance;
-				closest_sphere = spheres_[i];
+	float RayMarcher::SceneDistance(
+		const maths::Vector3f& position,
+		int& sphere_index,
+		float max_distance,
+		const std::uint8_t* visible_nodes) const {
+		if (!distance_cache_.empty()) {
+			float upper_bound;
+			const float bound = distance_cache_.Bounds(position, upper_bound);
+			if (bound > distance_cache_.band()) {
+				sphere_index = -1;
+				return std::min(bound, max_distance);
 			}
+			//Spheres further than the upper bound can not be the nearest one,
+			//the band is kept as margin for the rounding of the lookup
+			return scene_bvh_.NearestDistance(position, sphere_index,
+				std::min(max_distance, upper_bound + distance_cache_.band()), visible_nodes);
+		}
+		return scene_bvh_.NearestDistance(position, sphere_index, max_distance, visible_nodes);
+	}
+
+	void RayMarcher::BakeDistanceCache(float cell_size, int brick_resolution) {
+		if (scene_bvh_.empty()) {
+			distance_cache_.Clear();
+			return;
 		}
-		return dist;
+		//Pad the scene bounds so the cells around the outer spheres exist
+		const BvhNode& root = scene_bvh_.nodes()[0];
+		const maths::Vector3f padding(cell_size, cell_size, cell_size);
+		distance_cache_.Build(scene_bvh_, root.aabb_min - padding, root.aabb_max + padding,
+			cell_size, brick_resolution, scheduler_.thread_count());
 	}
 
 }// namespace raytracing
\ No newline at end of file
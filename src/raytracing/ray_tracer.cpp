@@ -22,57 +22,28 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-#include <omp.h>
-#include  <chrono>
-#include <fstream>
+#include <algorithm>
 
 #include "raytracing/ray_tracer.h"
 
 namespace raytracing {
-	
-	float raytracer_clamp(float& rgb_value) {
-	if (rgb_value > 255.0f) {
-		rgb_value = 255.0f;
-	}
-	if (rgb_value < 0.0f) {
-		rgb_value = 0.0f;
-	}
-	return rgb_value;
-	}
 
 bool RayTracer::ObjectIntersect(
-	maths::Ray3& ray,
-	Material& hit_material, 
-	HitInfos& hit_info, 
-	float& distance) {
-	float max_distance = 1000000.0f;
-	distance = max_distance;
-
-	//std::vector<maths::Sphere> spheres_to_check = scene_octree_.Retrieve_spheres(ray);
-	std::vector<maths::Sphere> spheres_to_check;
-	spheres_to_check.reserve(1);
-	scene_octree_.Retrieve_2(ray, spheres_to_check);
-
-	for (int i = 0; i < spheres_to_check.size(); ++i) {
-		hit_info.distance = max_distance;
-		// Only render intersection for the nearest sphere,
-		// if distance is smaller than previously
-		if (ray.IntersectSphere(spheres_to_check[i], 
-			hit_info.hit_position, 
-			hit_info.distance)
-			&& hit_info.distance < distance) {
-			//Set hit info value regarding the object that was hit
-			hit_info.normal = maths::Vector3f(
-							  hit_info.hit_position - spheres_to_check[i].center()).Normalized();
-			hit_material = spheres_to_check[i].material();
-			distance = hit_info.distance;
-		}
-	}
-	if (distance != max_distance) {
-		// Means that the ray had an intersection
-		return true;
+	const maths::Ray3& ray,
+	HitInfos& hit_info) {
+	const float max_distance = 1000000.0f;
+	hit_info.primitive_id = -1;
+
+	if (use_bvh_) {
+		return scene_bvh_.Intersect(ray, hit_info.primitive_id, hit_info.distance, max_distance);
 	}
-	return false;
+	return scene_octree_.ClosestHit(ray, spheres_.geometry(), hit_info.primitive_id, hit_info.distance, max_distance);
+}
+
+void RayTracer::ResolveHit(const maths::Ray3& ray, HitInfos& hit_info) const {
+	hit_info.hit_position = ray.PointInRay(hit_info.distance);
+	hit_info.normal = maths::Vector3f(
+					  hit_info.hit_position - spheres_.geometry(hit_info.primitive_id).center).Normalized();
 }
 
 maths::Vector3f RayTracer::RayCast(
@@ -80,98 +51,268 @@ maths::Vector3f RayTracer::RayCast(
 	const maths::Vector3f& ray_direction, 
 	const int& depth) {
 	maths::Ray3 ray{ origin, ray_direction };
-	Material hit_object_material;
 	HitInfos hit_info;
-	float distance;
-	bool in_light;
 
-	//If the ray didn't hit anything or if the recursive depth of the raycasting
-	// is greater than 4, return background color
-	if (depth > 4 || !ObjectIntersect(ray, hit_object_material, hit_info, distance)) {
+	//If the recursive depth of the raycasting is greater than the max depth
+	//or if the ray didn't hit anything, return background color
+	if (depth > max_depth_) {
 		return background_color_;
 	}
-	else {
-		//Compute the normal or direction of the light
-		maths::Vector3f light_normal(light_.position - hit_info.hit_position);
-		light_normal.Normalize();
+	RAYTRACING_STAT_RAYS(depth == 0 ? RayType::kPrimary : RayType::kReflection, 1);
+	if (!ObjectIntersect(ray, hit_info)) {
+		return background_color_;
+	}
+	ResolveHit(ray, hit_info);
+	return Shade(ray_direction, hit_info, depth);
+}
+
+maths::Vector3f RayTracer::Shade(
+	const maths::Vector3f& ray_direction,
+	const HitInfos& hit_info,
+	const int& depth) {
+	const Material& hit_material = spheres_.material(hit_info.primitive_id);
+	//Compute the normal or direction of the light
+	maths::Vector3f light_normal(light_.position - hit_info.hit_position);
+	light_normal.Normalize();
 
-		//Compute shadow ray to check if point is in shadow
-		in_light = ShadowRay(hit_info.hit_position, hit_info.normal, light_normal);
+	//Compute shadow ray to check if point is in shadow
+	const bool in_light = ShadowRay(hit_info.hit_position, hit_info.normal, light_normal);
 
-		// Calculate how much light is the point getting
-		float light_value = maths::Vector3f::Dot(hit_info.normal, light_normal);
-		if (light_value < 0.0f) {
-			light_value = 0.0f;
+	// Calculate how much light is the point getting
+	float light_value = maths::Vector3f::Dot(hit_info.normal, light_normal);
+	if (light_value < 0.0f) {
+		light_value = 0.0f;
+	}
+
+	if (in_light) {
+		// Point is not in the shadow
+		// Cast reflexion ray recursively to compute reflexion color
+		const maths::Vector3f reflection_direction = Reflect(ray_direction, hit_info.normal).Normalized();
+		const maths::Vector3f reflection_origin(hit_info.hit_position + hit_info.normal * bias_);
+		const maths::Vector3f reflection_color = RayCast(reflection_origin, reflection_direction, depth + 1);
+		return hit_material.color() * light_value
+			+ reflection_color * hit_material.reflexion_index();
+	}
+	//Point is in the shadow
+	return hit_material.color() * light_value * in_light;
+}
+
+void RayTracer::RenderPacket(int column, int row, int columns, int rows) {
+	const int last_column = column + columns - 1;
+	const int last_row = row + rows - 1;
+	const maths::Vector3f& origin = camera_.position();
+
+	RayPacket packet;
+	packet.Reset(origin);
+	camera_.BlockDirections(column, row, columns, rows,
+		packet.direction_x, packet.direction_y, packet.direction_z);
+	packet.ray_count = columns * rows;
+
+	// Packets that are too wide fall back to single rays, and so do the octree,
+	// the binned spheres and a packet size of 1
+	if (!use_bvh_ || primary_binning_ || packet_size_ == 1 || packet.ray_count == 1 || !packet.BuildFrustum(
+		packet.direction(0), packet.direction(columns - 1),
+		packet.direction(packet.ray_count - columns), packet.direction(packet.ray_count - 1))) {
+		int lane = 0;
+		for (int i = row; i <= last_row; ++i) {
+			for (int j = column; j <= last_column; ++j, ++lane) {
+				const PixelSample sample = TracePrimary(j + 0.5f, i + 0.5f, packet.direction(lane));
+				target_.at(j, i) = sample.color;
+				primitive_ids_[j + i * width_] = sample.primitive_id;
+			}
 		}
+		return;
+	}
+
+	scene_bvh_.IntersectPacket(packet, 1000000.0f, primary_nodes_);
+	RAYTRACING_STAT_RAYS(RayType::kPrimary, packet.ray_count);
 
-		if (in_light) {
-			// Point is not in the shadow
-			// Cast reflexion ray recursively to compute reflexion color
-			const maths::Vector3f reflection_direction = Reflect(ray_direction, hit_info.normal).Normalized();
-			const maths::Vector3f reflection_origin(hit_info.hit_position + hit_info.normal * bias_);
-			const maths::Vector3f reflection_color = RayCast(reflection_origin, reflection_direction, depth + 1);
-			hit_object_material.set_color(hit_object_material.color() * light_value 
-				+= reflection_color * hit_object_material.reflexion_index());
+	int lane = 0;
+	for (int i = row; i <= last_row; ++i) {
+		for (int j = column; j <= last_column; ++j, ++lane) {
+			const int sphere_index = packet.sphere_index[lane];
+			primitive_ids_[j + i * width_] = sphere_index;
+			if (sphere_index < 0) {
+				target_.at(j, i) = background_color_;
+				continue;
+			}
+			const maths::Vector3f ray_direction = packet.direction(lane);
+			HitInfos hit_info;
+			hit_info.distance = packet.distance[lane];
+			hit_info.primitive_id = sphere_index;
+			ResolveHit(maths::Ray3(origin, ray_direction), hit_info);
+			target_.at(j, i) = Shade(ray_direction, hit_info, 0);
 		}
-		else {
-			//Point is in the shadow
-			hit_object_material.set_color(hit_object_material.color() * light_value * in_light);
+	}
+}
+
+void RayTracer::RenderTile(const Tile& tile) {
+	//Single rays still get their directions by blocks of the largest packet
+	const int block_size = use_bvh_ && !primary_binning_ && packet_size_ > 1 ? packet_size_ : 8;
+	for (int i = tile.y; i < tile.y + tile.height; i += block_size) {
+		for (int j = tile.x; j < tile.x + tile.width; j += block_size) {
+			RenderPacket(j, i,
+				std::min(block_size, tile.x + tile.width - j),
+				std::min(block_size, tile.y + tile.height - i));
 		}
-		return (hit_object_material.color());
 	}
 }
 
+PixelSample RayTracer::PrimarySample(float x, float y) {
+	return TracePrimary(x, y, camera_.Direction(x, y));
+}
+
+PixelSample RayTracer::TracePrimary(float x, float y, const maths::Vector3f& ray_direction) {
+	RAYTRACING_STAT_RAYS(RayType::kPrimary, 1);
+	const maths::Ray3 ray(camera_.position(), ray_direction);
+	PixelSample sample;
+	HitInfos hit_info;
+	bool hit;
+	if (primary_binning_) {
+		hit = sphere_bins_.Intersect(x, y, ray, hit_info.primitive_id, hit_info.distance);
+	} else if (primary_nodes_ != nullptr) {
+		hit = scene_bvh_.Intersect(ray, hit_info.primitive_id, hit_info.distance, 1000000.0f, primary_nodes_);
+	} else {
+		hit = ObjectIntersect(ray, hit_info);
+	}
+	if (!hit) {
+		sample.color = background_color_;
+		return sample;
+	}
+	ResolveHit(ray, hit_info);
+	sample.color = Shade(ray_direction, hit_info, 0);
+	sample.primitive_id = hit_info.primitive_id;
+	return sample;
+}
+
+void RayTracer::PreparePrimaryRays() {
+	primary_nodes_ = nullptr;
+	if (primary_binning_) {
+		sphere_bins_.Build(camera_, spheres_, bin_size_, scheduler_.thread_count());
+		return;
+	}
+	if (!frustum_culling_ || !use_bvh_ || scene_bvh_.empty()) {
+		return;
+	}
+	scene_bvh_.CullFrustum(camera_.ViewFrustum(0.0f, 1000000.0f), visible_nodes_);
+	primary_nodes_ = visible_nodes_.data();
+}
+
+RenderTarget RayTracer::FrameBufferTarget() {
+	frame_buffer_.resize(static_cast<size_t>(width_) * height_);
+	return RenderTarget{ frame_buffer_.data(), width_, height_, width_ };
+}
+
+bool RayTracer::SetTarget(const RenderTarget& target) {
+	if (target.pixels == nullptr || target.width < width_ || target.height < height_
+		|| target.row_stride() < target.width) {
+		return false;
+	}
+	target_ = target;
+	return true;
+}
+
 void RayTracer::Render() {
-	auto begin = std::chrono::high_resolution_clock::now();
-	#pragma omp parallel for
-	for (int i = 0; i < height_; ++i) {
-		for (int j = 0; j < width_; ++j) {
-			float dir_x = static_cast<float>(j + 0.5f) - width_ / 2.0f;
-			float dir_y = static_cast<float>(-(i + 0.5f)) + height_ / 2.0f;
-			float dir_z = -height_ / (2.0f * tan(fov_ / 2.0f));
-
-			maths::Vector3f ray_direction = maths::Vector3f(dir_x, dir_y, dir_z).Normalized();
-
-			frame_buffer_[j + i * width_] = RayCast(maths::Vector3f(0.0f, 0.0f, 0.0f),
-				ray_direction);
-		}
+	Render(FrameBufferTarget());
+}
+
+bool RayTracer::Render(const RenderTarget& target) {
+	if (!SetTarget(target)) {
+		return false;
+	}
+	PreparePrimaryRays();
+	RenderTiles(scheduler_, width_, height_, [this](const Tile& tile) { RenderTile(tile); }, stats_);
+	if (adaptive_sampling_.max_samples > 1) {
+		RefineAdaptive(scheduler_, width_, height_,
+			[this](float x, float y) { return PrimarySample(x, y); },
+			adaptive_sampling_, primitive_ids_, target_, stats_);
 	}
-	auto end = std::chrono::high_resolution_clock::now();
-	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-	std::cout << " raytracing duration : " << duration.count() << " microsecondes " << "\n";
-	WriteImage();
+	if (write_image_) {
+		WriteImage();
+	}
+	return true;
 }
 
-void RayTracer::WriteImage() {
-	std::ofstream ofs("./image.ppm", std::ios::out | std::ios::binary);
-	ofs << "P6\n" << width_ << " " << height_ << "\n255\n";
-	for (uint32_t i = 0; i < height_ * width_; ++i) {
-		char r = static_cast<char>(raytracer_clamp(frame_buffer_[i].x));
-		char g = static_cast<char>(raytracer_clamp(frame_buffer_[i].y));
-		char b = static_cast<char>(raytracer_clamp(frame_buffer_[i].z));
+int RayTracer::RenderProgressive(const ProgressiveSettings& settings, const ProgressiveCallback& on_pass) {
+	return RenderProgressive(FrameBufferTarget(), settings, on_pass);
+}
 
-		ofs << r << g << b;
+int RayTracer::RenderProgressive(
+	const RenderTarget& target,
+	const ProgressiveSettings& settings,
+	const ProgressiveCallback& on_pass) {
+	if (!SetTarget(target)) {
+		return 0;
+	}
+	PreparePrimaryRays();
+	const int samples = raytracing::RenderProgressive(scheduler_, width_, height_,
+		[this](float x, float y) { return PrimarySample(x, y).color; },
+		settings, on_pass, target_, stats_);
+	if (write_image_) {
+		WriteImage();
 	}
-	ofs.close();
+	return samples;
+}
+
+bool RayTracer::LoadScene(const std::string& path) {
+	//The file replaces the previous one once nothing uses the records of that one
+	auto file = std::make_unique<MappedSceneFile>();
+	if (!file->Open(path)) {
+		return false;
+	}
+	const SceneFileCamera& camera = file->header().camera;
+	file->ViewSpheres(spheres_);
+	planes_ = file->ReadPlanes();
+	light_ = file->ReadLight();
+	SetImageParameters(camera.height, camera.width, camera.fov, camera.bias);
+	camera_.SetTransform(CameraTransform(camera));
+	file->ReadBvh(bvh_build_method_, scene_bvh_, scheduler_.thread_count());
+	use_bvh_ = true;
+	scene_file_ = std::move(file);
+	return true;
+}
+
+bool RayTracer::SaveScene(const std::string& path) const {
+	SceneDescription scene;
+	scene.spheres = spheres_.ToSpheres();
+	scene.planes = planes_;
+	scene.light = light_;
+	scene.camera = ToSceneFileCamera(camera_, static_cast<float>(bias_));
+	//The octree is not stored, a scene set with one gets its bvh built when it is loaded
+	return SaveSceneFile(path, scene, use_bvh_ ? scene_bvh_ : Bvh());
+}
+
+bool RayTracer::WriteImage() {
+	if (target_.pixels == nullptr) {
+		return false;
+	}
+	ConvertToRgb8(RenderTarget{ target_.pixels, width_, height_, target_.row_stride() }, image_);
+	return SaveImage(output_path_, image_, scheduler_.thread_count());
 }
 
 bool RayTracer::ShadowRay(
 	const maths::Vector3f& hit_position, 
 	const maths::Vector3f& hit_normal, 
 	const maths::Vector3f& light_normal) {
+	RAYTRACING_STAT_RAYS(RayType::kShadow, 1);
 	//Add a bias along the normal to prevent self collision
 	const maths::Vector3f shadow_ray_origin(hit_position + hit_normal * bias_);
-	maths::Ray3 shadow_ray(shadow_ray_origin, light_normal);
-	Material tmp_material;
-	HitInfos shadow_hit_info;
-	float tmp_distance;
-		
-	if (ObjectIntersect(shadow_ray, tmp_material, shadow_hit_info, tmp_distance)) {
-		// Return that the point is in the shadow
-		return false;
+	const float light_distance = (light_.position - shadow_ray_origin).Magnitude();
+
+	// Return false if the point is in the shadow
+	return !Occluded(shadow_ray_origin, light_normal, light_distance);
+}
+
+bool RayTracer::Occluded(
+	const maths::Vector3f& origin,
+	const maths::Vector3f& direction,
+	float max_distance) {
+	const maths::Ray3 ray(origin, direction);
+	const float min_distance = static_cast<float>(bias_);
+	if (use_bvh_) {
+		return scene_bvh_.Occluded(ray, min_distance, max_distance);
 	}
-	// Return that the point is in the light
-	return true;
+	return scene_octree_.Occluded(ray, spheres_.geometry(), min_distance, max_distance);
 }
 
 maths::Vector3f RayTracer::Reflect(
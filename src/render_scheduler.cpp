@@ -0,0 +1,236 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <deque>
+
+#include "render_scheduler.h"
+
+namespace raytracing {
+
+namespace {
+
+//Deque of one worker, aligned so two workers never share a cache line
+struct alignas(64) TileQueue {
+	std::mutex mutex;
+	std::deque<Tile> tiles;
+};
+
+//The owner takes tiles from the front to keep scanline order
+bool PopTile(TileQueue& queue, Tile& tile) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tiles.empty()) {
+		return false;
+	}
+	tile = queue.tiles.front();
+	queue.tiles.pop_front();
+	return true;
+}
+
+//Thieves take tiles from the back, the furthest from what the owner works on
+bool StealTile(TileQueue& queue, Tile& tile) {
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tiles.empty()) {
+		return false;
+	}
+	tile = queue.tiles.back();
+	queue.tiles.pop_back();
+	return true;
+}
+
+//Pool whose job the current thread works on, a job started from it runs inline
+thread_local const WorkerPool* current_pool = nullptr;
+
+//Split count items in workers contiguous chunks
+void RunChunks(
+	WorkerPool& pool,
+	int count,
+	int workers,
+	const std::function<void(int begin, int end, int thread_index)>& body) {
+	pool.Run(workers, [&](int worker_index) {
+		body(static_cast<int>(static_cast<long long>(count) * worker_index / workers),
+			static_cast<int>(static_cast<long long>(count) * (worker_index + 1) / workers), worker_index);
+	});
+}
+
+}// namespace
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread& thread : threads_) {
+		thread.join();
+	}
+}
+
+void WorkerPool::Run(int workers, const std::function<void(int worker_index)>& job) {
+	if (workers <= 1 || current_pool == this) {
+		for (int i = 0; i < workers; ++i) {
+			job(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_lock(run_mutex_);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		//Worker i of the pool is thread i - 1, the threads are only added
+		for (int i = static_cast<int>(threads_.size()) + 1; i < workers; ++i) {
+			threads_.emplace_back(&WorkerPool::WorkerLoop, this, i);
+		}
+		job_ = &job;
+		job_workers_ = workers;
+		pending_ = workers - 1;
+		++generation_;
+	}
+	wake_.notify_all();
+
+	const WorkerPool* previous_pool = current_pool;
+	current_pool = this;
+	job(0);
+	current_pool = previous_pool;
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return pending_ == 0; });
+	job_ = nullptr;
+}
+
+void WorkerPool::WorkerLoop(int worker_index) {
+	current_pool = this;
+	std::uint64_t seen_generation = 0;
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		wake_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+		if (stop_) {
+			return;
+		}
+		seen_generation = generation_;
+		if (worker_index >= job_workers_) {
+			continue;
+		}
+		const std::function<void(int)>& job = *job_;
+		lock.unlock();
+		job(worker_index);
+		lock.lock();
+		if (--pending_ == 0) {
+			done_.notify_one();
+		}
+	}
+}
+
+RenderScheduler& RenderScheduler::operator=(const RenderScheduler& other) {
+	thread_count_ = other.thread_count_;
+	tile_size_ = other.tile_size_;
+	return *this;
+}
+
+WorkerPool& RenderScheduler::pool() {
+	if (pool_ == nullptr) {
+		pool_ = std::make_unique<WorkerPool>();
+	}
+	return *pool_;
+}
+
+int ResolveThreadCount(int thread_count) {
+	if (thread_count > 0) {
+		return thread_count;
+	}
+	const int hardware_threads = static_cast<int>(std::thread::hardware_concurrency());
+	return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+int RenderScheduler::thread_count() const {
+	return ResolveThreadCount(thread_count_);
+}
+
+void RenderScheduler::Run(
+	int width,
+	int height,
+	const std::function<void(const Tile& tile, int thread_index)>& render_tile) {
+	const int tiles_x = (width + tile_size_ - 1) / tile_size_;
+	const int tiles_y = (height + tile_size_ - 1) / tile_size_;
+	const int tile_count = tiles_x * tiles_y;
+	if (tile_count == 0) {
+		return;
+	}
+	const int workers = std::min(thread_count(), tile_count);
+
+	//Give every worker a contiguous band of tiles to start with
+	std::unique_ptr<TileQueue[]> queues(new TileQueue[workers]);
+	for (int i = 0; i < tile_count; ++i) {
+		Tile tile;
+		tile.x = (i % tiles_x) * tile_size_;
+		tile.y = (i / tiles_x) * tile_size_;
+		tile.width = std::min(tile_size_, width - tile.x);
+		tile.height = std::min(tile_size_, height - tile.y);
+		queues[static_cast<long long>(i) * workers / tile_count].tiles.push_back(tile);
+	}
+
+	auto work = [&](int thread_index) {
+		Tile tile;
+		for (;;) {
+			if (PopTile(queues[thread_index], tile)) {
+				render_tile(tile, thread_index);
+				continue;
+			}
+			//No tile are added during a run, so when every queue is empty the work is done
+			bool stolen = false;
+			for (int i = 1; i < workers && !stolen; ++i) {
+				stolen = StealTile(queues[(thread_index + i) % workers], tile);
+			}
+			if (!stolen) {
+				return;
+			}
+			render_tile(tile, thread_index);
+		}
+	};
+
+	pool().Run(workers, work);
+}
+
+void RenderScheduler::ParallelFor(
+	int count,
+	const std::function<void(int begin, int end, int thread_index)>& body) {
+	if (count <= 0) {
+		return;
+	}
+	RunChunks(pool(), count, std::min(thread_count(), count), body);
+}
+
+void ParallelFor(
+	int count,
+	int thread_count,
+	const std::function<void(int begin, int end, int thread_index)>& body) {
+	if (count <= 0) {
+		return;
+	}
+	static WorkerPool shared_pool;
+	const int workers = std::min(ResolveThreadCount(thread_count), count);
+	RunChunks(shared_pool, count, workers, body);
+}
+
+}// namespace raytracing
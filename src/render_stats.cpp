@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <chrono>
+
+#include "render_stats.h"
+
+namespace raytracing {
+
+void StatCounters::Merge(const StatCounters& other) {
+	for (int i = 0; i < static_cast<int>(RayType::kCount); ++i) {
+		rays[i] += other.rays[i];
+	}
+	nodes_visited += other.nodes_visited;
+	sphere_tests += other.sphere_tests;
+	march_steps += other.march_steps;
+	marched_rays += other.marched_rays;
+	max_march_steps = std::max(max_march_steps, other.max_march_steps);
+}
+
+void RenderStats::Accumulate(const RenderStats& pass) {
+	counters.Merge(pass.counters);
+	thread_busy_seconds.resize(std::max(thread_busy_seconds.size(), pass.thread_busy_seconds.size()), 0.0);
+	for (size_t i = 0; i < pass.thread_busy_seconds.size(); ++i) {
+		thread_busy_seconds[i] += pass.thread_busy_seconds[i];
+	}
+}
+
+double RenderStats::MraysPerSecond(RayType type) const {
+	if (wall_seconds <= 0.0) {
+		return 0.0;
+	}
+	return counters.rays[static_cast<int>(type)] / wall_seconds / 1e6;
+}
+
+double RenderStats::MraysPerSecond() const {
+	if (wall_seconds <= 0.0) {
+		return 0.0;
+	}
+	std::uint64_t total = 0;
+	for (int i = 0; i < static_cast<int>(RayType::kCount); ++i) {
+		total += counters.rays[i];
+	}
+	return total / wall_seconds / 1e6;
+}
+
+double RenderStats::AverageMarchSteps() const {
+	if (counters.marched_rays == 0) {
+		return 0.0;
+	}
+	return static_cast<double>(counters.march_steps) / counters.marched_rays;
+}
+
+double RenderStats::AverageSamplesPerPixel() const {
+	if (sampled_pixels == 0) {
+		return 0.0;
+	}
+	return static_cast<double>(pixel_samples) / sampled_pixels;
+}
+
+void RenderTiles(
+	RenderScheduler& scheduler,
+	int width,
+	int height,
+	const std::function<void(const Tile& tile)>& render_tile,
+	RenderStats& stats) {
+	using Clock = std::chrono::steady_clock;
+	const int thread_count = scheduler.thread_count();
+	std::vector<double> busy_seconds(thread_count, 0.0);
+	std::vector<StatCounters> thread_counters(thread_count);
+
+	const Clock::time_point frame_begin = Clock::now();
+	scheduler.Run(width, height, [&](const Tile& tile, int thread_index) {
+#if RAYTRACING_ENABLE_STATS
+		local_stat_counters.Reset();
+#endif
+		const Clock::time_point tile_begin = Clock::now();
+		render_tile(tile);
+		busy_seconds[thread_index] += std::chrono::duration<double>(Clock::now() - tile_begin).count();
+#if RAYTRACING_ENABLE_STATS
+		//Every thread only writes its own slot, they are merged once the frame is done
+		thread_counters[thread_index].Merge(local_stat_counters);
+#endif
+	});
+
+	stats.wall_seconds = std::chrono::duration<double>(Clock::now() - frame_begin).count();
+	stats.thread_busy_seconds = busy_seconds;
+	stats.counters.Reset();
+	stats.pixel_samples = 0;
+	stats.sampled_pixels = 0;
+	stats.refined_pixels = 0;
+	stats.max_pixel_samples = 0;
+	for (const StatCounters& counters : thread_counters) {
+		stats.counters.Merge(counters);
+	}
+}
+
+}// namespace raytracing
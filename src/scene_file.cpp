@@ -0,0 +1,409 @@
+/*
+MIT License
+
+Copyright (c) 2021 SAE Institute Geneva
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <map>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "scene_file.h"
+
+namespace raytracing {
+
+static_assert(sizeof(SceneFileHeader) == 280, "The scene file header layout changed");
+static_assert(sizeof(SceneFileMaterial) == 16, "The scene file material layout changed");
+static_assert(sizeof(SceneFilePlane) == 28, "The scene file plane layout changed");
+//The spheres and the bvh nodes are stored as they are in memory
+static_assert(sizeof(PackedSphere) == 16, "The packed sphere layout changed");
+static_assert(sizeof(BvhNode) == 32, "The bvh node layout changed");
+static_assert(kSceneFileAlignment % alignof(PackedSphere) == 0 && kSceneFileAlignment % alignof(BvhNode) == 0,
+	"The sections have to be aligned for the records used in place");
+
+namespace {
+
+std::uint64_t AlignOffset(std::uint64_t offset) {
+	return (offset + kSceneFileAlignment - 1) / kSceneFileAlignment * kSceneFileAlignment;
+}
+
+void CopyVector(const maths::Vector3f& vector, float* values) {
+	values[0] = vector.x;
+	values[1] = vector.y;
+	values[2] = vector.z;
+}
+
+//Index of the material in the table, the material is added the first time it is seen
+std::int32_t MaterialIndex(
+	const Material& material,
+	std::map<std::array<float, 4>, std::int32_t>& indices,
+	std::vector<SceneFileMaterial>& materials) {
+	const maths::Vector3f color = material.color();
+	const std::array<float, 4> key = { color.x, color.y, color.z, material.reflexion_index() };
+	const auto found = indices.find(key);
+	if (found != indices.end()) {
+		return found->second;
+	}
+	const std::int32_t index = static_cast<std::int32_t>(materials.size());
+	indices.emplace(key, index);
+	materials.push_back(SceneFileMaterial{ { key[0], key[1], key[2] }, key[3] });
+	return index;
+}
+
+//Copy the records of a section at the next aligned offset of the file
+template<typename T>
+void AppendSection(
+	std::vector<std::uint8_t>& data,
+	SceneFileHeader& header,
+	SceneFileSection section,
+	const T* records,
+	std::uint64_t count) {
+	const std::uint64_t offset = AlignOffset(data.size());
+	data.resize(offset + count * sizeof(T), 0);
+	if (count > 0) {
+		std::memcpy(data.data() + offset, records, count * sizeof(T));
+	}
+	header.sections[static_cast<int>(section)] = SceneFileSectionRange{ offset, count };
+}
+
+Material ToMaterial(const SceneFileMaterial& material) {
+	return Material(material.reflexion_index,
+		maths::Vector3f(material.color[0], material.color[1], material.color[2]));
+}
+
+}// namespace
+
+SceneFileCamera ToSceneFileCamera(const Camera& camera, float bias) {
+	SceneFileCamera result;
+	result.width = camera.width();
+	result.height = camera.height();
+	result.fov = camera.fov();
+	result.bias = bias;
+	const maths::Matrix4f& transform = camera.transform();
+	for (int column = 0; column < 4; ++column) {
+		const maths::Vector4f& values = transform[column];
+		result.camera_to_world[column * 4] = values.x;
+		result.camera_to_world[column * 4 + 1] = values.y;
+		result.camera_to_world[column * 4 + 2] = values.z;
+		result.camera_to_world[column * 4 + 3] = values.w;
+	}
+	return result;
+}
+
+maths::Matrix4f CameraTransform(const SceneFileCamera& camera) {
+	const float* values = camera.camera_to_world;
+	return maths::Matrix4f(
+		maths::Vector4f(values[0], values[1], values[2], values[3]),
+		maths::Vector4f(values[4], values[5], values[6], values[7]),
+		maths::Vector4f(values[8], values[9], values[10], values[11]),
+		maths::Vector4f(values[12], values[13], values[14], values[15]));
+}
+
+std::uint32_t HashSceneSpheres(const PackedSphere* spheres, std::uint64_t count) {
+	//FNV-1a over the 32 bits words of the records
+	static_assert(sizeof(PackedSphere) % sizeof(std::uint32_t) == 0, "Sphere records are hashed by words");
+	const std::uint64_t word_count = count * sizeof(PackedSphere) / sizeof(std::uint32_t);
+	const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(spheres);
+	std::uint32_t hash = 2166136261u;
+	for (std::uint64_t i = 0; i < word_count; ++i) {
+		std::uint32_t word;
+		std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+		hash = (hash ^ word) * 16777619u;
+	}
+	return hash;
+}
+
+bool SaveSceneFile(const std::string& path, const SceneDescription& scene, const Bvh& bvh) {
+	std::map<std::array<float, 4>, std::int32_t> material_indices;
+	std::vector<SceneFileMaterial> materials;
+
+	std::vector<PackedSphere> spheres(scene.spheres.size());
+	std::vector<std::int32_t> sphere_materials(scene.spheres.size());
+	for (size_t i = 0; i < scene.spheres.size(); ++i) {
+		const maths::Sphere& sphere = scene.spheres[i];
+		spheres[i].center = sphere.center();
+		spheres[i].radius = sphere.radius();
+		sphere_materials[i] = MaterialIndex(sphere.material(), material_indices, materials);
+	}
+	std::vector<SceneFilePlane> planes(scene.planes.size());
+	for (size_t i = 0; i < scene.planes.size(); ++i) {
+		const maths::Plane& plane = scene.planes[i];
+		CopyVector(plane.point(), planes[i].point);
+		CopyVector(plane.normal(), planes[i].normal);
+		planes[i].material = MaterialIndex(plane.material(), material_indices, materials);
+	}
+
+	//The bvh is only kept if it was built over these spheres
+	const bool store_bvh = !bvh.empty() && bvh.store().size() == static_cast<int>(spheres.size());
+	const std::uint64_t store_size = store_bvh ? SphereStore::padded_size(bvh.store().size()) : 0;
+
+	SceneFileHeader header{};
+	std::memcpy(header.magic, kSceneFileMagic, sizeof(header.magic));
+	header.version = kSceneFileVersion;
+	header.byte_order = kSceneFileByteOrder;
+	header.camera = scene.camera;
+	CopyVector(scene.light.position, header.light_position);
+	header.bvh_spheres_hash = HashSceneSpheres(spheres.data(), spheres.size());
+
+	std::vector<std::uint8_t> data(sizeof(SceneFileHeader));
+	AppendSection(data, header, SceneFileSection::kMaterials, materials.data(), materials.size());
+	AppendSection(data, header, SceneFileSection::kSpheres, spheres.data(), spheres.size());
+	AppendSection(data, header, SceneFileSection::kSphereMaterials, sphere_materials.data(), sphere_materials.size());
+	AppendSection(data, header, SceneFileSection::kPlanes, planes.data(), planes.size());
+	AppendSection(data, header, SceneFileSection::kBvhNodes,
+		bvh.nodes(), store_bvh ? static_cast<std::uint64_t>(bvh.node_count()) : 0);
+	const SphereStore& store = bvh.store();
+	AppendSection(data, header, SceneFileSection::kBvhCenterX, store.center_x_data(), store_size);
+	AppendSection(data, header, SceneFileSection::kBvhCenterY, store.center_y_data(), store_size);
+	AppendSection(data, header, SceneFileSection::kBvhCenterZ, store.center_z_data(), store_size);
+	AppendSection(data, header, SceneFileSection::kBvhSquaredRadius, store.squared_radius_data(), store_size);
+	AppendSection(data, header, SceneFileSection::kBvhOrder, store.id_data(), store_size);
+	header.file_size = data.size();
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	std::ofstream ofs(path, std::ios::out | std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(ofs);
+}
+
+MappedSceneFile::~MappedSceneFile() {
+	Close();
+}
+
+bool MappedSceneFile::Open(const std::string& path) {
+	Close();
+#if defined(_WIN32)
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE) {
+		file_ = nullptr;
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr) {
+		Close();
+		return false;
+	}
+	data_ = static_cast<const std::uint8_t*>(view);
+	size_ = static_cast<std::uint64_t>(file_size.QuadPart);
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+		close(file);
+		return false;
+	}
+	//The mapping stays valid once the file is closed
+	void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+	data_ = static_cast<const std::uint8_t*>(view);
+	size_ = static_cast<std::uint64_t>(file_stat.st_size);
+#endif
+	if (!Validate()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedSceneFile::Close() {
+#if defined(_WIN32)
+	if (data_ != nullptr) {
+		UnmapViewOfFile(data_);
+	}
+	if (mapping_ != nullptr) {
+		CloseHandle(mapping_);
+	}
+	if (file_ != nullptr) {
+		CloseHandle(file_);
+	}
+	mapping_ = nullptr;
+	file_ = nullptr;
+#else
+	if (data_ != nullptr) {
+		munmap(const_cast<std::uint8_t*>(data_), static_cast<size_t>(size_));
+	}
+#endif
+	data_ = nullptr;
+	size_ = 0;
+}
+
+bool MappedSceneFile::Validate() const {
+	if (size_ < sizeof(SceneFileHeader)) {
+		return false;
+	}
+	const SceneFileHeader& file_header = header();
+	if (std::memcmp(file_header.magic, kSceneFileMagic, sizeof(file_header.magic)) != 0
+		|| file_header.version != kSceneFileVersion
+		|| file_header.byte_order != kSceneFileByteOrder
+		|| file_header.file_size != size_
+		|| file_header.camera.width <= 0
+		|| file_header.camera.height <= 0) {
+		return false;
+	}
+
+	const std::uint64_t record_sizes[static_cast<int>(SceneFileSection::kCount)] = {
+		sizeof(SceneFileMaterial), sizeof(PackedSphere), sizeof(std::int32_t), sizeof(SceneFilePlane),
+		sizeof(BvhNode), sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(std::int32_t) };
+	for (int i = 0; i < static_cast<int>(SceneFileSection::kCount); ++i) {
+		const SceneFileSectionRange& range = file_header.sections[i];
+		if (range.offset % kSceneFileAlignment != 0 || range.offset < sizeof(SceneFileHeader)
+			|| range.offset > size_ || range.count > (size_ - range.offset) / record_sizes[i]) {
+			return false;
+		}
+	}
+
+	const std::uint64_t sphere_count = count(SceneFileSection::kSpheres);
+	if (sphere_count != count(SceneFileSection::kSphereMaterials)
+		|| sphere_count > static_cast<std::uint64_t>(std::numeric_limits<int>::max() - SphereStore::kBatchSize)) {
+		return false;
+	}
+	const std::uint64_t material_count = count(SceneFileSection::kMaterials);
+	const std::int32_t* sphere_materials = section<std::int32_t>(SceneFileSection::kSphereMaterials);
+	for (std::uint64_t i = 0; i < sphere_count; ++i) {
+		if (sphere_materials[i] < 0 || static_cast<std::uint64_t>(sphere_materials[i]) >= material_count) {
+			return false;
+		}
+	}
+	const SceneFilePlane* planes = section<SceneFilePlane>(SceneFileSection::kPlanes);
+	for (std::uint64_t i = 0; i < count(SceneFileSection::kPlanes); ++i) {
+		if (planes[i].material < 0 || static_cast<std::uint64_t>(planes[i].material) >= material_count) {
+			return false;
+		}
+	}
+	//The bvh nodes themselves are checked when they are given to a bvh
+	const std::uint64_t store_size = count(SceneFileSection::kBvhOrder);
+	for (SceneFileSection store_section : { SceneFileSection::kBvhCenterX, SceneFileSection::kBvhCenterY,
+		SceneFileSection::kBvhCenterZ, SceneFileSection::kBvhSquaredRadius }) {
+		if (count(store_section) != store_size) {
+			return false;
+		}
+	}
+	return store_size == 0 || store_size == static_cast<std::uint64_t>(SphereStore::padded_size(static_cast<int>(sphere_count)));
+}
+
+bool MappedSceneFile::has_current_bvh() const {
+	const std::uint64_t sphere_count = count(SceneFileSection::kSpheres);
+	return count(SceneFileSection::kBvhNodes) > 0
+		&& count(SceneFileSection::kBvhOrder) == static_cast<std::uint64_t>(SphereStore::padded_size(static_cast<int>(sphere_count)))
+		&& header().bvh_spheres_hash == HashSceneSpheres(
+			section<PackedSphere>(SceneFileSection::kSpheres), sphere_count);
+}
+
+std::vector<Material> MappedSceneFile::ReadMaterials() const {
+	const SceneFileMaterial* materials = section<SceneFileMaterial>(SceneFileSection::kMaterials);
+	std::vector<Material> result(count(SceneFileSection::kMaterials));
+	for (size_t i = 0; i < result.size(); ++i) {
+		result[i] = ToMaterial(materials[i]);
+	}
+	return result;
+}
+
+void MappedSceneFile::Read(SceneDescription& scene) const {
+	SphereTable spheres;
+	ViewSpheres(spheres);
+	scene.spheres = spheres.ToSpheres();
+	scene.planes = ReadPlanes();
+	scene.light = ReadLight();
+	scene.camera = header().camera;
+}
+
+void MappedSceneFile::ViewSpheres(SphereTable& spheres) const {
+	spheres.View(section<PackedSphere>(SceneFileSection::kSpheres),
+		section<std::int32_t>(SceneFileSection::kSphereMaterials),
+		static_cast<int>(count(SceneFileSection::kSpheres)),
+		ReadMaterials());
+}
+
+std::vector<maths::Plane> MappedSceneFile::ReadPlanes() const {
+	const SceneFileMaterial* materials = section<SceneFileMaterial>(SceneFileSection::kMaterials);
+	const SceneFilePlane* planes = section<SceneFilePlane>(SceneFileSection::kPlanes);
+	std::vector<maths::Plane> result(count(SceneFileSection::kPlanes));
+	for (size_t i = 0; i < result.size(); ++i) {
+		const SceneFilePlane& plane = planes[i];
+		result[i] = maths::Plane(
+			maths::Vector3f(plane.point[0], plane.point[1], plane.point[2]),
+			maths::Vector3f(plane.normal[0], plane.normal[1], plane.normal[2]));
+		result[i].SetMaterial(ToMaterial(materials[plane.material]));
+	}
+	return result;
+}
+
+PointLight MappedSceneFile::ReadLight() const {
+	const float* position = header().light_position;
+	PointLight light;
+	light.position = maths::Vector3f(position[0], position[1], position[2]);
+	return light;
+}
+
+bool MappedSceneFile::ReadBvh(BvhBuildMethod method, Bvh& bvh, int thread_count) const {
+	const int sphere_count = static_cast<int>(count(SceneFileSection::kSpheres));
+	if (has_current_bvh()) {
+		SphereStore store;
+		store.View(section<float>(SceneFileSection::kBvhCenterX),
+			section<float>(SceneFileSection::kBvhCenterY),
+			section<float>(SceneFileSection::kBvhCenterZ),
+			section<float>(SceneFileSection::kBvhSquaredRadius),
+			section<std::int32_t>(SceneFileSection::kBvhOrder),
+			sphere_count);
+		if (bvh.Assign(section<BvhNode>(SceneFileSection::kBvhNodes),
+			static_cast<int>(count(SceneFileSection::kBvhNodes)), store)) {
+			return true;
+		}
+	}
+	SphereTable spheres;
+	ViewSpheres(spheres);
+	bvh.Build(spheres.ToSpheres(), method, thread_count);
+	return false;
+}
+
+}// namespace raytracing
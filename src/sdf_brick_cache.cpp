@@ -0,0 +1,158 @@
+#include "sdf_brick_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "render_scheduler.h"
+
+namespace {
+
+// Distance used when a sample has no sphere around, far enough to never limit a step
+constexpr float kFarDistance = 1000000.0f;
+
+inline float Lerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
+} // namespace
+
+void SdfBrickCache::Build(
+	const Bvh& bvh,
+	const maths::Vector3f& aabb_min,
+	const maths::Vector3f& aabb_max,
+	float cell_size,
+	int brick_resolution,
+	int thread_count)
+{
+	Clear();
+	if (bvh.empty() || cell_size <= 0.0f || brick_resolution < 1) return;
+
+	const maths::Vector3f extent = aabb_max - aabb_min;
+	cell_size_ = cell_size;
+	cells_x_ = std::max(1, static_cast<int>(std::ceil(extent.x / cell_size)));
+	cells_y_ = std::max(1, static_cast<int>(std::ceil(extent.y / cell_size)));
+	cells_z_ = std::max(1, static_cast<int>(std::ceil(extent.z / cell_size)));
+	aabb_min_ = aabb_min;
+	aabb_max_ = aabb_min + maths::Vector3f(
+		cells_x_ * cell_size, cells_y_ * cell_size, cells_z_ * cell_size);
+	brick_resolution_ = brick_resolution;
+	voxel_size_ = cell_size / brick_resolution;
+	interpolation_error_ = voxel_size_ * std::sqrt(3.0f) * 0.5f;
+	band_ = voxel_size_;
+
+	const int cell_count = cells_x_ * cells_y_ * cells_z_;
+	half_diagonal_ = cell_size * std::sqrt(3.0f) * 0.5f;
+	auto cell_corner = [&](int cell) {
+		const int x = cell % cells_x_;
+		const int y = (cell / cells_x_) % cells_y_;
+		const int z = cell / (cells_x_ * cells_y_);
+		return aabb_min_ + maths::Vector3f(x * cell_size, y * cell_size, z * cell_size);
+	};
+
+	// The distance field is 1-lipschitz, so the distance anywhere in a cell is
+	// the distance at its center plus or minus the half diagonal
+	cells_.assign(cell_count, -1);
+	cell_distances_.assign(cell_count, 0.0f);
+	raytracing::ParallelFor(cell_count, thread_count, [&](int begin, int end, int) {
+		for (int cell = begin; cell < end; ++cell)
+		{
+			const maths::Vector3f center = cell_corner(cell)
+				+ maths::Vector3f(cell_size, cell_size, cell_size) * 0.5f;
+			int sphere_index;
+			cell_distances_[cell] = bvh.NearestDistance(center, sphere_index, kFarDistance);
+		}
+	});
+
+	// Only the cells that could contain a surface within one cell get a brick
+	std::vector<int> brick_cells;
+	for (int cell = 0; cell < cell_count; ++cell)
+	{
+		if (cell_distances_[cell] - half_diagonal_ < cell_size)
+		{
+			cells_[cell] = brick_count_++;
+			brick_cells.push_back(cell);
+		}
+	}
+
+	const int side = brick_resolution_ + 1;
+	samples_.resize(static_cast<size_t>(brick_count_) * side * side * side);
+	raytracing::ParallelFor(brick_count_, thread_count, [&](int begin, int end, int) {
+		for (int brick = begin; brick < end; ++brick)
+		{
+			const maths::Vector3f corner = cell_corner(brick_cells[brick]);
+			// No sample is further than the half diagonal from the center
+			const float max_distance = cell_distances_[brick_cells[brick]] + half_diagonal_ + voxel_size_;
+			for (int z = 0; z < side; ++z)
+			{
+				for (int y = 0; y < side; ++y)
+				{
+					for (int x = 0; x < side; ++x)
+					{
+						const maths::Vector3f sample = corner
+							+ maths::Vector3f(x * voxel_size_, y * voxel_size_, z * voxel_size_);
+						int sphere_index;
+						samples_[SampleIndex(brick, x, y, z)] =
+							bvh.NearestDistance(sample, sphere_index, max_distance);
+					}
+				}
+			}
+		}
+	});
+}
+
+void SdfBrickCache::Clear()
+{
+	cells_.clear();
+	cell_distances_.clear();
+	samples_.clear();
+	brick_count_ = 0;
+	cells_x_ = cells_y_ = cells_z_ = 0;
+}
+
+float SdfBrickCache::Bounds(const maths::Vector3f& point, float& upper_bound) const
+{
+	upper_bound = kFarDistance;
+	const maths::Vector3f local = (point - aabb_min_) / cell_size_;
+	if (local.x < 0.0f || local.y < 0.0f || local.z < 0.0f
+		|| local.x >= cells_x_ || local.y >= cells_y_ || local.z >= cells_z_)
+	{
+		// Every sphere is inside the grid so the distance to the grid is a lower bound
+		const float dx = std::max(std::max(aabb_min_.x - point.x, 0.0f), point.x - aabb_max_.x);
+		const float dy = std::max(std::max(aabb_min_.y - point.y, 0.0f), point.y - aabb_max_.y);
+		const float dz = std::max(std::max(aabb_min_.z - point.z, 0.0f), point.z - aabb_max_.z);
+		return std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	const int cell_x = std::min(static_cast<int>(local.x), cells_x_ - 1);
+	const int cell_y = std::min(static_cast<int>(local.y), cells_y_ - 1);
+	const int cell_z = std::min(static_cast<int>(local.z), cells_z_ - 1);
+	const int cell = (cell_z * cells_y_ + cell_y) * cells_x_ + cell_x;
+	const int brick = cells_[cell];
+	if (brick < 0)
+	{
+		upper_bound = cell_distances_[cell] + half_diagonal_;
+		return cell_distances_[cell] - half_diagonal_;
+	}
+
+	// Position in voxels inside the brick
+	const float voxel_x = (local.x - cell_x) * brick_resolution_;
+	const float voxel_y = (local.y - cell_y) * brick_resolution_;
+	const float voxel_z = (local.z - cell_z) * brick_resolution_;
+	const int x = std::min(static_cast<int>(voxel_x), brick_resolution_ - 1);
+	const int y = std::min(static_cast<int>(voxel_y), brick_resolution_ - 1);
+	const int z = std::min(static_cast<int>(voxel_z), brick_resolution_ - 1);
+	const float tx = voxel_x - x;
+	const float ty = voxel_y - y;
+	const float tz = voxel_z - z;
+
+	const float* s = &samples_[SampleIndex(brick, x, y, z)];
+	const int side = brick_resolution_ + 1;
+	const int dy = side;
+	const int dz = side * side;
+	const float bottom = Lerp(Lerp(s[0], s[1], tx), Lerp(s[dy], s[dy + 1], tx), ty);
+	const float top = Lerp(Lerp(s[dz], s[dz + 1], tx), Lerp(s[dz + dy], s[dz + dy + 1], tx), ty);
+	const float distance = Lerp(bottom, top, tz);
+	upper_bound = distance + interpolation_error_;
+	return distance - interpolation_error_;
+}
@@ -0,0 +1,204 @@
+#include "sphere_bins.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "render_scheduler.h"
+#include "render_stats.h"
+
+namespace {
+
+// Spheres reaching closer than this depth to the camera plane cover the whole image
+constexpr float kMinProjectionDepth = 1e-4f;
+// Margin in pixels added around the projected bounds against the rounding of the projection
+constexpr float kProjectionMargin = 0.5f;
+
+// Tiles covered by a sphere, empty when x0 > x1
+struct BinRange
+{
+	int x0 = 1;
+	int y0 = 1;
+	int x1 = 0;
+	int y1 = 0;
+	float min_depth = 0.0f;
+
+	bool empty() const { return x0 > x1; }
+};
+
+} // namespace
+
+void SphereBins::Build(const raytracing::Camera& camera, const SphereTable& spheres, int bin_size, int thread_count)
+{
+	Clear();
+	bin_size_ = std::max(bin_size, 1);
+	const int width = camera.width();
+	const int height = camera.height();
+	bins_x_ = (width + bin_size_ - 1) / bin_size_;
+	bins_y_ = (height + bin_size_ - 1) / bin_size_;
+	bin_offsets_.assign(static_cast<size_t>(bins_x_) * bins_y_ + 1, 0);
+	const int count = spheres.size();
+	if (count == 0 || bins_x_ == 0 || bins_y_ == 0) return;
+
+	// A sphere is inside the box center +- radius, once in camera space the box is
+	// inside the box of half extents radius * |M| (1, 1, 1) even if the camera is scaled
+	const maths::Matrix4f world_to_camera = camera.transform().InverseAffine();
+	maths::Vector3f unit_extent;
+	for (int i = 0; i < 3; ++i)
+	{
+		unit_extent[i] = std::abs(world_to_camera[0][i]) + std::abs(world_to_camera[1][i])
+			+ std::abs(world_to_camera[2][i]);
+	}
+	const float focal_length = camera.focal_length();
+	const float half_width = width * 0.5f;
+	const float half_height = height * 0.5f;
+
+	std::vector<BinRange> ranges(count);
+	raytracing::ParallelFor(count, thread_count, [&](int begin, int end, int) {
+		for (int i = begin; i < end; ++i)
+		{
+			const PackedSphere& sphere = spheres.geometry(i);
+			const maths::Vector3f center = world_to_camera.TransformPoint(sphere.center);
+			const maths::Vector3f extent = unit_extent * sphere.radius;
+			// The camera looks down -z, the depths are positive in front of it
+			const float near_depth = -center.z - extent.z;
+			const float far_depth = -center.z + extent.z;
+			if (far_depth <= 0.0f) continue;
+
+			BinRange& range = ranges[i];
+			// The distance along any ray from the camera is at least the depth along the view direction
+			range.min_depth = maths::Vector3f::Dot(sphere.center - camera.position(), camera.forward()) - sphere.radius;
+			if (near_depth <= kMinProjectionDepth)
+			{
+				range.x0 = 0;
+				range.y0 = 0;
+				range.x1 = bins_x_ - 1;
+				range.y1 = bins_y_ - 1;
+				continue;
+			}
+
+			// The bounds of the projected box are reached at its corners
+			float min_x = std::numeric_limits<float>::max();
+			float max_x = -std::numeric_limits<float>::max();
+			float min_y = std::numeric_limits<float>::max();
+			float max_y = -std::numeric_limits<float>::max();
+			for (const float depth : { near_depth, far_depth })
+			{
+				const float scale = focal_length / depth;
+				for (const float sign : { -1.0f, 1.0f })
+				{
+					const float x = half_width + (center.x + sign * extent.x) * scale;
+					const float y = half_height - (center.y + sign * extent.y) * scale;
+					min_x = std::min(min_x, x);
+					max_x = std::max(max_x, x);
+					min_y = std::min(min_y, y);
+					max_y = std::max(max_y, y);
+				}
+			}
+			min_x -= kProjectionMargin;
+			min_y -= kProjectionMargin;
+			max_x += kProjectionMargin;
+			max_y += kProjectionMargin;
+			if (max_x < 0.0f || max_y < 0.0f || min_x >= width || min_y >= height) continue;
+
+			range.x0 = static_cast<int>(std::max(min_x, 0.0f)) / bin_size_;
+			range.y0 = static_cast<int>(std::max(min_y, 0.0f)) / bin_size_;
+			range.x1 = std::min(static_cast<int>(std::min(max_x, static_cast<float>(width))) / bin_size_, bins_x_ - 1);
+			range.y1 = std::min(static_cast<int>(std::min(max_y, static_cast<float>(height))) / bin_size_, bins_y_ - 1);
+		}
+	});
+
+	// Filling the tiles in depth order leaves every tile sorted without sorting them
+	std::vector<int> order;
+	order.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		if (!ranges[i].empty())
+		{
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [&ranges](int a, int b) {
+		return ranges[a].min_depth < ranges[b].min_depth;
+	});
+
+	for (const int sphere_index : order)
+	{
+		const BinRange& range = ranges[sphere_index];
+		for (int bin_y = range.y0; bin_y <= range.y1; ++bin_y)
+		{
+			for (int bin_x = range.x0; bin_x <= range.x1; ++bin_x)
+			{
+				++bin_offsets_[bin_x + bin_y * bins_x_ + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < bin_offsets_.size(); ++i)
+	{
+		bin_offsets_[i] += bin_offsets_[i - 1];
+	}
+
+	const int reference_count = bin_offsets_.back();
+	spheres_.resize(reference_count);
+	sphere_ids_.resize(reference_count);
+	min_depths_.resize(reference_count);
+	std::vector<int> cursors(bin_offsets_.begin(), bin_offsets_.end() - 1);
+	for (const int sphere_index : order)
+	{
+		const BinRange& range = ranges[sphere_index];
+		for (int bin_y = range.y0; bin_y <= range.y1; ++bin_y)
+		{
+			for (int bin_x = range.x0; bin_x <= range.x1; ++bin_x)
+			{
+				const int reference = cursors[bin_x + bin_y * bins_x_]++;
+				spheres_[reference] = spheres.geometry(sphere_index);
+				sphere_ids_[reference] = sphere_index;
+				min_depths_[reference] = range.min_depth;
+			}
+		}
+	}
+}
+
+void SphereBins::Clear()
+{
+	bins_x_ = 0;
+	bins_y_ = 0;
+	bin_offsets_.assign(1, 0);
+	spheres_.clear();
+	sphere_ids_.clear();
+	min_depths_.clear();
+}
+
+bool SphereBins::Intersect(
+	float x,
+	float y,
+	const maths::Ray3& ray,
+	int& sphere_index,
+	float& distance,
+	float max_distance) const
+{
+	if (bins_x_ == 0 || bins_y_ == 0) return false;
+	const int bin_x = std::min(std::max(static_cast<int>(x) / bin_size_, 0), bins_x_ - 1);
+	const int bin_y = std::min(std::max(static_cast<int>(y) / bin_size_, 0), bins_y_ - 1);
+	const int bin = bin_x + bin_y * bins_x_;
+
+	float best = max_distance;
+	int best_index = -1;
+	for (int i = bin_offsets_[bin]; i < bin_offsets_[bin + 1]; ++i)
+	{
+		// The next spheres all start further than the closest hit
+		if (min_depths_[i] >= best) break;
+		RAYTRACING_STAT_ADD(sphere_tests, 1);
+		float sphere_distance;
+		if (spheres_[i].Intersect(ray, sphere_distance) && sphere_distance < best)
+		{
+			best = sphere_distance;
+			best_index = sphere_ids_[i];
+		}
+	}
+
+	if (best_index < 0) return false;
+	sphere_index = best_index;
+	distance = best;
+	return true;
+}
@@ -0,0 +1,511 @@
+#include "sphere_store.h"
+
+#include <cmath>
+
+#include "render_stats.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPHERE_STORE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Same result as maths::Ray3::IntersectSphere(sphere, distance)
+inline bool IntersectOne(
+	float ox, float oy, float oz,
+	float dx, float dy, float dz,
+	float cx, float cy, float cz, float squared_radius,
+	float& distance)
+{
+	const float vx = cx - ox;
+	const float vy = cy - oy;
+	const float vz = cz - oz;
+	const float d = vx * dx + vy * dy + vz * dz;
+	if (d < 0.0f) {
+		return false;
+	}
+	const float h = squared_radius - (vx * vx + vy * vy + vz * vz - d * d);
+	if (h < 0.0f) {
+		return false;
+	}
+	const float q = std::sqrt(h);
+	distance = d - q >= 0.0f ? d - q : d + q;
+	return true;
+}
+
+} // namespace
+
+void SphereStore::Clear()
+{
+	size_ = 0;
+	center_x_.clear();
+	center_y_.clear();
+	center_z_.clear();
+	squared_radius_.clear();
+	ids_.clear();
+}
+
+void SphereStore::Reserve(int count)
+{
+	center_x_.reserve(count + kBatchSize);
+	center_y_.reserve(count + kBatchSize);
+	center_z_.reserve(count + kBatchSize);
+	squared_radius_.reserve(count + kBatchSize);
+	ids_.reserve(count + kBatchSize);
+}
+
+void SphereStore::Add(const maths::Sphere& sphere, int id)
+{
+	center_x_.resize(size_);
+	center_y_.resize(size_);
+	center_z_.resize(size_);
+	squared_radius_.resize(size_);
+	ids_.resize(size_);
+
+	center_x_.push_back(sphere.center().x);
+	center_y_.push_back(sphere.center().y);
+	center_z_.push_back(sphere.center().z);
+	squared_radius_.push_back(sphere.radius() * sphere.radius());
+	ids_.push_back(id);
+	++size_;
+	Pad();
+}
+
+void SphereStore::Resize(int count)
+{
+	size_ = count;
+	center_x_.assign(size_, 0.0f);
+	center_y_.assign(size_, 0.0f);
+	center_z_.assign(size_, 0.0f);
+	squared_radius_.assign(size_, -1.0f);
+	ids_.assign(size_, -1);
+	Pad();
+}
+
+void SphereStore::Set(int index, const maths::Sphere& sphere, int id)
+{
+	center_x_[index] = sphere.center().x;
+	center_y_[index] = sphere.center().y;
+	center_z_[index] = sphere.center().z;
+	squared_radius_[index] = sphere.radius() * sphere.radius();
+	ids_[index] = id;
+}
+
+void SphereStore::View(
+	const float* center_x,
+	const float* center_y,
+	const float* center_z,
+	const float* squared_radius,
+	const int* ids,
+	int count)
+{
+	size_ = count;
+	center_x_.View(center_x, padded_size(count));
+	center_y_.View(center_y, padded_size(count));
+	center_z_.View(center_z, padded_size(count));
+	squared_radius_.View(squared_radius, padded_size(count));
+	ids_.View(ids, padded_size(count));
+}
+
+void SphereStore::Pad()
+{
+	// A negative squared radius can never be reached by the ray
+	center_x_.resize(padded_size(size_), 0.0f);
+	center_y_.resize(padded_size(size_), 0.0f);
+	center_z_.resize(padded_size(size_), 0.0f);
+	squared_radius_.resize(padded_size(size_), -1.0f);
+	ids_.resize(padded_size(size_), -1);
+}
+
+bool SphereStore::IntersectClosest(
+	const maths::Vector3f& origin,
+	const maths::Vector3f& direction,
+	int begin,
+	int end,
+	float& distance,
+	int& index) const
+{
+	RAYTRACING_STAT_ADD(sphere_tests, end - begin);
+	bool has_hit = false;
+	int i = begin;
+
+#if defined(__AVX2__)
+	const __m256 ox = _mm256_set1_ps(origin.x);
+	const __m256 oy = _mm256_set1_ps(origin.y);
+	const __m256 oz = _mm256_set1_ps(origin.z);
+	const __m256 dx = _mm256_set1_ps(direction.x);
+	const __m256 dy = _mm256_set1_ps(direction.y);
+	const __m256 dz = _mm256_set1_ps(direction.z);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i last = _mm256_set1_epi32(end);
+	__m256 best = _mm256_set1_ps(distance);
+
+	for (; i < end; i += 8) {
+		const __m256 vx = _mm256_sub_ps(_mm256_loadu_ps(&center_x_[i]), ox);
+		const __m256 vy = _mm256_sub_ps(_mm256_loadu_ps(&center_y_[i]), oy);
+		const __m256 vz = _mm256_sub_ps(_mm256_loadu_ps(&center_z_[i]), oz);
+		const __m256 d = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)), _mm256_mul_ps(vz, dz));
+		const __m256 vv = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+		const __m256 h = _mm256_sub_ps(_mm256_loadu_ps(&squared_radius_[i]),
+			_mm256_sub_ps(vv, _mm256_mul_ps(d, d)));
+
+		__m256 mask = _mm256_and_ps(
+			_mm256_cmp_ps(d, zero, _CMP_GE_OQ), _mm256_cmp_ps(h, zero, _CMP_GE_OQ));
+		const __m256i in_range = _mm256_cmpgt_epi32(last,
+			_mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+		mask = _mm256_and_ps(mask, _mm256_castsi256_ps(in_range));
+		if (_mm256_movemask_ps(mask) == 0) continue;
+
+		const __m256 q = _mm256_sqrt_ps(_mm256_max_ps(h, zero));
+		const __m256 t_near = _mm256_sub_ps(d, q);
+		const __m256 t_far = _mm256_add_ps(d, q);
+		const __m256 t = _mm256_blendv_ps(t_far, t_near, _mm256_cmp_ps(t_near, zero, _CMP_GE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, best, _CMP_LT_OQ));
+
+		const int bits = _mm256_movemask_ps(mask);
+		if (bits == 0) continue;
+		alignas(32) float t_lanes[8];
+		_mm256_store_ps(t_lanes, t);
+		for (int lane = 0; lane < 8; ++lane) {
+			if ((bits & (1 << lane)) && t_lanes[lane] < distance) {
+				distance = t_lanes[lane];
+				index = i + lane;
+				has_hit = true;
+			}
+		}
+		best = _mm256_set1_ps(distance);
+	}
+#elif defined(SPHERE_STORE_SSE2)
+	const __m128 ox = _mm_set1_ps(origin.x);
+	const __m128 oy = _mm_set1_ps(origin.y);
+	const __m128 oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x);
+	const __m128 dy = _mm_set1_ps(direction.y);
+	const __m128 dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i last = _mm_set1_epi32(end);
+	__m128 best = _mm_set1_ps(distance);
+
+	for (; i < end; i += 4) {
+		const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&center_x_[i]), ox);
+		const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&center_y_[i]), oy);
+		const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&center_z_[i]), oz);
+		const __m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy)), _mm_mul_ps(vz, dz));
+		const __m128 vv = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		const __m128 h = _mm_sub_ps(_mm_loadu_ps(&squared_radius_[i]),
+			_mm_sub_ps(vv, _mm_mul_ps(d, d)));
+
+		__m128 mask = _mm_and_ps(_mm_cmpge_ps(d, zero), _mm_cmpge_ps(h, zero));
+		const __m128i in_range = _mm_cmplt_epi32(
+			_mm_add_epi32(_mm_set1_epi32(i), lanes), last);
+		mask = _mm_and_ps(mask, _mm_castsi128_ps(in_range));
+		if (_mm_movemask_ps(mask) == 0) continue;
+
+		const __m128 q = _mm_sqrt_ps(_mm_max_ps(h, zero));
+		const __m128 t_near = _mm_sub_ps(d, q);
+		const __m128 t_far = _mm_add_ps(d, q);
+		const __m128 near_valid = _mm_cmpge_ps(t_near, zero);
+		const __m128 t = _mm_or_ps(_mm_and_ps(near_valid, t_near), _mm_andnot_ps(near_valid, t_far));
+		mask = _mm_and_ps(mask, _mm_cmplt_ps(t, best));
+
+		const int bits = _mm_movemask_ps(mask);
+		if (bits == 0) continue;
+		alignas(16) float t_lanes[4];
+		_mm_store_ps(t_lanes, t);
+		for (int lane = 0; lane < 4; ++lane) {
+			if ((bits & (1 << lane)) && t_lanes[lane] < distance) {
+				distance = t_lanes[lane];
+				index = i + lane;
+				has_hit = true;
+			}
+		}
+		best = _mm_set1_ps(distance);
+	}
+#endif
+
+	for (; i < end; ++i) {
+		float t;
+		if (IntersectOne(origin.x, origin.y, origin.z, direction.x, direction.y, direction.z,
+			center_x_[i], center_y_[i], center_z_[i], squared_radius_[i], t) && t < distance) {
+			distance = t;
+			index = i;
+			has_hit = true;
+		}
+	}
+	return has_hit;
+}
+
+bool SphereStore::IntersectAny(
+	const maths::Vector3f& origin,
+	const maths::Vector3f& direction,
+	int begin,
+	int end,
+	float min_distance,
+	float max_distance) const
+{
+	RAYTRACING_STAT_ADD(sphere_tests, end - begin);
+	int i = begin;
+
+#if defined(__AVX2__)
+	const __m256 ox = _mm256_set1_ps(origin.x);
+	const __m256 oy = _mm256_set1_ps(origin.y);
+	const __m256 oz = _mm256_set1_ps(origin.z);
+	const __m256 dx = _mm256_set1_ps(direction.x);
+	const __m256 dy = _mm256_set1_ps(direction.y);
+	const __m256 dz = _mm256_set1_ps(direction.z);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 t_min = _mm256_set1_ps(min_distance);
+	const __m256 t_max = _mm256_set1_ps(max_distance);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i last = _mm256_set1_epi32(end);
+
+	for (; i < end; i += 8) {
+		const __m256 vx = _mm256_sub_ps(_mm256_loadu_ps(&center_x_[i]), ox);
+		const __m256 vy = _mm256_sub_ps(_mm256_loadu_ps(&center_y_[i]), oy);
+		const __m256 vz = _mm256_sub_ps(_mm256_loadu_ps(&center_z_[i]), oz);
+		const __m256 d = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)), _mm256_mul_ps(vz, dz));
+		const __m256 vv = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+		const __m256 h = _mm256_sub_ps(_mm256_loadu_ps(&squared_radius_[i]),
+			_mm256_sub_ps(vv, _mm256_mul_ps(d, d)));
+
+		__m256 mask = _mm256_and_ps(
+			_mm256_cmp_ps(d, zero, _CMP_GE_OQ), _mm256_cmp_ps(h, zero, _CMP_GE_OQ));
+		const __m256i in_range = _mm256_cmpgt_epi32(last,
+			_mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+		mask = _mm256_and_ps(mask, _mm256_castsi256_ps(in_range));
+		if (_mm256_movemask_ps(mask) == 0) continue;
+
+		const __m256 q = _mm256_sqrt_ps(_mm256_max_ps(h, zero));
+		const __m256 t_near = _mm256_sub_ps(d, q);
+		const __m256 t_far = _mm256_add_ps(d, q);
+		const __m256 t = _mm256_blendv_ps(t_far, t_near, _mm256_cmp_ps(t_near, zero, _CMP_GE_OQ));
+		mask = _mm256_and_ps(mask, _mm256_and_ps(
+			_mm256_cmp_ps(t, t_min, _CMP_GE_OQ), _mm256_cmp_ps(t, t_max, _CMP_LE_OQ)));
+		if (_mm256_movemask_ps(mask) != 0) {
+			return true;
+		}
+	}
+#elif defined(SPHERE_STORE_SSE2)
+	const __m128 ox = _mm_set1_ps(origin.x);
+	const __m128 oy = _mm_set1_ps(origin.y);
+	const __m128 oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x);
+	const __m128 dy = _mm_set1_ps(direction.y);
+	const __m128 dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 t_min = _mm_set1_ps(min_distance);
+	const __m128 t_max = _mm_set1_ps(max_distance);
+	const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i last = _mm_set1_epi32(end);
+
+	for (; i < end; i += 4) {
+		const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&center_x_[i]), ox);
+		const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&center_y_[i]), oy);
+		const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&center_z_[i]), oz);
+		const __m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy)), _mm_mul_ps(vz, dz));
+		const __m128 vv = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		const __m128 h = _mm_sub_ps(_mm_loadu_ps(&squared_radius_[i]),
+			_mm_sub_ps(vv, _mm_mul_ps(d, d)));
+
+		__m128 mask = _mm_and_ps(_mm_cmpge_ps(d, zero), _mm_cmpge_ps(h, zero));
+		const __m128i in_range = _mm_cmplt_epi32(
+			_mm_add_epi32(_mm_set1_epi32(i), lanes), last);
+		mask = _mm_and_ps(mask, _mm_castsi128_ps(in_range));
+		if (_mm_movemask_ps(mask) == 0) continue;
+
+		const __m128 q = _mm_sqrt_ps(_mm_max_ps(h, zero));
+		const __m128 t_near = _mm_sub_ps(d, q);
+		const __m128 t_far = _mm_add_ps(d, q);
+		const __m128 near_valid = _mm_cmpge_ps(t_near, zero);
+		const __m128 t = _mm_or_ps(_mm_and_ps(near_valid, t_near), _mm_andnot_ps(near_valid, t_far));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, t_min), _mm_cmple_ps(t, t_max)));
+		if (_mm_movemask_ps(mask) != 0) {
+			return true;
+		}
+	}
+#endif
+
+	for (; i < end; ++i) {
+		float t;
+		if (IntersectOne(origin.x, origin.y, origin.z, direction.x, direction.y, direction.z,
+			center_x_[i], center_y_[i], center_z_[i], squared_radius_[i], t)
+			&& t >= min_distance && t <= max_distance) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SphereStore::NearestDistance(
+	const maths::Vector3f& point,
+	int begin,
+	int end,
+	float& distance,
+	int& index) const
+{
+	RAYTRACING_STAT_ADD(sphere_tests, end - begin);
+	bool has_nearer = false;
+	int i = begin;
+
+	// Padding spheres have a negative squared radius, their sqrt is NaN
+	// and the ordered comparison below never selects them
+#if defined(__AVX2__)
+	const __m256 px = _mm256_set1_ps(point.x);
+	const __m256 py = _mm256_set1_ps(point.y);
+	const __m256 pz = _mm256_set1_ps(point.z);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i last = _mm256_set1_epi32(end);
+
+	for (; i < end; i += 8) {
+		const __m256 vx = _mm256_sub_ps(_mm256_loadu_ps(&center_x_[i]), px);
+		const __m256 vy = _mm256_sub_ps(_mm256_loadu_ps(&center_y_[i]), py);
+		const __m256 vz = _mm256_sub_ps(_mm256_loadu_ps(&center_z_[i]), pz);
+		const __m256 vv = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+		const __m256 d = _mm256_sub_ps(_mm256_sqrt_ps(vv),
+			_mm256_sqrt_ps(_mm256_loadu_ps(&squared_radius_[i])));
+
+		__m256 mask = _mm256_cmp_ps(d, _mm256_set1_ps(distance), _CMP_LT_OQ);
+		const __m256i in_range = _mm256_cmpgt_epi32(last,
+			_mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+		mask = _mm256_and_ps(mask, _mm256_castsi256_ps(in_range));
+		const int bits = _mm256_movemask_ps(mask);
+		if (bits == 0) continue;
+
+		alignas(32) float d_lanes[8];
+		_mm256_store_ps(d_lanes, d);
+		for (int lane = 0; lane < 8; ++lane) {
+			if ((bits & (1 << lane)) && d_lanes[lane] < distance) {
+				distance = d_lanes[lane];
+				index = i + lane;
+				has_nearer = true;
+			}
+		}
+	}
+#elif defined(SPHERE_STORE_SSE2)
+	const __m128 px = _mm_set1_ps(point.x);
+	const __m128 py = _mm_set1_ps(point.y);
+	const __m128 pz = _mm_set1_ps(point.z);
+	const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i last = _mm_set1_epi32(end);
+
+	for (; i < end; i += 4) {
+		const __m128 vx = _mm_sub_ps(_mm_loadu_ps(&center_x_[i]), px);
+		const __m128 vy = _mm_sub_ps(_mm_loadu_ps(&center_y_[i]), py);
+		const __m128 vz = _mm_sub_ps(_mm_loadu_ps(&center_z_[i]), pz);
+		const __m128 vv = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+		const __m128 d = _mm_sub_ps(_mm_sqrt_ps(vv), _mm_sqrt_ps(_mm_loadu_ps(&squared_radius_[i])));
+
+		__m128 mask = _mm_cmplt_ps(d, _mm_set1_ps(distance));
+		const __m128i in_range = _mm_cmplt_epi32(
+			_mm_add_epi32(_mm_set1_epi32(i), lanes), last);
+		mask = _mm_and_ps(mask, _mm_castsi128_ps(in_range));
+		const int bits = _mm_movemask_ps(mask);
+		if (bits == 0) continue;
+
+		alignas(16) float d_lanes[4];
+		_mm_store_ps(d_lanes, d);
+		for (int lane = 0; lane < 4; ++lane) {
+			if ((bits & (1 << lane)) && d_lanes[lane] < distance) {
+				distance = d_lanes[lane];
+				index = i + lane;
+				has_nearer = true;
+			}
+		}
+	}
+#endif
+
+	for (; i < end; ++i) {
+		const float vx = center_x_[i] - point.x;
+		const float vy = center_y_[i] - point.y;
+		const float vz = center_z_[i] - point.z;
+		const float d = std::sqrt(vx * vx + vy * vy + vz * vz) - std::sqrt(squared_radius_[i]);
+		if (d < distance) {
+			distance = d;
+			index = i;
+			has_nearer = true;
+		}
+	}
+	return has_nearer;
+}
+
+void SphereStore::IntersectPacket(
+	const maths::Vector3f& origin,
+	const float* direction_x,
+	const float* direction_y,
+	const float* direction_z,
+	int ray_count,
+	int begin,
+	int end,
+	float* distance,
+	int* index) const
+{
+	RAYTRACING_STAT_ADD(sphere_tests, (end - begin) * ray_count);
+	for (int s = begin; s < end; ++s) {
+		// The origin is shared so everything not involving the direction is per sphere
+		const float vx = center_x_[s] - origin.x;
+		const float vy = center_y_[s] - origin.y;
+		const float vz = center_z_[s] - origin.z;
+		const float vv = vx * vx + vy * vy + vz * vz;
+		const float squared_radius = squared_radius_[s];
+		int lane = 0;
+
+#if defined(__AVX2__)
+		const __m256 vx8 = _mm256_set1_ps(vx);
+		const __m256 vy8 = _mm256_set1_ps(vy);
+		const __m256 vz8 = _mm256_set1_ps(vz);
+		const __m256 vv8 = _mm256_set1_ps(vv);
+		const __m256 r8 = _mm256_set1_ps(squared_radius);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i sphere8 = _mm256_set1_epi32(s);
+		for (; lane + 8 <= ray_count; lane += 8) {
+			const __m256 d = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(vx8, _mm256_loadu_ps(direction_x + lane)),
+				_mm256_mul_ps(vy8, _mm256_loadu_ps(direction_y + lane))),
+				_mm256_mul_ps(vz8, _mm256_loadu_ps(direction_z + lane)));
+			const __m256 h = _mm256_sub_ps(r8, _mm256_sub_ps(vv8, _mm256_mul_ps(d, d)));
+			__m256 mask = _mm256_and_ps(
+				_mm256_cmp_ps(d, zero, _CMP_GE_OQ), _mm256_cmp_ps(h, zero, _CMP_GE_OQ));
+			if (_mm256_movemask_ps(mask) == 0) continue;
+
+			const __m256 q = _mm256_sqrt_ps(_mm256_max_ps(h, zero));
+			const __m256 t_near = _mm256_sub_ps(d, q);
+			const __m256 t = _mm256_blendv_ps(_mm256_add_ps(d, q), t_near,
+				_mm256_cmp_ps(t_near, zero, _CMP_GE_OQ));
+			const __m256 best = _mm256_loadu_ps(distance + lane);
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, best, _CMP_LT_OQ));
+
+			_mm256_storeu_ps(distance + lane, _mm256_blendv_ps(best, t, mask));
+			const __m256i best_index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + lane));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(index + lane), _mm256_castps_si256(
+				_mm256_blendv_ps(_mm256_castsi256_ps(best_index), _mm256_castsi256_ps(sphere8), mask)));
+		}
+#endif
+
+		for (; lane < ray_count; ++lane) {
+			const float d = vx * direction_x[lane] + vy * direction_y[lane] + vz * direction_z[lane];
+			const float h = squared_radius - (vv - d * d);
+			if (d < 0.0f || h < 0.0f) continue;
+			const float q = std::sqrt(h);
+			const float t = d - q >= 0.0f ? d - q : d + q;
+			if (t < distance[lane]) {
+				distance[lane] = t;
+				index[lane] = s;
+			}
+		}
+	}
+}
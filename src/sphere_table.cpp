@@ -0,0 +1,73 @@
+#include "sphere_table.h"
+
+#include <array>
+#include <map>
+#include <utility>
+
+void SphereTable::Assign(const std::vector<maths::Sphere>& spheres)
+{
+	Clear();
+	geometry_.resize(spheres.size());
+	material_ids_.resize(spheres.size());
+	std::map<std::array<float, 4>, std::int32_t> material_indices;
+	std::array<float, 4> previous_key{};
+	std::int32_t previous_id = -1;
+	for (size_t i = 0; i < spheres.size(); ++i)
+	{
+		const maths::Sphere& sphere = spheres[i];
+		geometry_[i].center = sphere.center();
+		geometry_[i].radius = sphere.radius();
+
+		const Material& material = sphere.material();
+		const maths::Vector3f color = material.color();
+		const std::array<float, 4> key = { color.x, color.y, color.z, material.reflexion_index() };
+		// Neighbouring spheres often share their material, skip the lookup for them
+		if (previous_id < 0 || key != previous_key)
+		{
+			const auto inserted = material_indices.emplace(key, static_cast<std::int32_t>(materials_.size()));
+			if (inserted.second)
+			{
+				materials_.push_back(material);
+			}
+			previous_key = key;
+			previous_id = inserted.first->second;
+		}
+		material_ids_[i] = previous_id;
+	}
+}
+
+void SphereTable::View(
+	const PackedSphere* geometry,
+	const std::int32_t* material_ids,
+	int count,
+	std::vector<Material> materials)
+{
+	geometry_.View(geometry, count);
+	material_ids_.View(material_ids, count);
+	materials_ = std::move(materials);
+}
+
+void SphereTable::Clear()
+{
+	geometry_.clear();
+	material_ids_.clear();
+	materials_.clear();
+}
+
+maths::Sphere SphereTable::sphere(int index) const
+{
+	maths::Sphere result(geometry_[index].radius, geometry_[index].center);
+	result.set_material(material(index));
+	return result;
+}
+
+std::vector<maths::Sphere> SphereTable::ToSpheres() const
+{
+	std::vector<maths::Sphere> spheres;
+	spheres.reserve(geometry_.size());
+	for (int i = 0; i < size(); ++i)
+	{
+		spheres.push_back(sphere(i));
+	}
+	return spheres;
+}
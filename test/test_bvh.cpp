@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include "bvh.h"
+#include "camera.h"
+
+namespace {
+
+// Check that the closest hit returned by the bvh is the same
+// as the one found by testing every sphere of the scene
+void ExpectClosestHitMatchesBruteForce(BvhBuildMethod method)
+{
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 2000; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator) - 100.0f));
+	}
+
+	Bvh bvh;
+	bvh.Build(spheres, method);
+
+	for (int i = 0; i < 500; ++i)
+	{
+		const maths::Vector3f direction = maths::Vector3f(
+			position(generator), position(generator), -100.0f).Normalized();
+		maths::Ray3 ray(maths::Vector3f(0.0f, 0.0f, 0.0f), direction);
+
+		int expected_index = -1;
+		float expected_distance = 1000000.0f;
+		for (int j = 0; j < static_cast<int>(spheres.size()); ++j)
+		{
+			maths::Vector3f hit_position;
+			float distance;
+			if (ray.IntersectSphere(spheres[j], hit_position, distance) && distance < expected_distance)
+			{
+				expected_distance = distance;
+				expected_index = j;
+			}
+		}
+
+		int sphere_index = -1;
+		float distance = 0.0f;
+		const bool hit = bvh.Intersect(ray, sphere_index, distance);
+		EXPECT_EQ(hit, expected_index >= 0);
+		if (hit)
+		{
+			EXPECT_EQ(sphere_index, expected_index);
+			EXPECT_NEAR(distance, expected_distance, 1e-2f);
+		}
+	}
+}
+
+} // namespace
+
+TEST(Bvh, Closest_Hit_Matches_Brute_Force)
+{
+	ExpectClosestHitMatchesBruteForce(BvhBuildMethod::kSah);
+}
+
+// Same test with the hierarchy built in parallel from morton codes
+TEST(Bvh, Lbvh_Closest_Hit_Matches_Brute_Force)
+{
+	ExpectClosestHitMatchesBruteForce(BvhBuildMethod::kLbvh);
+}
+
+// Check that the nearest distance returned by the bvh is the smallest
+// sphere distance, and that the bound is returned when every sphere is further
+TEST(Bvh, Nearest_Distance_Matches_Brute_Force)
+{
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 2000; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator)));
+	}
+
+	Bvh bvh;
+	bvh.Build(spheres);
+
+	for (int i = 0; i < 500; ++i)
+	{
+		// Every tenth point is inside a sphere to test negative distances
+		const maths::Vector3f point = i % 10 == 0 ? spheres[i].center()
+			: maths::Vector3f(position(generator), position(generator), position(generator));
+
+		int expected_index = -1;
+		float expected_distance = 1000000.0f;
+		for (int j = 0; j < static_cast<int>(spheres.size()); ++j)
+		{
+			const float distance = spheres[j].sdf(point);
+			if (distance < expected_distance)
+			{
+				expected_distance = distance;
+				expected_index = j;
+			}
+		}
+
+		int sphere_index = -1;
+		EXPECT_NEAR(bvh.NearestDistance(point, sphere_index), expected_distance, 1e-4f);
+		ASSERT_GE(sphere_index, 0);
+		// Equally near spheres may be returned in another order, only their distance has to match
+		EXPECT_NEAR(spheres[sphere_index].sdf(point), spheres[expected_index].sdf(point), 1e-4f);
+
+		const float bound = expected_distance - 0.5f;
+		if (bound > 0.0f)
+		{
+			EXPECT_EQ(bvh.NearestDistance(point, sphere_index, bound), bound);
+			EXPECT_EQ(sphere_index, -1);
+		}
+	}
+}
+
+// Check that culling the nodes outside the camera frustum drops most of a scene
+// around the camera without changing the closest hit of any ray through the image
+TEST(Bvh, Frustum_Culling_Keeps_Primary_Hits)
+{
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 4000; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator)));
+	}
+	Bvh bvh;
+	bvh.Build(spheres);
+
+	const int width = 64;
+	const int height = 48;
+	raytracing::Camera camera;
+	camera.SetImage(width, height, 0.8f);
+	camera.LookAt(maths::Vector3f(5.0f, 2.0f, 10.0f), maths::Vector3f(20.0f, -3.0f, -30.0f));
+	std::vector<std::uint8_t> visible_nodes;
+	const int visible_spheres = bvh.CullFrustum(camera.ViewFrustum(0.0f, 1000000.0f), visible_nodes);
+	EXPECT_GT(visible_spheres, 0);
+	EXPECT_LT(visible_spheres, static_cast<int>(spheres.size()) / 4);
+
+	std::uniform_real_distribution<float> image_x(0.0f, static_cast<float>(width));
+	std::uniform_real_distribution<float> image_y(0.0f, static_cast<float>(height));
+	for (int i = 0; i < 2000; ++i)
+	{
+		const maths::Ray3 ray(camera.position(), camera.Direction(image_x(generator), image_y(generator)));
+		int expected_index = -1;
+		float expected_distance = 0.0f;
+		const bool expected_hit = bvh.Intersect(ray, expected_index, expected_distance);
+		int sphere_index = -1;
+		float distance = 0.0f;
+		EXPECT_EQ(bvh.Intersect(ray, sphere_index, distance, 1000000.0f, visible_nodes.data()), expected_hit);
+		EXPECT_EQ(sphere_index, expected_index);
+	}
+}
+
+// Every sphere sets a single bit of its Morton code so the radix tree is a chain,
+// with the duplicated codes near the origin it is deeper than the inline traversal stack
+TEST(Bvh, Deep_Tree_Keeps_Every_Node)
+{
+	const float grid_max = static_cast<float>((1 << 21) - 1);
+	std::vector<maths::Sphere> spheres;
+	spheres.emplace_back(0.25f, maths::Vector3f(grid_max, grid_max, grid_max));
+	for (int bit = 1; bit < 21; ++bit)
+	{
+		const float coordinate = static_cast<float>(1 << bit);
+		spheres.emplace_back(0.25f, maths::Vector3f(coordinate, 0.0f, 0.0f));
+		spheres.emplace_back(0.25f, maths::Vector3f(0.0f, coordinate, 0.0f));
+		spheres.emplace_back(0.25f, maths::Vector3f(0.0f, 0.0f, coordinate));
+	}
+	for (int i = 0; i < 64; ++i)
+	{
+		spheres.emplace_back(0.001f, maths::Vector3f(0.01f * static_cast<float>(i), 0.0f, 0.0f));
+	}
+	Bvh bvh(1);
+	bvh.Build(spheres, BvhBuildMethod::kLbvh);
+
+	int max_depth = 0;
+	std::vector<std::pair<int, int>> stack = { { 0, 1 } };
+	while (!stack.empty())
+	{
+		const auto [node_index, depth] = stack.back();
+		stack.pop_back();
+		max_depth = std::max(max_depth, depth);
+		const BvhNode& node = bvh.nodes()[node_index];
+		if (!node.is_leaf())
+		{
+			stack.emplace_back(node.left_first, depth + 1);
+			stack.emplace_back(node.left_first + 1, depth + 1);
+		}
+	}
+	ASSERT_GT(max_depth, 64);
+
+	for (int i = 0; i < static_cast<int>(spheres.size()); ++i)
+	{
+		const maths::Vector3f center = spheres[i].center();
+		const float radius = spheres[i].radius();
+		const maths::Ray3 ray(center + maths::Vector3f(0.0f, 4.0f * radius, 0.0f), maths::Vector3f(0.0f, -1.0f, 0.0f));
+		int sphere_index = -1;
+		float distance = 0.0f;
+		EXPECT_TRUE(bvh.Intersect(ray, sphere_index, distance));
+		EXPECT_EQ(sphere_index, i);
+		EXPECT_TRUE(bvh.Occluded(ray, 0.0f, 8.0f * radius));
+		EXPECT_NEAR(bvh.NearestDistance(ray.origin(), sphere_index), 3.0f * radius, 1e-2f * radius);
+		EXPECT_EQ(sphere_index, i);
+	}
+}
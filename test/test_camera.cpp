@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "camera.h"
+#include "raymarching.h"
+#include "raytracing/ray_tracer.h"
+
+namespace raytracing {
+
+namespace {
+
+//Row of 10 spheres in front of the camera, staggered in height and depth and moved by the offset
+std::vector<maths::Sphere> RowSpheres(const maths::Vector3f& offset)
+{
+	const Material material(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 10; ++i) {
+		maths::Sphere sphere(0.8f, maths::Vector3f(-4.5f + i, 0.5f * (i % 3), -10.0f - (i % 4)) + offset);
+		sphere.set_material(material);
+		spheres.push_back(sphere);
+	}
+	return spheres;
+}
+
+}// namespace
+
+// Test that the directions of a block are the ones of its pixel centers
+// and that the default camera looks down -Z from the origin
+TEST(Camera, Block_Directions_Match_Single_Directions)
+{
+	Camera camera;
+	camera.SetImage(37, 21, 1.2f);
+	EXPECT_EQ(camera.position(), maths::Vector3f(0.0f, 0.0f, 0.0f));
+	EXPECT_LT((camera.Direction(18.5f, 10.5f) - maths::Vector3f(0.0f, 0.0f, -1.0f)).Magnitude(), 1e-6f);
+
+	camera.LookAt(maths::Vector3f(3.0f, 2.0f, 5.0f), maths::Vector3f(0.0f, 0.0f, -10.0f));
+	const maths::Vector3f forward = (maths::Vector3f(0.0f, 0.0f, -10.0f) - camera.position()).Normalized();
+	EXPECT_LT((camera.Direction(18.5f, 10.5f) - forward).Magnitude(), 1e-5f);
+
+	//A width that is not a multiple of the simd width goes through the scalar tail
+	const int width = 11;
+	const int height = 5;
+	std::vector<float> x(width * height);
+	std::vector<float> y(width * height);
+	std::vector<float> z(width * height);
+	camera.BlockDirections(20, 9, width, height, x.data(), y.data(), z.data());
+	for (int i = 0; i < height; ++i) {
+		for (int j = 0; j < width; ++j) {
+			const maths::Vector3f expected = camera.Direction(20 + j + 0.5f, 9 + i + 0.5f);
+			const int lane = j + i * width;
+			EXPECT_LT((maths::Vector3f(x[lane], y[lane], z[lane]) - expected).Magnitude(), 1e-5f);
+		}
+	}
+}
+
+// Test that moving the camera and the scene by the same offset gives the same image
+TEST(Camera, Moved_Camera_Renders_Moved_Scene)
+{
+	int width = 40;
+	int heigth = 30;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	const maths::Vector3f offset(3.0f, -2.0f, 7.0f);
+	std::vector<maths::Sphere> spheres = RowSpheres(maths::Vector3f(0.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> moved_spheres = RowSpheres(offset);
+	PointLight light;
+	PointLight moved_light;
+	moved_light.position = light.position + offset;
+	std::vector<maths::Plane> planes;
+
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> image = raytracer.frameBuffer();
+	raytracer.camera().SetTransform(maths::Matrix4f::translationMatrix(offset));
+	raytracer.SetScene(moved_spheres, moved_light, heigth, width, fov, bias);
+	raytracer.Render();
+
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.SetScene(spheres, planes, light, heigth, width, fov, bias);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> marched_image = raymarcher.frameBuffer();
+	raymarcher.camera().SetTransform(maths::Matrix4f::translationMatrix(offset));
+	raymarcher.SetScene(moved_spheres, planes, moved_light, heigth, width, fov, bias);
+	raymarcher.Render();
+
+	int different_pixels = 0;
+	int different_marched_pixels = 0;
+	for (int i = 0; i < width * heigth; ++i) {
+		if ((image[i] - raytracer.frameBuffer()[i]).Magnitude() > 1.0f) {
+			++different_pixels;
+		}
+		if ((marched_image[i] - raymarcher.frameBuffer()[i]).Magnitude() > 1.0f) {
+			++different_marched_pixels;
+		}
+	}
+	//Allow a few silhouette pixels to differ because of float rounding
+	EXPECT_LE(different_pixels, width * heigth / 100);
+	EXPECT_LE(different_marched_pixels, width * heigth / 100);
+}
+
+}// namespace raytracing
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "image_output.h"
+
+namespace raytracing {
+
+namespace {
+
+// Gradient with noise so every QOI operation and PNG filter is used
+ImageRgb8 TestImage(int width, int height)
+{
+	std::mt19937 generator(7);
+	std::uniform_int_distribution<int> noise(0, 255);
+	ImageRgb8 image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(width * height * 3);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			std::uint8_t* pixel = &image.pixels[(x + y * width) * 3];
+			if (y < height / 3) {
+				pixel[0] = static_cast<std::uint8_t>(x);
+				pixel[1] = static_cast<std::uint8_t>(y);
+				pixel[2] = 40;
+			}
+			else if (y < 2 * height / 3) {
+				pixel[0] = static_cast<std::uint8_t>(x < width / 2 ? 200 : 10);
+				pixel[1] = 90;
+				pixel[2] = 90;
+			}
+			else {
+				pixel[0] = static_cast<std::uint8_t>(noise(generator));
+				pixel[1] = static_cast<std::uint8_t>(noise(generator));
+				pixel[2] = static_cast<std::uint8_t>(noise(generator));
+			}
+		}
+	}
+	return image;
+}
+
+std::uint32_t ReadBigEndian32(const std::vector<std::uint8_t>& data, size_t offset)
+{
+	return (static_cast<std::uint32_t>(data[offset]) << 24) | (data[offset + 1] << 16)
+		| (data[offset + 2] << 8) | data[offset + 3];
+}
+
+// Reference QOI decoder for 3 channels images
+std::vector<std::uint8_t> DecodeQoi(const std::vector<std::uint8_t>& data, int pixel_count)
+{
+	std::vector<std::uint8_t> pixels;
+	std::uint8_t seen[64][3] = {};
+	std::uint8_t pixel[3] = { 0, 0, 0 };
+	size_t position = 14;
+	while (static_cast<int>(pixels.size()) < pixel_count * 3) {
+		const std::uint8_t op = data[position++];
+		int run = 1;
+		if (op == 0xFE) {
+			pixel[0] = data[position++];
+			pixel[1] = data[position++];
+			pixel[2] = data[position++];
+		}
+		else if ((op & 0xC0) == 0x00) {
+			pixel[0] = seen[op][0];
+			pixel[1] = seen[op][1];
+			pixel[2] = seen[op][2];
+		}
+		else if ((op & 0xC0) == 0x40) {
+			pixel[0] += ((op >> 4) & 3) - 2;
+			pixel[1] += ((op >> 2) & 3) - 2;
+			pixel[2] += (op & 3) - 2;
+		}
+		else if ((op & 0xC0) == 0x80) {
+			const int dg = (op & 0x3F) - 32;
+			const std::uint8_t next = data[position++];
+			pixel[0] += dg + ((next >> 4) & 0xF) - 8;
+			pixel[1] += dg;
+			pixel[2] += dg + (next & 0xF) - 8;
+		}
+		else {
+			run = (op & 0x3F) + 1;
+		}
+		const int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+		seen[hash][0] = pixel[0];
+		seen[hash][1] = pixel[1];
+		seen[hash][2] = pixel[2];
+		for (int i = 0; i < run; ++i) {
+			pixels.insert(pixels.end(), pixel, pixel + 3);
+		}
+	}
+	EXPECT_EQ(position + 8, data.size());
+	return pixels;
+}
+
+}// namespace
+
+// Test that the colors are clamped and truncated like the old per pixel output,
+// with enough pixels to use the vectorized path and its scalar tail
+TEST(ImageOutput, Convert_Clamps_And_Truncates)
+{
+	std::vector<maths::Vector3f> frame_buffer;
+	for (int i = 0; i < 7; ++i) {
+		frame_buffer.emplace_back(-10.0f, 300.0f, 127.9f);
+		frame_buffer.emplace_back(0.5f, 254.99f, std::numeric_limits<float>::quiet_NaN());
+	}
+	ImageRgb8 image;
+	ConvertToRgb8(RenderTarget{ frame_buffer.data(), 7, 2 }, image);
+
+	ASSERT_EQ(image.pixels.size(), 42);
+	for (int i = 0; i < 7; ++i) {
+		EXPECT_EQ(image.pixels[i * 6 + 0], 0);
+		EXPECT_EQ(image.pixels[i * 6 + 1], 255);
+		EXPECT_EQ(image.pixels[i * 6 + 2], 127);
+		EXPECT_EQ(image.pixels[i * 6 + 3], 0);
+		EXPECT_EQ(image.pixels[i * 6 + 4], 254);
+		EXPECT_EQ(image.pixels[i * 6 + 5], 0);
+	}
+}
+
+TEST(ImageOutput, Format_From_Extension)
+{
+	EXPECT_EQ(ImageFormatFromPath("./image.ppm"), ImageFormat::kPpm);
+	EXPECT_EQ(ImageFormatFromPath("image.QOI"), ImageFormat::kQoi);
+	EXPECT_EQ(ImageFormatFromPath("out.dir/image.png"), ImageFormat::kPng);
+	EXPECT_EQ(ImageFormatFromPath("image"), ImageFormat::kPpm);
+}
+
+TEST(ImageOutput, Ppm_Header_And_Pixels)
+{
+	ImageRgb8 image;
+	image.width = 2;
+	image.height = 1;
+	image.pixels = { 1, 2, 3, 250, 251, 252 };
+	std::vector<std::uint8_t> data;
+	EncodePpm(image, data);
+
+	const std::string header = "P6\n2 1\n255\n";
+	ASSERT_EQ(data.size(), header.size() + 6);
+	EXPECT_EQ(std::string(data.begin(), data.begin() + header.size()), header);
+	EXPECT_TRUE(std::equal(image.pixels.begin(), image.pixels.end(), data.begin() + header.size()));
+}
+
+TEST(ImageOutput, Qoi_Round_Trip)
+{
+	const ImageRgb8 image = TestImage(150, 90);
+	std::vector<std::uint8_t> data;
+	EncodeQoi(image, data);
+
+	ASSERT_GT(data.size(), 22);
+	EXPECT_EQ(std::string(data.begin(), data.begin() + 4), "qoif");
+	EXPECT_EQ(ReadBigEndian32(data, 4), 150);
+	EXPECT_EQ(ReadBigEndian32(data, 8), 90);
+	EXPECT_LT(data.size(), image.pixels.size());
+	EXPECT_EQ(DecodeQoi(data, 150 * 90), image.pixels);
+}
+
+// Test that the PNG chunks are well formed and the compressed rows are smaller than the image.
+// The same image is encoded on 1 and 4 threads as the chunks only depend on the row split.
+TEST(ImageOutput, Png_Chunks)
+{
+	const ImageRgb8 image = TestImage(150, 90);
+	for (int thread_count : { 1, 4 }) {
+		std::vector<std::uint8_t> data;
+		EncodePng(image, data, thread_count);
+
+		const std::uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		ASSERT_GT(data.size(), 8);
+		EXPECT_TRUE(std::equal(signature, signature + 8, data.begin()));
+
+		std::vector<std::string> types;
+		size_t position = 8;
+		while (position + 12 <= data.size()) {
+			const std::uint32_t length = ReadBigEndian32(data, position);
+			ASSERT_LE(position + 12 + length, data.size());
+			types.emplace_back(data.begin() + position + 4, data.begin() + position + 8);
+
+			std::uint32_t crc = 0xFFFFFFFFu;
+			for (size_t i = position + 4; i < position + 8 + length; ++i) {
+				crc ^= data[i];
+				for (int k = 0; k < 8; ++k) {
+					crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+				}
+			}
+			EXPECT_EQ(~crc, ReadBigEndian32(data, position + 8 + length));
+			if (types.back() == "IHDR") {
+				EXPECT_EQ(ReadBigEndian32(data, position + 8), 150);
+				EXPECT_EQ(ReadBigEndian32(data, position + 12), 90);
+			}
+			if (types.back() == "IDAT") {
+				EXPECT_EQ(data[position + 8], 0x78);
+				EXPECT_LT(length, image.pixels.size());
+			}
+			position += 12 + length;
+		}
+		EXPECT_EQ(position, data.size());
+		EXPECT_EQ(types, std::vector<std::string>({ "IHDR", "IDAT", "IEND" }));
+	}
+}
+
+}// namespace raytracing
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "maths/matrix4.h"
+
+namespace {
+
+float MaxDifference(const maths::Matrix4f& a, const maths::Matrix4f& b)
+{
+	float difference = 0.0f;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			difference = std::max(difference, std::abs(a[i][j] - b[i][j]));
+		}
+	}
+	return difference;
+}
+
+maths::Matrix4f RandomMatrix(std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+	maths::Matrix4f matrix;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			matrix[i][j] = value(generator) + (i == j ? 4.0f : 0.0f);
+		}
+	}
+	return matrix;
+}
+
+maths::Matrix4f RandomAffine(std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> value(-3.0f, 3.0f);
+	std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+	return maths::Matrix4f::translationMatrix(maths::Vector3f(value(generator), value(generator), value(generator)))
+		* maths::Matrix4f::rotationMatrix(maths::radian_t(value(generator)), 'y')
+		* maths::Matrix4f::rotationMatrix(maths::radian_t(value(generator)), 'x')
+		* maths::Matrix4f::scalingMatrix(maths::Vector3f(scale(generator), scale(generator), scale(generator)));
+}
+
+}// namespace
+
+// Test that the products, the transpose and the inverses match the scalar definitions
+TEST(Matrix4, Simd_Matches_Scalar)
+{
+	std::mt19937 generator(3);
+	for (int n = 0; n < 100; ++n)
+	{
+		const maths::Matrix4f a = RandomMatrix(generator);
+		const maths::Matrix4f b = RandomMatrix(generator);
+
+		maths::Matrix4f product;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				product[j][i] = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					product[j][i] += a[k][i] * b[j][k];
+				}
+			}
+		}
+		EXPECT_LT(MaxDifference(a * b, product), 1e-4f);
+
+		const maths::Vector4f vector = b[2];
+		const maths::Vector4f transformed = a * vector;
+		for (int i = 0; i < 4; ++i)
+		{
+			EXPECT_NEAR(transformed[i], product[2][i], 1e-4f);
+			EXPECT_EQ(a.Transpose()[i][1], a[1][i]);
+		}
+
+		maths::Matrix4f adjoint = a.adjoint();
+		adjoint *= 1.0f / a.determinant();
+		EXPECT_NEAR(a.determinant(), a[0][0] * a.cofactor(0, 0) + a[0][1] * a.cofactor(1, 0)
+			+ a[0][2] * a.cofactor(2, 0) + a[0][3] * a.cofactor(3, 0), 1e-2f);
+		EXPECT_LT(MaxDifference(a.Inverse(), adjoint), 1e-4f);
+		EXPECT_LT(MaxDifference(a * a.Inverse(), maths::Matrix4f::identity()), 1e-4f);
+	}
+
+	maths::Matrix4f singular = maths::Matrix4f::identity();
+	singular[3] = singular[2];
+	EXPECT_LT(MaxDifference(singular.Inverse(), singular), 1e-6f);
+}
+
+// Test that the rotation around each axis keeps the axis, turns the next axis into the one after it,
+// and has its inverse as its transpose
+TEST(Matrix4, Rotation_Per_Axis)
+{
+	const maths::Vector3f axes[3] = {
+		maths::Vector3f(1.0f, 0.0f, 0.0f), maths::Vector3f(0.0f, 1.0f, 0.0f), maths::Vector3f(0.0f, 0.0f, 1.0f) };
+	const char names[3] = { 'x', 'y', 'z' };
+	for (int i = 0; i < 3; ++i)
+	{
+		const maths::Matrix4f quarter = maths::Matrix4f::rotationMatrix(maths::radian_t(1.5707964f), names[i]);
+		EXPECT_LT((quarter.TransformDirection(axes[i]) - axes[i]).Magnitude(), 1e-6f);
+		EXPECT_LT((quarter.TransformDirection(axes[(i + 1) % 3]) - axes[(i + 2) % 3]).Magnitude(), 1e-6f);
+
+		const maths::Matrix4f rotation = maths::Matrix4f::rotationMatrix(maths::radian_t(0.7f), names[i]);
+		EXPECT_NEAR(rotation.determinant(), 1.0f, 1e-5f);
+		EXPECT_LT(MaxDifference(rotation * rotation.Transpose(), maths::Matrix4f::identity()), 1e-6f);
+		EXPECT_LT(MaxDifference(rotation.Inverse(), rotation.Transpose()), 1e-5f);
+	}
+
+	const maths::Matrix4f translation = maths::Matrix4f::translationMatrix(maths::Vector3f(1.0f, 2.0f, 3.0f));
+	EXPECT_EQ(translation[3], maths::Vector4f(1.0f, 2.0f, 3.0f, 1.0f));
+	EXPECT_EQ(translation[0][3], 0.0f);
+}
+
+// Test the affine inverse and the point and direction transforms
+TEST(Matrix4, Affine_Transforms)
+{
+	const maths::Matrix4f rotation = maths::Matrix4f::rotationMatrix(maths::radian_t(1.5707964f), 'z');
+	EXPECT_LT((rotation.TransformDirection(maths::Vector3f(1.0f, 0.0f, 0.0f)) - maths::Vector3f(0.0f, 1.0f, 0.0f)).Magnitude(), 1e-6f);
+	const maths::Matrix4f translation = maths::Matrix4f::translationMatrix(maths::Vector3f(1.0f, 2.0f, 3.0f));
+	EXPECT_EQ(translation.TransformPoint(maths::Vector3f(1.0f, 1.0f, 1.0f)), maths::Vector3f(2.0f, 3.0f, 4.0f));
+	EXPECT_EQ(translation.TransformDirection(maths::Vector3f(1.0f, 1.0f, 1.0f)), maths::Vector3f(1.0f, 1.0f, 1.0f));
+
+	std::mt19937 generator(8);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	for (int n = 0; n < 20; ++n)
+	{
+		const maths::Matrix4f transform = RandomAffine(generator);
+		EXPECT_LT(MaxDifference(transform.InverseAffine(), transform.Inverse()), 1e-4f);
+		EXPECT_LT(MaxDifference(transform * transform.InverseAffine(), maths::Matrix4f::identity()), 1e-4f);
+
+		//Counts that are not a multiple of the simd width go through the scalar tail
+		const std::size_t count = 37;
+		std::vector<maths::Vector3f> points(count);
+		std::vector<float> x(count);
+		std::vector<float> y(count);
+		std::vector<float> z(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			points[i] = maths::Vector3f(position(generator), position(generator), position(generator));
+			x[i] = points[i].x;
+			y[i] = points[i].y;
+			z[i] = points[i].z;
+		}
+
+		std::vector<maths::Vector3f> transformed(count);
+		transform.TransformPoints(points.data(), transformed.data(), count);
+		std::vector<maths::Vector3f> directions(count);
+		transform.TransformDirections(points.data(), directions.data(), count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const maths::Vector4f expected = transform * maths::Vector4f(points[i].x, points[i].y, points[i].z, 1.0f);
+			EXPECT_NEAR((transformed[i] - maths::Vector3f(expected.x, expected.y, expected.z)).Magnitude(), 0.0f, 1e-4f);
+			const maths::Vector4f direction = transform * maths::Vector4f(points[i].x, points[i].y, points[i].z, 0.0f);
+			EXPECT_NEAR((directions[i] - maths::Vector3f(direction.x, direction.y, direction.z)).Magnitude(), 0.0f, 1e-4f);
+		}
+
+		//In place, for both layouts
+		transform.TransformPoints(x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), count);
+		transform.TransformPoints(points.data(), points.data(), count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			EXPECT_EQ(points[i], transformed[i]);
+			EXPECT_NEAR(x[i], transformed[i].x, 1e-4f);
+			EXPECT_NEAR(y[i], transformed[i].y, 1e-4f);
+			EXPECT_NEAR(z[i], transformed[i].z, 1e-4f);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "octree.h"
+
+// Test that the front to back traversal returns the same closest sphere
+// as testing every sphere of the scene
+TEST(Octree, Closest_Hit_Matches_Brute_Force)
+{
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> position(-9.0f, 9.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 0.5f);
+
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 64; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator) - 10.0f));
+	}
+
+	maths::AABB3 octree_aabb(maths::Vector3f(-10.0f, -10.0f, -20.0f), maths::Vector3f(10.0f, 10.0f, 0.0f));
+	Octree octree(4, 4, octree_aabb, 0);
+	for (int i = 0; i < static_cast<int>(spheres.size()); ++i)
+	{
+		octree.Insert(spheres, i);
+	}
+	SphereTable table;
+	table.Assign(spheres);
+
+	for (int i = 0; i < 300; ++i)
+	{
+		const maths::Vector3f direction = maths::Vector3f(
+			position(generator), position(generator), -10.0f).Normalized();
+		maths::Ray3 ray(maths::Vector3f(0.0f, 0.0f, 0.0f), direction);
+
+		// Compare with the spheres the previous traversal would have tested
+		std::vector<int> candidates;
+		candidates.reserve(1);
+		octree.Retrieve_2(ray, candidates);
+
+		float expected_distance = 1000000.0f;
+		int expected_index = -1;
+		for (int index : candidates)
+		{
+			maths::Vector3f hit_position;
+			float distance;
+			if (ray.IntersectSphere(spheres[index], hit_position, distance) && distance < expected_distance)
+			{
+				expected_distance = distance;
+				expected_index = index;
+			}
+		}
+
+		int hit_index = -1;
+		float distance = 0.0f;
+		const bool hit = octree.ClosestHit(ray, table.geometry(), hit_index, distance);
+		EXPECT_EQ(hit, expected_distance < 1000000.0f);
+		if (hit)
+		{
+			EXPECT_NEAR(distance, expected_distance, 1e-4f);
+			EXPECT_EQ(hit_index, expected_index);
+		}
+	}
+}
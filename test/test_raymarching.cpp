@@ -1,11 +1,45 @@
 #include "gtest/gtest.h"
 
+#include <random>
+#include <vector>
 
 #include "raymarching.h"
 
 
 namespace raytracing
 {
+
+namespace {
+
+//50 unit spheres scattered in front of the camera, the seed gives each test its own scene
+std::vector<maths::Sphere> RandomSpheres(unsigned int seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+	std::uniform_real_distribution<float> depth(-30.0f, -10.0f);
+	const Material material(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 50; ++i) {
+		maths::Sphere sphere(1.0f, maths::Vector3f(position(generator), position(generator), depth(generator)));
+		sphere.set_material(material);
+		spheres.push_back(sphere);
+	}
+	return spheres;
+}
+
+//Number of pixels whose colors differ by more than one unit between the two images
+int CountDifferentPixels(const std::vector<maths::Vector3f>& a, const std::vector<maths::Vector3f>& b)
+{
+	int different_pixels = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if ((a[i] - b[i]).Magnitude() > 1.0f) {
+			++different_pixels;
+		}
+	}
+	return different_pixels;
+}
+
+}// namespace
 	
 //TEST(Raymarching, Image_output)
 //{
@@ -59,4 +93,136 @@ namespace raytracing
 //}
 
 	
+// Test that marching with the baked distance cache gives the same image
+// as marching with the exact scene distance
+TEST(Raymarching, Distance_Cache_Matches_Exact_Distance)
+{
+	int width = 64;
+	int heigth = 48;
+	float fov = 1.2f;
+	double bias = 1e-2;
+
+	std::vector<maths::Sphere> spheres = RandomSpheres(3);
+	std::vector<maths::Plane> planes;
+
+	PointLight light;
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.SetScene(spheres, planes, light, heigth, width, fov, bias);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> exact = raymarcher.frameBuffer();
+
+	raymarcher.BakeDistanceCache(1.0f);
+	ASSERT_FALSE(raymarcher.distance_cache().empty());
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> cached = raymarcher.frameBuffer();
+
+	//The march stops at slightly different points, allow a few silhouette pixels to differ
+	EXPECT_LE(CountDifferentPixels(exact, cached), width * heigth / 100);
+}
+
+// Test that over-relaxed marching takes fewer steps
+// and gives the same image as plain sphere tracing
+TEST(Raymarching, Relaxed_March_Takes_Fewer_Steps)
+{
+	int width = 64;
+	int heigth = 48;
+	float fov = 1.2f;
+	double bias = 1e-2;
+
+	std::vector<maths::Sphere> spheres = RandomSpheres(5);
+	std::vector<maths::Plane> planes;
+
+	PointLight light;
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.SetScene(spheres, planes, light, heigth, width, fov, bias);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> plain = raymarcher.frameBuffer();
+	const double plain_steps = raymarcher.stats().AverageMarchSteps();
+
+	raymarcher.set_march_method(MarchMethod::kRelaxed);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> relaxed = raymarcher.frameBuffer();
+	const double relaxed_steps = raymarcher.stats().AverageMarchSteps();
+
+	EXPECT_LE(CountDifferentPixels(plain, relaxed), width * heigth / 100);
+#if RAYTRACING_ENABLE_STATS
+	EXPECT_LT(relaxed_steps, plain_steps);
+#endif
+}
+
+// Test that starting the primary rays from the cone prepass depth takes fewer steps
+// and gives the same image as marching them from the camera
+TEST(Raymarching, Cone_Prepass_Takes_Fewer_Steps)
+{
+	int width = 64;
+	int heigth = 48;
+	float fov = 1.2f;
+	double bias = 1e-2;
+
+	std::vector<maths::Sphere> spheres = RandomSpheres(7);
+	std::vector<maths::Plane> planes;
+
+	PointLight light;
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.set_max_depth(0);
+	raymarcher.SetScene(spheres, planes, light, heigth, width, fov, bias);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> plain = raymarcher.frameBuffer();
+	const double plain_steps = raymarcher.stats().AverageMarchSteps();
+
+	raymarcher.set_cone_prepass(true);
+	raymarcher.Render();
+	const std::vector<maths::Vector3f> prepass = raymarcher.frameBuffer();
+	const double prepass_steps = raymarcher.stats().AverageMarchSteps();
+
+	EXPECT_LE(CountDifferentPixels(plain, prepass), width * heigth / 100);
+#if RAYTRACING_ENABLE_STATS
+	EXPECT_LT(prepass_steps, plain_steps);
+#endif
+}
+
+// Test that a progressive render stops at the target samples,
+// or after the first pass once the time budget is spent
+TEST(Raymarching, Progressive_Stops_At_Limits)
+{
+	int width = 32;
+	int heigth = 24;
+	float fov = 1.2f;
+	double bias = 1e-2;
+
+	Material material_test(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 5; ++i) {
+		maths::Sphere sphere(1.0f, maths::Vector3f(-4.0f + 2.0f * i, 0.0f, -12.0f));
+		sphere.set_material(material_test);
+		spheres.push_back(sphere);
+	}
+	std::vector<maths::Plane> planes;
+
+	PointLight light;
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.SetScene(spheres, planes, light, heigth, width, fov, bias);
+
+	ProgressiveSettings settings;
+	settings.target_samples = 3;
+	settings.preview_passes = false;
+	int passes = 0;
+	EXPECT_EQ(raymarcher.RenderProgressive(settings,
+		[&](const ProgressivePass& pass, const RenderTarget&) {
+			EXPECT_EQ(pass.samples, ++passes);
+		}), 3);
+	EXPECT_EQ(passes, 3);
+
+	settings.time_budget_seconds = 1e-9;
+	settings.preview_passes = true;
+	passes = 0;
+	EXPECT_EQ(raymarcher.RenderProgressive(settings,
+		[&](const ProgressivePass&, const RenderTarget&) { ++passes; }), 0);
+	EXPECT_EQ(passes, 1);
+}
+
 }
@@ -1,10 +1,29 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "raytracing/ray_tracer.h"
 
 namespace raytracing {
 
+namespace {
+
+//Row of 10 overlapping spheres in front of the camera, used by the tests rendering a small image
+std::vector<maths::Sphere> RowSpheres()
+{
+	const Material material(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 10; ++i) {
+		maths::Sphere sphere(0.8f, maths::Vector3f(-4.5f + i, 0.0f, -10.0f));
+		sphere.set_material(material);
+		spheres.push_back(sphere);
+	}
+	return spheres;
+}
+
+}// namespace
+
 //Test to check if the pixel color is either the background or the sphere color
 //TEST(Raytracing, Color_Output)
 //{
@@ -136,6 +155,248 @@ namespace raytracing {
 //	EXPECT_FALSE(is_not_in_shadow);
 //}
 
+// Test that the occlusion query only reports objects
+// placed between the origin and the maximum distance
+TEST(Raytracing, Occluded_Bounded_By_Light_Distance)
+{
+	int width = 50;
+	int heigth = 50;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	//Sphere is placed 20 units on the right of the origin
+	maths::Sphere sphere(5.0f, maths::Vector3f(20.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	spheres.push_back(sphere);
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+
+	const maths::Vector3f origin(0.0f, 0.0f, 0.0f);
+	const maths::Vector3f right(1.0f, 0.0f, 0.0f);
+	//A light behind the sphere is occluded, a light in front of it is not
+	EXPECT_TRUE(raytracer.Occluded(origin, right, 30.0f));
+	EXPECT_FALSE(raytracer.Occluded(origin, right, 10.0f));
+	EXPECT_FALSE(raytracer.Occluded(origin, maths::Vector3f(-1.0f, 0.0f, 0.0f), 30.0f));
+}
+
+// Test that tracing the primary rays by packets gives
+// the same image as tracing every ray on its own
+TEST(Raytracing, Packets_Match_Single_Rays)
+{
+	int width = 67;
+	int heigth = 45;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	Material material_test(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 100; ++i) {
+		maths::Sphere sphere(0.4f, maths::Vector3f(-5.0f + (i % 10), -5.0f + (i / 10), -12.0f - (i % 3)));
+		sphere.set_material(material_test);
+		spheres.push_back(sphere);
+	}
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.set_packet_size(1);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> single_rays = raytracer.frameBuffer();
+
+	raytracer.set_packet_size(8);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> packets = raytracer.frameBuffer();
+
+	int different_pixels = 0;
+	for (int i = 0; i < width * heigth; ++i) {
+		if ((single_rays[i] - packets[i]).Magnitude() > 1.0f) {
+			++different_pixels;
+		}
+	}
+	//Allow a few silhouette pixels to differ because of float rounding
+	EXPECT_LE(different_pixels, width * heigth / 200);
+}
+
+// Test that the statistics of a frame count every primary ray
+// and the time spent by the threads
+TEST(Raytracing, Stats_Count_Rays)
+{
+	int width = 40;
+	int heigth = 30;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	std::vector<maths::Sphere> spheres = RowSpheres();
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.scheduler().set_thread_count(2);
+	raytracer.scheduler().set_tile_size(8);
+	raytracer.Render();
+
+	const RenderStats& stats = raytracer.stats();
+	EXPECT_GT(stats.wall_seconds, 0.0);
+	EXPECT_EQ(stats.thread_busy_seconds.size(), 2u);
+#if RAYTRACING_ENABLE_STATS
+	EXPECT_EQ(stats.counters.rays[static_cast<int>(RayType::kPrimary)], static_cast<std::uint64_t>(width * heigth));
+	EXPECT_GT(stats.counters.rays[static_cast<int>(RayType::kShadow)], 0u);
+	EXPECT_GT(stats.counters.nodes_visited, 0u);
+	EXPECT_GT(stats.counters.sphere_tests, 0u);
+	EXPECT_GT(stats.MraysPerSecond(), 0.0);
+#endif
+}
+
+// Test that the intersection returns the id of the closest sphere
+// and not the first one in the list
+TEST(Raytracing, Object_Intersect_Returns_Closest_Primitive)
+{
+	std::vector<maths::Sphere> spheres;
+	spheres.emplace_back(1.0f, maths::Vector3f(0.0f, 0.0f, -15.0f));
+	spheres.emplace_back(1.0f, maths::Vector3f(0.0f, 0.0f, -10.0f));
+	spheres.emplace_back(1.0f, maths::Vector3f(5.0f, 0.0f, -10.0f));
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, 10, 10, 51.52f, 1e-4);
+
+	const maths::Ray3 ray(maths::Vector3f(0.0f, 0.0f, 0.0f), maths::Vector3f(0.0f, 0.0f, -1.0f));
+	HitInfos hit_infos;
+	ASSERT_TRUE(raytracer.ObjectIntersect(ray, hit_infos));
+	EXPECT_EQ(hit_infos.primitive_id, 1);
+	EXPECT_NEAR(hit_infos.distance, 9.0f, 1e-4f);
+
+	raytracer.ResolveHit(ray, hit_infos);
+	EXPECT_NEAR(hit_infos.normal.z, 1.0f, 1e-4f);
+
+	const maths::Ray3 miss(maths::Vector3f(0.0f, 0.0f, 0.0f), maths::Vector3f(0.0f, 1.0f, 0.0f));
+	EXPECT_FALSE(raytracer.ObjectIntersect(miss, hit_infos));
+	EXPECT_EQ(hit_infos.primitive_id, -1);
+}
+
+// Test that a progressive render reports the preview passes and that
+// its first full pass gives the same image as Render
+TEST(Raytracing, Progressive_First_Pass_Matches_Render)
+{
+	int width = 40;
+	int heigth = 30;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	std::vector<maths::Sphere> spheres = RowSpheres();
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.set_packet_size(1);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> expected = raytracer.frameBuffer();
+
+	ProgressiveSettings settings;
+	settings.target_samples = 1;
+	std::vector<int> block_sizes;
+	const int samples = raytracer.RenderProgressive(settings,
+		[&](const ProgressivePass& pass, const RenderTarget& target) {
+			block_sizes.push_back(pass.block_size);
+			EXPECT_EQ(target.width, width);
+			EXPECT_EQ(target.height, heigth);
+		});
+	EXPECT_EQ(samples, 1);
+	EXPECT_EQ(block_sizes, std::vector<int>({ 8, 4, 2, 1 }));
+#if RAYTRACING_ENABLE_STATS
+	EXPECT_GT(raytracer.stats().counters.rays[static_cast<int>(RayType::kPrimary)],
+		static_cast<std::uint64_t>(width * heigth));
+#endif
+
+	const std::vector<maths::Vector3f> progressive = raytracer.frameBuffer();
+	for (int i = 0; i < width * heigth; ++i) {
+		EXPECT_LE((expected[i] - progressive[i]).Magnitude(), 1e-3f);
+	}
+}
+
+// Test that rendering into a window of a caller owned image gives the frame buffer
+// image and leaves the pixels outside the window untouched
+TEST(Raytracing, Render_Into_Caller_Target)
+{
+	int width = 40;
+	int heigth = 30;
+	std::vector<maths::Sphere> spheres = RowSpheres();
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, 51.52f, 1e-4);
+	raytracer.Render();
+	const std::vector<maths::Vector3f>& expected = raytracer.frameBuffer();
+
+	const int stride = width + 7;
+	const maths::Vector3f untouched(-1.0f, -1.0f, -1.0f);
+	std::vector<maths::Vector3f> pixels(stride * (heigth + 2), untouched);
+	RenderTarget target{ &pixels[stride + 3], width, heigth, stride };
+	ASSERT_TRUE(raytracer.Render(target));
+
+	for (int i = 0; i < heigth + 2; ++i) {
+		for (int j = 0; j < stride; ++j) {
+			const bool inside = i >= 1 && i <= heigth && j >= 3 && j < width + 3;
+			const maths::Vector3f& pixel = pixels[j + i * stride];
+			const maths::Vector3f& reference = inside ? expected[j - 3 + (i - 1) * width] : untouched;
+			EXPECT_EQ(pixel, reference);
+		}
+	}
+
+	RenderTarget too_small{ pixels.data(), width - 1, heigth, stride };
+	EXPECT_FALSE(raytracer.Render(too_small));
+}
+
+// Test that the adaptive anti-aliasing only refines the edge pixels
+// and keeps the other pixels of the aliased image
+TEST(Raytracing, Adaptive_Sampling_Refines_Edges)
+{
+	int width = 64;
+	int heigth = 48;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	std::vector<maths::Sphere> spheres = RowSpheres();
+
+	PointLight light;
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> aliased = raytracer.frameBuffer();
+
+	AdaptiveSamplingSettings settings;
+	settings.max_samples = 8;
+	raytracer.set_adaptive_sampling(settings);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> anti_aliased = raytracer.frameBuffer();
+	const RenderStats& stats = raytracer.stats();
+
+	EXPECT_EQ(stats.sampled_pixels, static_cast<std::uint64_t>(width * heigth));
+	EXPECT_GT(stats.refined_pixels, 0u);
+	EXPECT_LE(stats.max_pixel_samples, 8);
+	EXPECT_LT(stats.AverageSamplesPerPixel(), 2.0);
+#if RAYTRACING_ENABLE_STATS
+	EXPECT_EQ(stats.counters.rays[static_cast<int>(RayType::kPrimary)], stats.pixel_samples);
+#endif
+
+	int changed_pixels = 0;
+	for (int i = 0; i < width * heigth; ++i) {
+		if ((aliased[i] - anti_aliased[i]).Magnitude() > 1e-3f) {
+			++changed_pixels;
+		}
+	}
+	EXPECT_GT(changed_pixels, 0);
+	EXPECT_LE(changed_pixels, static_cast<int>(stats.refined_pixels));
+}
+
 // Test that will make the rendering and create a .ppn image
 // of a 4 sphere scene
 TEST(Raytracing, Raytracing_ImageOutput)
@@ -206,9 +467,9 @@ TEST(Raytracing, Raytracing_ImageOutput)
 	Octree scene_octree(1, 2, octree_aabb, 0);
 
 	//Fill octree with the spheres
-	for (maths::Sphere sphere : spheres)
+	for (int i = 0; i < static_cast<int>(spheres.size()); ++i)
 	{
-		scene_octree.Insert(sphere);
+		scene_octree.Insert(spheres, i);
 	}
 		
 	RayTracer raytracer;
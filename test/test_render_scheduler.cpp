@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "render_scheduler.h"
+
+namespace raytracing {
+
+// Test that every pixel of the image is rendered exactly once,
+// including the partial tiles on the right and bottom borders
+TEST(RenderScheduler, Every_Pixel_Rendered_Once)
+{
+	const int width = 203;
+	const int height = 97;
+	std::vector<std::atomic<int>> pixels(width * height);
+	for (std::atomic<int>& pixel : pixels) {
+		pixel = 0;
+	}
+
+	RenderScheduler scheduler(4, 16);
+	std::atomic<int> wrong_thread_index{ 0 };
+	scheduler.Run(width, height, [&](const Tile& tile, int thread_index) {
+		if (thread_index < 0 || thread_index >= scheduler.thread_count()) {
+			++wrong_thread_index;
+		}
+		for (int i = tile.y; i < tile.y + tile.height; ++i) {
+			for (int j = tile.x; j < tile.x + tile.width; ++j) {
+				++pixels[j + i * width];
+			}
+		}
+	});
+
+	EXPECT_EQ(wrong_thread_index, 0);
+	for (const std::atomic<int>& pixel : pixels) {
+		EXPECT_EQ(pixel, 1);
+	}
+}
+
+// Test that repeated runs cover every item once and reuse the same worker
+// threads instead of starting new ones every time
+TEST(RenderScheduler, Parallel_For_Reuses_Workers)
+{
+	RenderScheduler scheduler(4, 16);
+	std::mutex mutex;
+	std::set<std::thread::id> thread_ids;
+	for (int run = 0; run < 20; ++run) {
+		std::vector<std::atomic<int>> items(1000);
+		for (std::atomic<int>& item : items) {
+			item = 0;
+		}
+		scheduler.ParallelFor(static_cast<int>(items.size()), [&](int begin, int end, int thread_index) {
+			EXPECT_GE(thread_index, 0);
+			EXPECT_LT(thread_index, 4);
+			for (int i = begin; i < end; ++i) {
+				++items[i];
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			thread_ids.insert(std::this_thread::get_id());
+		});
+		for (const std::atomic<int>& item : items) {
+			EXPECT_EQ(item, 1);
+		}
+		scheduler.Run(64, 64, [&](const Tile&, int) {
+			std::lock_guard<std::mutex> lock(mutex);
+			thread_ids.insert(std::this_thread::get_id());
+		});
+	}
+	EXPECT_LE(thread_ids.size(), 4u);
+}
+
+}// namespace raytracing
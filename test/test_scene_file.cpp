@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "raymarching.h"
+#include "raytracing/ray_tracer.h"
+#include "scene_file.h"
+
+namespace raytracing {
+
+namespace {
+
+std::vector<maths::Sphere> RandomSpheres(int count)
+{
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+	std::uniform_real_distribution<float> radius(0.2f, 1.0f);
+	const Material materials[2] = {
+		Material(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f)),
+		Material(0.8f, maths::Vector3f(0.0f, 128.0f, 255.0f)) };
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < count; ++i) {
+		maths::Sphere sphere(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator) - 20.0f));
+		sphere.set_material(materials[i % 2]);
+		spheres.push_back(sphere);
+	}
+	return spheres;
+}
+
+std::vector<std::uint8_t> ReadFile(const std::string& path)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::vector<std::uint8_t>& data)
+{
+	std::ofstream ofs(path, std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+}// namespace
+
+// Test that a loaded scene renders the same image as the scene it was saved from,
+// using the stored spheres and bvh in place and storing the shared materials once
+TEST(SceneFile, Load_Renders_Same_Image)
+{
+	const std::string path = "test_scene_file.rtscene";
+	std::vector<maths::Sphere> spheres = RandomSpheres(200);
+	std::vector<maths::Plane> planes;
+	planes.emplace_back(maths::Vector3f(0.0f, -8.0f, 0.0f), maths::Vector3f(0.0f, 1.0f, 0.0f));
+	PointLight light;
+
+	RayMarcher saved;
+	saved.set_write_image(false);
+	saved.SetScene(spheres, planes, light, 30, 40, 51.52f, 1e-4);
+	ASSERT_TRUE(saved.SaveScene(path));
+	saved.Render();
+
+	MappedSceneFile file;
+	ASSERT_TRUE(file.Open(path));
+	EXPECT_EQ(file.count(SceneFileSection::kSpheres), 200u);
+	EXPECT_EQ(file.count(SceneFileSection::kPlanes), 1u);
+	EXPECT_EQ(file.count(SceneFileSection::kMaterials), 3u);
+	EXPECT_EQ(file.header().camera.width, 40);
+	EXPECT_TRUE(file.has_current_bvh());
+	SphereTable table;
+	file.ViewSpheres(table);
+	EXPECT_EQ(table.size(), 200);
+	EXPECT_EQ(table.geometry(), file.section<PackedSphere>(SceneFileSection::kSpheres));
+	EXPECT_EQ(table.material(1).reflexion_index(), spheres[1].material().reflexion_index());
+	Bvh bvh;
+	EXPECT_TRUE(file.ReadBvh(BvhBuildMethod::kSah, bvh));
+	EXPECT_EQ(bvh.nodes(), file.section<BvhNode>(SceneFileSection::kBvhNodes));
+	EXPECT_EQ(bvh.store().id_data(), file.section<std::int32_t>(SceneFileSection::kBvhOrder));
+	file.Close();
+
+	RayMarcher loaded;
+	loaded.set_write_image(false);
+	ASSERT_TRUE(loaded.LoadScene(path));
+	loaded.Render();
+	EXPECT_EQ(loaded.frameBuffer(), saved.frameBuffer());
+
+	RayTracer raytracer;
+	raytracer.set_write_image(false);
+	ASSERT_TRUE(raytracer.LoadScene(path));
+	raytracer.Render();
+	RayTracer built;
+	built.set_write_image(false);
+	built.SetScene(spheres, light, 30, 40, 51.52f, 1e-4);
+	built.Render();
+	EXPECT_EQ(raytracer.frameBuffer(), built.frameBuffer());
+
+	std::remove(path.c_str());
+}
+
+// Test that the camera pose survives a save and load of both renderers
+TEST(SceneFile, Camera_Pose_Round_Trip)
+{
+	const std::string path = "test_scene_file_camera.rtscene";
+	std::vector<maths::Sphere> spheres = RandomSpheres(50);
+	std::vector<maths::Plane> planes;
+	PointLight light;
+
+	RayTracer saved;
+	saved.set_write_image(false);
+	saved.SetScene(spheres, light, 30, 40, 51.52f, 1e-4);
+	saved.camera().LookAt(maths::Vector3f(3.0f, 2.0f, 4.0f), maths::Vector3f(0.0f, 0.0f, -20.0f));
+	ASSERT_TRUE(saved.SaveScene(path));
+	saved.Render();
+
+	RayTracer loaded;
+	loaded.set_write_image(false);
+	ASSERT_TRUE(loaded.LoadScene(path));
+	for (int column = 0; column < 4; ++column) {
+		for (int row = 0; row < 4; ++row) {
+			EXPECT_EQ(loaded.camera().transform()[column][row], saved.camera().transform()[column][row]);
+		}
+	}
+	EXPECT_EQ(loaded.camera().position(), saved.camera().position());
+	loaded.Render();
+	EXPECT_EQ(loaded.frameBuffer(), saved.frameBuffer());
+
+	RayMarcher marcher;
+	marcher.set_write_image(false);
+	marcher.SetScene(spheres, planes, light, 30, 40, 51.52f, 1e-4);
+	marcher.camera().LookAt(maths::Vector3f(-2.0f, 1.0f, 3.0f), maths::Vector3f(1.0f, 0.0f, -20.0f));
+	ASSERT_TRUE(marcher.SaveScene(path));
+	RayMarcher marcher_loaded;
+	marcher_loaded.set_write_image(false);
+	ASSERT_TRUE(marcher_loaded.LoadScene(path));
+	EXPECT_EQ(marcher_loaded.camera().position(), marcher.camera().position());
+	EXPECT_EQ(marcher_loaded.camera().forward(), marcher.camera().forward());
+
+	std::remove(path.c_str());
+}
+
+// Test that a bvh stored for other spheres is rebuilt and that
+// damaged files are rejected
+TEST(SceneFile, Stale_Bvh_Rebuilt_And_Invalid_Files_Rejected)
+{
+	const std::string path = "test_scene_file_stale.rtscene";
+	std::vector<maths::Sphere> spheres = RandomSpheres(100);
+	std::vector<maths::Plane> planes;
+	PointLight light;
+	RayMarcher raymarcher;
+	raymarcher.set_write_image(false);
+	raymarcher.SetScene(spheres, planes, light, 30, 40, 51.52f, 1e-4);
+	ASSERT_TRUE(raymarcher.SaveScene(path));
+	const std::vector<std::uint8_t> data = ReadFile(path);
+
+	//Move the first sphere far away, the stored bvh bounds no longer hold it
+	std::vector<std::uint8_t> moved = data;
+	SceneFileHeader header;
+	std::memcpy(&header, moved.data(), sizeof(header));
+	PackedSphere sphere;
+	const std::uint64_t sphere_offset = header.sections[static_cast<int>(SceneFileSection::kSpheres)].offset;
+	std::memcpy(&sphere, moved.data() + sphere_offset, sizeof(sphere));
+	sphere.center = maths::Vector3f(0.0f, 0.0f, -5.0f);
+	std::memcpy(moved.data() + sphere_offset, &sphere, sizeof(sphere));
+	WriteFile(path, moved);
+
+	MappedSceneFile file;
+	ASSERT_TRUE(file.Open(path));
+	EXPECT_FALSE(file.has_current_bvh());
+	Bvh bvh;
+	EXPECT_FALSE(file.ReadBvh(BvhBuildMethod::kSah, bvh));
+	int sphere_index;
+	float distance;
+	ASSERT_TRUE(bvh.Intersect(maths::Ray3(maths::Vector3f(0.0f, 0.0f, 0.0f), maths::Vector3f(0.0f, 0.0f, -1.0f)),
+		sphere_index, distance));
+	EXPECT_EQ(sphere_index, 0);
+	file.Close();
+
+	std::vector<std::uint8_t> truncated(data.begin(), data.end() - 1);
+	WriteFile(path, truncated);
+	EXPECT_FALSE(file.Open(path));
+	EXPECT_FALSE(raymarcher.LoadScene(path));
+
+	std::vector<std::uint8_t> wrong_material = data;
+	const std::int32_t material = 1000;
+	const std::uint64_t material_offset = header.sections[static_cast<int>(SceneFileSection::kSphereMaterials)].offset;
+	std::memcpy(wrong_material.data() + material_offset, &material, sizeof(material));
+	WriteFile(path, wrong_material);
+	EXPECT_FALSE(file.Open(path));
+
+	std::vector<std::uint8_t> wrong_version = data;
+	wrong_version[8] = 99;
+	WriteFile(path, wrong_version);
+	EXPECT_FALSE(file.Open(path));
+
+	EXPECT_FALSE(file.Open("missing_scene_file.rtscene"));
+	std::remove(path.c_str());
+}
+
+}// namespace raytracing
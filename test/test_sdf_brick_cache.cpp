@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "sdf_brick_cache.h"
+
+// Check that the baked distance never exceeds the exact distance,
+// so it can always be used as a sphere tracing step
+TEST(SdfBrickCache, Lower_Bound_Is_Conservative)
+{
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> radius(0.2f, 2.0f);
+
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 200; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator)));
+	}
+
+	Bvh bvh;
+	bvh.Build(spheres);
+	SdfBrickCache cache;
+	cache.Build(bvh, maths::Vector3f(-25.0f, -25.0f, -25.0f), maths::Vector3f(25.0f, 25.0f, 25.0f), 2.0f, 8);
+	ASSERT_FALSE(cache.empty());
+	EXPECT_GT(cache.brick_count(), 0);
+	EXPECT_LT(cache.brick_count(), cache.cell_count());
+
+	std::uniform_real_distribution<float> query(-30.0f, 30.0f);
+	int useful_bounds = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		const maths::Vector3f point(query(generator), query(generator), query(generator));
+		int sphere_index;
+		const float exact = bvh.NearestDistance(point, sphere_index);
+		const float bound = cache.LowerBound(point);
+		EXPECT_LE(bound, exact + 1e-4f);
+		if (bound > cache.band())
+		{
+			++useful_bounds;
+		}
+	}
+	// Most of the space is far from the spheres, the exact distance should rarely be needed
+	EXPECT_GT(useful_bounds, 10000);
+}
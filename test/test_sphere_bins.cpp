@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "bvh.h"
+#include "camera.h"
+#include "sphere_bins.h"
+#include "raytracing/ray_tracer.h"
+
+// Test that the closest hit found in the tile of an image point is the one found
+// by the bvh, with spheres all around and behind a moved camera
+TEST(SphereBins, Closest_Hit_Matches_Bvh)
+{
+	std::mt19937 generator(21);
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 3.0f);
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 3000; ++i)
+	{
+		spheres.emplace_back(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator)));
+	}
+	SphereTable table;
+	table.Assign(spheres);
+	Bvh bvh;
+	bvh.Build(spheres);
+
+	const int width = 75;
+	const int height = 50;
+	raytracing::Camera camera;
+	camera.SetImage(width, height, 1.1f);
+	camera.LookAt(maths::Vector3f(2.0f, 1.0f, 3.0f), maths::Vector3f(-10.0f, 4.0f, -20.0f));
+	SphereBins bins;
+	bins.Build(camera, table, 16, 2);
+	EXPECT_EQ(bins.bins_x(), 5);
+	EXPECT_EQ(bins.bins_y(), 4);
+	EXPECT_GT(bins.reference_count(), 0);
+
+	std::uniform_real_distribution<float> image_x(0.0f, static_cast<float>(width));
+	std::uniform_real_distribution<float> image_y(0.0f, static_cast<float>(height));
+	for (int i = 0; i < 3000; ++i)
+	{
+		const float x = image_x(generator);
+		const float y = image_y(generator);
+		const maths::Ray3 ray(camera.position(), camera.Direction(x, y));
+		int expected_index = -1;
+		float expected_distance = 0.0f;
+		const bool expected_hit = bvh.Intersect(ray, expected_index, expected_distance);
+		int sphere_index = -1;
+		float distance = 0.0f;
+		EXPECT_EQ(bins.Intersect(x, y, ray, sphere_index, distance), expected_hit);
+		EXPECT_EQ(sphere_index, expected_index);
+		if (expected_hit)
+		{
+			EXPECT_NEAR(distance, expected_distance, 1e-3f);
+		}
+	}
+}
+
+// Test that the ray tracer renders the same image with the primary rays in the bins
+TEST(SphereBins, Binned_Render_Matches_Bvh)
+{
+	int width = 67;
+	int heigth = 45;
+	float fov = 51.52f;
+	double bias = 1e-4;
+
+	Material material_test(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 100; ++i) {
+		maths::Sphere sphere(0.4f, maths::Vector3f(-5.0f + (i % 10), -5.0f + (i / 10), -12.0f - (i % 3)));
+		sphere.set_material(material_test);
+		spheres.push_back(sphere);
+	}
+
+	raytracing::PointLight light;
+	raytracing::RayTracer raytracer;
+	raytracer.set_write_image(false);
+	raytracer.SetScene(spheres, light, heigth, width, fov, bias);
+	raytracer.Render();
+	const std::vector<maths::Vector3f> traversal = raytracer.frameBuffer();
+
+	raytracer.set_primary_binning(true, 8);
+	raytracer.Render();
+	int different_pixels = 0;
+	for (int i = 0; i < width * heigth; ++i) {
+		if ((traversal[i] - raytracer.frameBuffer()[i]).Magnitude() > 1.0f) {
+			++different_pixels;
+		}
+	}
+	//Allow a few silhouette pixels to differ because of float rounding
+	EXPECT_LE(different_pixels, width * heigth / 200);
+}
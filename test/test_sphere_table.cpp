@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "sphere_table.h"
+
+// Test that the identical materials are stored once and that
+// the spheres read back from the table are the ones assigned
+TEST(SphereTable, Materials_Shared_By_Id)
+{
+	const Material red(0.2f, maths::Vector3f(255.0f, 0.0f, 0.0f));
+	const Material blue(0.5f, maths::Vector3f(0.0f, 0.0f, 255.0f));
+	std::vector<maths::Sphere> spheres;
+	for (int i = 0; i < 10; ++i)
+	{
+		maths::Sphere sphere(0.5f + i, maths::Vector3f(static_cast<float>(i), 1.0f, -2.0f));
+		sphere.set_material(i % 3 == 0 ? blue : red);
+		spheres.push_back(sphere);
+	}
+
+	SphereTable table;
+	table.Assign(spheres);
+	ASSERT_EQ(table.size(), 10);
+	EXPECT_EQ(table.materials().size(), 2u);
+	for (int i = 0; i < table.size(); ++i)
+	{
+		EXPECT_EQ(table.material_id(i), table.material_id(i % 3 == 0 ? 0 : 1));
+		EXPECT_EQ(table.material(i).color(), spheres[i].material().color());
+		EXPECT_EQ(table.material(i).reflexion_index(), spheres[i].material().reflexion_index());
+		EXPECT_EQ(table.geometry(i).center, spheres[i].center());
+		EXPECT_EQ(table.geometry(i).radius, spheres[i].radius());
+	}
+	EXPECT_EQ(table.ToSpheres()[4].radius(), spheres[4].radius());
+}
+
+// Test that the packed sphere intersection gives the same hits as the ray one
+TEST(SphereTable, Packed_Intersection_Matches_Ray)
+{
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 3.0f);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const maths::Sphere sphere(radius(generator),
+			maths::Vector3f(position(generator), position(generator), position(generator)));
+		PackedSphere packed;
+		packed.center = sphere.center();
+		packed.radius = sphere.radius();
+		const maths::Ray3 ray(maths::Vector3f(position(generator), position(generator), position(generator)),
+			maths::Vector3f(position(generator), position(generator), position(generator)).Normalized());
+
+		float expected_distance = -1.0f;
+		float distance = -1.0f;
+		const bool expected_hit = ray.IntersectSphere(sphere, expected_distance);
+		EXPECT_EQ(packed.Intersect(ray, distance), expected_hit);
+		EXPECT_EQ(distance, expected_distance);
+	}
+}
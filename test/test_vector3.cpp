@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "maths/vector3.h"
+#include "maths/vector3_simd.h"
+
+// The vector arithmetic is usable in constant expressions
+static_assert(maths::Vector3f::Dot(maths::Vector3f(1.0f, 2.0f, 3.0f) + maths::Vector3f(1.0f, 0.0f, 0.0f),
+	maths::Vector3f(0.0f, 1.0f, 1.0f) * 2.0f) == 10.0f, "Vector3f is not constexpr");
+
+// Test that the simd vector gives the results of Vector3f
+TEST(Vector3, Simd_Matches_Vector3f)
+{
+	std::mt19937 generator(5);
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const maths::Vector3f a(value(generator), value(generator), value(generator));
+		const maths::Vector3f b(value(generator), value(generator), value(generator));
+		const maths::SimdVector3f simd_a(a);
+		const maths::SimdVector3f simd_b(b);
+
+		EXPECT_EQ((simd_a + simd_b).ToVector3f(), a + b);
+		EXPECT_EQ((simd_a - simd_b).ToVector3f(), a - b);
+		EXPECT_EQ((simd_a * 3.0f).ToVector3f(), a * 3.0f);
+		//The lanes are not summed in the same order, the rounding can differ
+		const float tolerance = 1e-6f * a.Magnitude() * b.Magnitude();
+		EXPECT_NEAR(maths::SimdVector3f::Dot(simd_a, simd_b), maths::Vector3f::Dot(a, b), tolerance);
+		const maths::Vector3f cross = maths::SimdVector3f::Cross(simd_a, simd_b).ToVector3f();
+		EXPECT_NEAR((cross - maths::Vector3f::Cross(a, b)).Magnitude(), 0.0f, 1e-4f);
+		EXPECT_NEAR(simd_a.Magnitude(), a.Magnitude(), 1e-6f * a.Magnitude());
+		EXPECT_NEAR((simd_a.Normalized().ToVector3f() - a.Normalized()).Magnitude(), 0.0f, 1e-6f);
+	}
+	EXPECT_EQ(maths::SimdVector3f().Normalized().ToVector3f(), maths::Vector3f(0.0f, 0.0f, 0.0f));
+}